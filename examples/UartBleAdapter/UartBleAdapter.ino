@@ -16,6 +16,7 @@
 
 #include <HardwareSerial.h>
 #include "NuSerial.hpp"
+#include "NuBridge.hpp"
 #include "NimBLEDevice.h"
 
 // Expected hardware UART baud rate for UART0
@@ -35,8 +36,11 @@
 
 // Buffer size (set as you wish)
 #define BUFFER_SIZE 2048
-// Read/write buffer to hold data in transit
-uint8_t data_buffer[BUFFER_SIZE];
+// Maximum time (in milliseconds) to hold UART data
+// before sending it to the Bluetooth side
+#define FLUSH_MILLIS 5
+// Transfers data between the UARTs and NuSerial in the background
+NuSBridge bridge(NuSerial);
 
 void setup()
 {
@@ -44,25 +48,25 @@ void setup()
     // Initialize the 1st hardware UART
     Serial0.setRxBufferSize(BUFFER_SIZE);
     Serial0.begin(UART0_BAUD_RATE);
-    Serial0.setTimeout(20);
+    bridge.add(Serial0);
 #endif
 #if UART1_BAUD_RATE > 0
     // Initialize the 2nd hardware UART
     Serial1.setRxBufferSize(BUFFER_SIZE);
     // Configured to pins 4 and 5. Feel free to change.
     Serial1.begin(UART1_BAUD_RATE, SERIAL_8N1, 4, 5);
-    Serial1.setTimeout(20);
+    bridge.add(Serial1);
 #endif
 #if ARDUINO_USB_CDC_ON_BOOT && ARDUINO_USB_MODE
     // Initialize the USB CDC UART (if available)
     HWCDCSerial.setRxBufferSize(BUFFER_SIZE);
     HWCDCSerial.begin(); // Note: USB CDC ignores the baud parameter
-    HWCDCSerial.setTimeout(20);
+    bridge.add(HWCDCSerial);
 #endif
 #if ARDUINO_USB_CDC_ON_BOOT && !ARDUINO_USB_MODE
     USBSerial.setRxBufferSize(BUFFER_SIZE);
     USBSerial.begin(); // Note: USB CDC ignores the baud parameter
-    USBSerial.setTimeout(20);
+    bridge.add(USBSerial);
 #endif
 
     char name[17];
@@ -71,51 +75,24 @@ void setup()
     NimBLEDevice::init(name);
     NimBLEDevice::getAdvertising()->setName(name);
     NuSerial.begin(); // Note: NuS ignores the baud parameter
+
+    // Start bridging.
+    // UART data is sent in batches of the MTU size,
+    // or after FLUSH_MILLIS, whatever happens first.
+    bridge.setBufferSize(BUFFER_SIZE);
+    bridge.setFlushThresholds(0, FLUSH_MILLIS);
+    bridge.begin();
 }
 
 // Some general notes:
 // - We don't care about the connection state (there is no need to).
 // - We don't handle errors as there is no
 //   place to report them.
+// - Call bridge.getUplinkStats() and bridge.getDownlinkStats()
+//   to know the transfer counters.
 
 void loop()
 {
-    // First, we read data from the configured UARTS
-    // and send it to NuSerial
-    // ---------------------------------------------
-    size_t available_size;
-
-#if UART0_BAUD_RATE > 0
-    available_size = Serial0.readBytes(data_buffer, Serial0.available());
-    NuSerial.write(data_buffer, available_size);
-#endif
-#if UART1_BAUD_RATE > 0
-    available_size = Serial1.readBytes(data_buffer, Serial1.available());
-    NuSerial.write(data_buffer, available_size);
-#endif
-#if ARDUINO_USB_CDC_ON_BOOT && ARDUINO_USB_MODE
-    available_size = HWCDCSerial.readBytes(data_buffer, HWCDCSerial.available());
-    NuSerial.write(data_buffer, available_size);
-#endif
-#if ARDUINO_USB_CDC_ON_BOOT && !ARDUINO_USB_MODE
-    available_size = USBSerial.readBytes(data_buffer, USBSerial.available());
-    NuSerial.write(data_buffer, available_size);
-#endif
-
-    // Next, we read data from NuSerial
-    // and send it to the configured UARTS
-    // ---------------------------------------------
-    available_size = NuSerial.readBytes(data_buffer, NuSerial.available());
-#if UART0_BAUD_RATE > 0
-    Serial0.write(data_buffer, available_size);
-#endif
-#if UART1_BAUD_RATE > 0
-    Serial1.write(data_buffer, available_size);
-#endif
-#if ARDUINO_USB_CDC_ON_BOOT && ARDUINO_USB_MODE
-    HWCDCSerial.write(data_buffer, available_size);
-#endif
-#if ARDUINO_USB_CDC_ON_BOOT && !ARDUINO_USB_MODE
-    USBSerial.write(data_buffer, available_size);
-#endif
+    // Nothing to do here. The bridge runs in the background.
+    delay(30000);
 }
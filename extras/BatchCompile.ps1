@@ -79,6 +79,20 @@ try {
     Invoke-ArduinoCLI -Filename "extras/test/HandshakeTest/HandshakeTest.ino" -BuildPath $tempFolder
     Invoke-ArduinoCLI -Filename "extras/test/Issue8/Issue8.ino" -BuildPath $tempFolder
     Invoke-ArduinoCLI -Filename "extras/test/SimpleCommandTester/SimpleCommandTester.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/SemaphoreBenchmark/SemaphoreBenchmark.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/RxBufferBenchmark/RxBufferBenchmark.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/CoroutineTest/CoroutineTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/WaitSetTest/WaitSetTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/ReadUntilTest/ReadUntilTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/ReadDeadlineTest/ReadDeadlineTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/FramingBenchmark/FramingBenchmark.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/CompressionBenchmark/CompressionBenchmark.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/ResumeTest/ResumeTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/BridgeTest/BridgeTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/TraceTest/TraceTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/ProfileTest/ProfileTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/CaptureTest/CaptureTest.ino" -BuildPath $tempFolder
+    Invoke-ArduinoCLI -Filename "extras/test/VirtualClockTest/VirtualClockTest.ino" -BuildPath $tempFolder
 }
 finally {
     # Remove temporary folder
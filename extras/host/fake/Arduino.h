@@ -0,0 +1,29 @@
+/**
+ * @file Arduino.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino core
+ *
+ * @note Just the subset used by this library and the host tools.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_ARDUINO_H__
+#define __FAKE_ARDUINO_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+#endif
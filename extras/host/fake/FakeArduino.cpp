@@ -0,0 +1,112 @@
+/**
+ * @file FakeArduino.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino core
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+//-----------------------------------------------------------------------------
+// Time
+//-----------------------------------------------------------------------------
+
+static const auto bootTime = ::std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+               ::std::chrono::steady_clock::now() - bootTime)
+        .count();
+}
+
+unsigned long micros()
+{
+    return ::std::chrono::duration_cast<::std::chrono::microseconds>(
+               ::std::chrono::steady_clock::now() - bootTime)
+        .count();
+}
+
+void delay(unsigned long ms)
+{
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+    ::std::this_thread::yield();
+}
+
+//-----------------------------------------------------------------------------
+// Stream
+//-----------------------------------------------------------------------------
+
+int Stream::timedRead()
+{
+    _startMillis = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - _startMillis < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if ((c < 0) || (c == terminator))
+            break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String result;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        result.concat((char)c);
+        c = timedRead();
+    }
+    return result;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String result;
+    int c = timedRead();
+    while ((c >= 0) && (c != terminator))
+    {
+        result.concat((char)c);
+        c = timedRead();
+    }
+    return result;
+}
@@ -0,0 +1,463 @@
+/**
+ * @file FakeNimBLE.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the NimBLE-Arduino stack (peripheral role)
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NimBLEDevice.h"
+#include "NimBLEFake.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+static NimBLEServer *pTheServer = nullptr;
+static NimBLEAdvertising theAdvertising;
+static uint16_t deviceMTU = 255;
+// Serializes callbacks, as the BLE host task does
+static ::std::mutex hostMutex;
+static ::std::atomic<uint64_t> busyMicros{0};
+static ::std::mutex sinkMutex;
+static NimBLEFakeNotifySink_t notifySink;
+
+//-----------------------------------------------------------------------------
+// NimBLEDevice
+//-----------------------------------------------------------------------------
+
+bool NimBLEDevice::deinit(bool clearAll)
+{
+    ::std::lock_guard<::std::mutex> lock(hostMutex);
+    delete pTheServer;
+    pTheServer = nullptr;
+    theAdvertising.stop();
+    return true;
+}
+
+NimBLEServer *NimBLEDevice::createServer()
+{
+    if (!pTheServer)
+        pTheServer = new NimBLEServer();
+    return pTheServer;
+}
+
+NimBLEServer *NimBLEDevice::getServer()
+{
+    return pTheServer;
+}
+
+NimBLEAdvertising *NimBLEDevice::getAdvertising()
+{
+    return &theAdvertising;
+}
+
+bool NimBLEDevice::setMTU(uint16_t mtu)
+{
+    if ((mtu < 23) || (mtu > 527))
+        return false;
+    deviceMTU = mtu;
+    return true;
+}
+
+uint16_t NimBLEDevice::getMTU()
+{
+    return deviceMTU;
+}
+
+//-----------------------------------------------------------------------------
+// NimBLECharacteristic
+//-----------------------------------------------------------------------------
+
+NimBLEAttValue NimBLECharacteristic::getValue(time_t *timestamp) const
+{
+    ::std::lock_guard<::std::mutex> lock(attMutex);
+    return NimBLEAttValue(value.data(), value.size());
+}
+
+uint16_t NimBLECharacteristic::getLength() const
+{
+    ::std::lock_guard<::std::mutex> lock(attMutex);
+    return value.size();
+}
+
+void NimBLECharacteristic::setValue(const uint8_t *data, size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(attMutex);
+    value.assign(data, data + size);
+}
+
+bool NimBLECharacteristic::notify(const uint8_t *data, size_t size, uint16_t connHandle) const
+{
+    ::std::vector<uint16_t> receivers;
+    {
+        ::std::lock_guard<::std::mutex> lock(attMutex);
+        for (auto &subscription : subscriptions)
+            if ((subscription.second != 0) &&
+                ((connHandle == BLE_HS_CONN_HANDLE_NONE) || (connHandle == subscription.first)))
+                receivers.push_back(subscription.first);
+    }
+    bool result = true;
+    for (uint16_t receiver : receivers)
+        result = NimBLEFake::deliver(receiver, data, size) && result;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// NimBLEService
+//-----------------------------------------------------------------------------
+
+NimBLEService::~NimBLEService()
+{
+    for (NimBLECharacteristic *pCharacteristic : characteristics)
+        delete pCharacteristic;
+}
+
+NimBLECharacteristic *NimBLEService::createCharacteristic(const char *uuid, uint32_t properties, uint16_t maxLen)
+{
+    NimBLECharacteristic *pCharacteristic = new NimBLECharacteristic(uuid, properties, this);
+    characteristics.push_back(pCharacteristic);
+    return pCharacteristic;
+}
+
+NimBLECharacteristic *NimBLEService::getCharacteristic(const char *uuid) const
+{
+    for (NimBLECharacteristic *pCharacteristic : characteristics)
+        if (pCharacteristic->getUUID() == uuid)
+            return pCharacteristic;
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// NimBLEServer
+//-----------------------------------------------------------------------------
+
+NimBLEServer::~NimBLEServer()
+{
+    for (NimBLEService *pService : services)
+        delete pService;
+}
+
+NimBLEService *NimBLEServer::createService(const char *uuid)
+{
+    NimBLEService *pService = new NimBLEService(uuid, this);
+    services.push_back(pService);
+    return pService;
+}
+
+NimBLEService *NimBLEServer::getServiceByUUID(const char *uuid, uint16_t instanceId) const
+{
+    for (NimBLEService *pService : services)
+        if ((pService->getUUID() == uuid) && (instanceId-- == 0))
+            return pService;
+    return nullptr;
+}
+
+void NimBLEServer::removeService(NimBLEService *pService, bool deleteSvc)
+{
+    auto position = ::std::find(services.begin(), services.end(), pService);
+    if (position != services.end())
+    {
+        services.erase(position);
+        if (deleteSvc)
+            delete pService;
+    }
+}
+
+NimBLEAdvertising *NimBLEServer::getAdvertising()
+{
+    return NimBLEDevice::getAdvertising();
+}
+
+bool NimBLEServer::startAdvertising(uint32_t duration)
+{
+    return NimBLEDevice::getAdvertising()->start(duration);
+}
+
+bool NimBLEServer::stopAdvertising()
+{
+    return NimBLEDevice::getAdvertising()->stop();
+}
+
+::std::vector<uint16_t> NimBLEServer::getPeerDevices() const
+{
+    ::std::vector<uint16_t> result;
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    for (auto &connection : connections)
+        result.push_back(connection.first);
+    return result;
+}
+
+uint32_t NimBLEServer::getConnectedCount() const
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    return connections.size();
+}
+
+NimBLEConnInfo NimBLEServer::getPeerInfoByHandle(uint16_t connHandle) const
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    auto connection = connections.find(connHandle);
+    if (connection != connections.end())
+        return connection->second;
+    return NimBLEConnInfo();
+}
+
+uint16_t NimBLEServer::getPeerMTU(uint16_t connHandle) const
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    auto connection = connections.find(connHandle);
+    return (connection != connections.end()) ? connection->second.mtu : 0;
+}
+
+bool NimBLEServer::disconnect(uint16_t connHandle, uint8_t reason)
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    if (connections.count(connHandle) == 0)
+        return false;
+    if (::std::find(pendingDisconnections.begin(), pendingDisconnections.end(), connHandle) ==
+        pendingDisconnections.end())
+        pendingDisconnections.push_back(connHandle);
+    return true;
+}
+
+bool NimBLEServer::updateConnParams(
+    uint16_t connHandle,
+    uint16_t minInterval,
+    uint16_t maxInterval,
+    uint16_t latency,
+    uint16_t timeout)
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    auto connection = connections.find(connHandle);
+    if (connection == connections.end())
+        return false;
+    connection->second.interval = maxInterval;
+    connection->second.latency = latency;
+    connection->second.timeout = timeout;
+    return true;
+}
+
+bool NimBLEServer::setDataLen(uint16_t connHandle, uint16_t octets) const
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    return (connections.count(connHandle) > 0);
+}
+
+bool NimBLEServer::updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxPhyMask, uint16_t phyOptions)
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    auto connection = connections.find(connHandle);
+    if (connection == connections.end())
+        return false;
+    connection->second.txPhy = (txPhyMask & BLE_GAP_LE_PHY_2M_MASK) ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M;
+    connection->second.rxPhy = (rxPhyMask & BLE_GAP_LE_PHY_2M_MASK) ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M;
+    return true;
+}
+
+bool NimBLEServer::getPhy(uint16_t connHandle, uint8_t *txPhy, uint8_t *rxPhy)
+{
+    ::std::lock_guard<::std::mutex> lock(connectionsMutex);
+    auto connection = connections.find(connHandle);
+    if (connection == connections.end())
+        return false;
+    *txPhy = connection->second.txPhy;
+    *rxPhy = connection->second.rxPhy;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// NimBLEFake: simulated centrals
+//-----------------------------------------------------------------------------
+
+// Holds the host lock and accounts for the time held
+class HostTask
+{
+public:
+    HostTask() : lock(hostMutex), startTime(::std::chrono::steady_clock::now()) {};
+    ~HostTask()
+    {
+        busyMicros += ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                          ::std::chrono::steady_clock::now() - startTime)
+                          .count();
+    };
+
+private:
+    ::std::lock_guard<::std::mutex> lock;
+    ::std::chrono::steady_clock::time_point startTime;
+};
+
+uint64_t NimBLEFake::getBusyMicros()
+{
+    return busyMicros;
+}
+
+NimBLECharacteristic *NimBLEFake::find(NimBLEServer *pServer, const char *uuid)
+{
+    for (NimBLEService *pService : pServer->services)
+        if (pService->isStarted())
+        {
+            NimBLECharacteristic *pCharacteristic = pService->getCharacteristic(uuid);
+            if (pCharacteristic)
+                return pCharacteristic;
+        }
+    return nullptr;
+}
+
+void NimBLEFake::closeConnection(NimBLEServer *pServer, uint16_t connHandle, int reason)
+{
+    // Note: hostMutex is locked by the caller
+    NimBLEConnInfo connInfo = pServer->getPeerInfoByHandle(connHandle);
+    for (NimBLEService *pService : pServer->services)
+        for (NimBLECharacteristic *pCharacteristic : pService->getCharacteristics())
+        {
+            bool wasSubscribed;
+            {
+                ::std::lock_guard<::std::mutex> lock(pCharacteristic->attMutex);
+                wasSubscribed = (pCharacteristic->subscriptions.erase(connHandle) > 0);
+            }
+            if (wasSubscribed && pCharacteristic->pCallbacks)
+                pCharacteristic->pCallbacks->onSubscribe(pCharacteristic, connInfo, 0);
+        }
+    {
+        ::std::lock_guard<::std::mutex> lock(pServer->connectionsMutex);
+        pServer->connections.erase(connHandle);
+    }
+    if (pServer->pCallbacks)
+        pServer->pCallbacks->onDisconnect(pServer, connInfo, reason);
+    if (pServer->bAdvertiseOnDisconnect)
+        pServer->startAdvertising();
+}
+
+size_t NimBLEFake::processEvents()
+{
+    HostTask hostTask;
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer)
+        return 0;
+    ::std::vector<uint16_t> pending;
+    {
+        ::std::lock_guard<::std::mutex> lock(pServer->connectionsMutex);
+        pending.swap(pServer->pendingDisconnections);
+    }
+    for (uint16_t connHandle : pending)
+        closeConnection(pServer, connHandle, BLE_ERR_REM_USER_CONN_TERM);
+    return pending.size();
+}
+
+uint16_t NimBLEFake::connect(uint16_t mtu, uint16_t connHandle)
+{
+    processEvents();
+    HostTask hostTask;
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer)
+        return BLE_HS_CONN_HANDLE_NONE;
+    NimBLEConnInfo connInfo;
+    {
+        ::std::lock_guard<::std::mutex> lock(pServer->connectionsMutex);
+        if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+        {
+            connHandle = 1;
+            while (pServer->connections.count(connHandle) > 0)
+                connHandle++;
+        }
+        else if (pServer->connections.count(connHandle) > 0)
+            return BLE_HS_CONN_HANDLE_NONE;
+        connInfo.connHandle = connHandle;
+        connInfo.mtu = ::std::max<uint16_t>(23, ::std::min(mtu, deviceMTU));
+        pServer->connections[connHandle] = connInfo;
+    }
+    if (pServer->pCallbacks)
+    {
+        pServer->pCallbacks->onConnect(pServer, connInfo);
+        if (connInfo.mtu > 23)
+            pServer->pCallbacks->onMTUChange(connInfo.mtu, connInfo);
+    }
+    return connHandle;
+}
+
+bool NimBLEFake::disconnect(uint16_t connHandle)
+{
+    processEvents();
+    HostTask hostTask;
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer || !isConnected(connHandle))
+        return false;
+    closeConnection(pServer, connHandle, BLE_ERR_REM_USER_CONN_TERM);
+    return true;
+}
+
+bool NimBLEFake::isConnected(uint16_t connHandle)
+{
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer)
+        return false;
+    ::std::lock_guard<::std::mutex> lock(pServer->connectionsMutex);
+    return (pServer->connections.count(connHandle) > 0);
+}
+
+bool NimBLEFake::subscribe(uint16_t connHandle, const char *uuid, bool yesOrNo)
+{
+    processEvents();
+    HostTask hostTask;
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer || !isConnected(connHandle))
+        return false;
+    NimBLECharacteristic *pCharacteristic = find(pServer, uuid);
+    if (!pCharacteristic ||
+        !(pCharacteristic->properties & (NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::INDICATE)))
+        return false;
+    uint16_t subValue = 0;
+    if (yesOrNo)
+        subValue = (pCharacteristic->properties & NIMBLE_PROPERTY::NOTIFY) ? 1 : 2;
+    {
+        ::std::lock_guard<::std::mutex> lock(pCharacteristic->attMutex);
+        if (subValue)
+            pCharacteristic->subscriptions[connHandle] = subValue;
+        else
+            pCharacteristic->subscriptions.erase(connHandle);
+    }
+    NimBLEConnInfo connInfo = pServer->getPeerInfoByHandle(connHandle);
+    if (pCharacteristic->pCallbacks)
+        pCharacteristic->pCallbacks->onSubscribe(pCharacteristic, connInfo, subValue);
+    return true;
+}
+
+bool NimBLEFake::write(uint16_t connHandle, const char *uuid, const uint8_t *data, size_t size)
+{
+    processEvents();
+    HostTask hostTask;
+    NimBLEServer *pServer = pTheServer;
+    if (!pServer || !isConnected(connHandle))
+        return false;
+    NimBLECharacteristic *pCharacteristic = find(pServer, uuid);
+    if (!pCharacteristic ||
+        !(pCharacteristic->properties & (NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR)))
+        return false;
+    pCharacteristic->setValue(data, size);
+    NimBLEConnInfo connInfo = pServer->getPeerInfoByHandle(connHandle);
+    if (pCharacteristic->pCallbacks)
+        pCharacteristic->pCallbacks->onWrite(pCharacteristic, connInfo);
+    return true;
+}
+
+void NimBLEFake::onNotify(NimBLEFakeNotifySink_t sink)
+{
+    ::std::lock_guard<::std::mutex> lock(sinkMutex);
+    notifySink = sink;
+}
+
+bool NimBLEFake::deliver(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    NimBLEFakeNotifySink_t sink;
+    {
+        ::std::lock_guard<::std::mutex> lock(sinkMutex);
+        sink = notifySink;
+    }
+    return (sink) ? sink(connHandle, data, size) : true;
+}
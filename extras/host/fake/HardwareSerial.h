@@ -0,0 +1,60 @@
+/**
+ * @file HardwareSerial.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino serial port
+ *
+ * @note Output goes to the standard output. There is no input.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_HARDWARESERIAL_H__
+#define __FAKE_HARDWARESERIAL_H__
+
+#include "Stream.h"
+#include <functional>
+#include <mutex>
+
+typedef ::std::function<void(void)> OnReceiveCb;
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) {};
+    void end() {};
+    void onReceive(OnReceiveCb function, bool onlyOnTimeout = false)
+    {
+        ::std::lock_guard<::std::mutex> lock(onReceiveMutex);
+        onReceiveCb = function;
+    };
+    virtual int available() override { return 0; };
+    virtual int read() override { return -1; };
+    virtual int peek() override { return -1; };
+    virtual size_t write(uint8_t c) override { return write(&c, 1); };
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        return fwrite(buffer, 1, size, stdout);
+    };
+    using Print::write;
+    virtual void flush() override { fflush(stdout); };
+    operator bool() const { return true; };
+
+protected:
+    // Call the onReceive() callback, if any, as the UART driver does when data arrives
+    void received()
+    {
+        ::std::lock_guard<::std::mutex> lock(onReceiveMutex);
+        if (onReceiveCb)
+            onReceiveCb();
+    };
+
+private:
+    ::std::mutex onReceiveMutex;
+    OnReceiveCb onReceiveCb;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,11 @@
+/**
+ * @file NimBLECharacteristic.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the NimBLE-Arduino stack
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NimBLEDevice.h"
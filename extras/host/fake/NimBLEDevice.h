@@ -0,0 +1,286 @@
+/**
+ * @file NimBLEDevice.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the NimBLE-Arduino stack (peripheral role)
+ *
+ * @note Just the subset used by this library. There is no radio:
+ *       simulated centrals are driven with NimBLEFake (see NimBLEFake.h).
+ *       L2CAP channels are not available.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_NIMBLEDEVICE_H__
+#define __FAKE_NIMBLEDEVICE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_ERR_REM_USER_CONN_TERM 0x13
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+#define BLE_GAP_LE_PHY_ANY_MASK 0x07
+#define BLE_GAP_LE_PHY_CODED_ANY 0
+#define BLE_GAP_LE_PHY_1M 1
+#define BLE_GAP_LE_PHY_2M 2
+
+namespace NIMBLE_PROPERTY
+{
+    enum
+    {
+        READ = 0x0001,
+        READ_ENC = 0x0002,
+        READ_AUTHEN = 0x0004,
+        READ_AUTHOR = 0x0008,
+        WRITE = 0x0010,
+        WRITE_NR = 0x0020,
+        WRITE_ENC = 0x0040,
+        WRITE_AUTHEN = 0x0080,
+        WRITE_AUTHOR = 0x0100,
+        BROADCAST = 0x0200,
+        NOTIFY = 0x0400,
+        INDICATE = 0x0800
+    };
+}
+
+class NimBLEServer;
+class NimBLEService;
+class NimBLECharacteristic;
+class NimBLEFake;
+
+//-----------------------------------------------------------------------------
+// Values and connections
+//-----------------------------------------------------------------------------
+
+// Note: as in NimBLE, a null terminator follows the value
+class NimBLEAttValue
+{
+public:
+    NimBLEAttValue() : value(1, 0) {};
+    NimBLEAttValue(const uint8_t *data, size_t size) : value(data, data + size) { value.push_back(0); };
+    const uint8_t *data() const { return value.data(); };
+    size_t size() const { return value.size() - 1; };
+    size_t length() const { return value.size() - 1; };
+    const char *c_str() const { return (const char *)value.data(); };
+
+private:
+    ::std::vector<uint8_t> value;
+};
+
+class NimBLEAddress
+{
+public:
+    ::std::string toString() const { return "00:00:00:00:00:00"; };
+};
+
+class NimBLEConnInfo
+{
+    friend class NimBLEServer;
+    friend class NimBLEFake;
+
+public:
+    uint16_t getConnHandle() const { return connHandle; };
+    uint16_t getMTU() const { return mtu; };
+    uint16_t getConnInterval() const { return interval; };
+    uint16_t getConnLatency() const { return latency; };
+    uint16_t getConnTimeout() const { return timeout; };
+    NimBLEAddress getAddress() const { return {}; };
+
+private:
+    uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint16_t mtu = 23;
+    uint16_t interval = 24;
+    uint16_t latency = 0;
+    uint16_t timeout = 400;
+    uint8_t txPhy = BLE_GAP_LE_PHY_1M;
+    uint8_t rxPhy = BLE_GAP_LE_PHY_1M;
+};
+
+//-----------------------------------------------------------------------------
+// Characteristics
+//-----------------------------------------------------------------------------
+
+class NimBLECharacteristicCallbacks
+{
+public:
+    virtual ~NimBLECharacteristicCallbacks() {};
+    virtual void onRead(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo) {};
+    virtual void onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo) {};
+    virtual void onStatus(NimBLECharacteristic *pCharacteristic, int code) {};
+    virtual void onSubscribe(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo, uint16_t subValue) {};
+};
+
+class NimBLECharacteristic
+{
+    friend class NimBLEService;
+    friend class NimBLEFake;
+
+public:
+    NimBLEAttValue getValue(time_t *timestamp = nullptr) const;
+    uint16_t getLength() const;
+    void setValue(const uint8_t *data, size_t size);
+    void setCallbacks(NimBLECharacteristicCallbacks *pCallbacks) { this->pCallbacks = pCallbacks; };
+    NimBLECharacteristicCallbacks *getCallbacks() const { return pCallbacks; };
+    bool notify(const uint8_t *data, size_t size, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool indicate(const uint8_t *data, size_t size, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const
+    {
+        return notify(data, size, connHandle);
+    };
+    NimBLEService *getService() const { return pService; };
+    const ::std::string &getUUID() const { return uuid; };
+    uint32_t getProperties() const { return properties; };
+
+private:
+    NimBLECharacteristic(const char *uuid, uint32_t properties, NimBLEService *pService)
+        : uuid(uuid), properties(properties), pService(pService) {};
+
+    ::std::string uuid;
+    uint32_t properties;
+    NimBLEService *pService;
+    NimBLECharacteristicCallbacks *pCallbacks = nullptr;
+    // Protects value and subscriptions
+    mutable ::std::mutex attMutex;
+    ::std::vector<uint8_t> value;
+    // Subscription value by connection handle
+    ::std::map<uint16_t, uint16_t> subscriptions;
+};
+
+//-----------------------------------------------------------------------------
+// Services
+//-----------------------------------------------------------------------------
+
+class NimBLEService
+{
+    friend class NimBLEServer;
+
+public:
+    ~NimBLEService();
+    NimBLECharacteristic *createCharacteristic(
+        const char *uuid,
+        uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
+        uint16_t maxLen = 512);
+    NimBLECharacteristic *getCharacteristic(const char *uuid) const;
+    const ::std::vector<NimBLECharacteristic *> &getCharacteristics() const { return characteristics; };
+    bool start()
+    {
+        bStarted = true;
+        return true;
+    };
+    bool isStarted() const { return bStarted; };
+    NimBLEServer *getServer() const { return pServer; };
+    const ::std::string &getUUID() const { return uuid; };
+
+private:
+    NimBLEService(const char *uuid, NimBLEServer *pServer) : uuid(uuid), pServer(pServer) {};
+
+    ::std::string uuid;
+    NimBLEServer *pServer;
+    ::std::vector<NimBLECharacteristic *> characteristics;
+    bool bStarted = false;
+};
+
+//-----------------------------------------------------------------------------
+// Server
+//-----------------------------------------------------------------------------
+
+class NimBLEAdvertising
+{
+public:
+    bool addServiceUUID(const char *uuid) { return true; };
+    bool removeServiceUUID(const char *uuid) { return true; };
+    bool setName(const ::std::string &name) { return true; };
+    bool start(uint32_t duration = 0)
+    {
+        bAdvertising = true;
+        return true;
+    };
+    bool stop()
+    {
+        bAdvertising = false;
+        return true;
+    };
+    bool isAdvertising() const { return bAdvertising; };
+
+private:
+    ::std::atomic<bool> bAdvertising{false};
+};
+
+class NimBLEServerCallbacks
+{
+public:
+    virtual ~NimBLEServerCallbacks() {};
+    virtual void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo) {};
+    virtual void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo, int reason) {};
+    virtual void onMTUChange(uint16_t mtu, NimBLEConnInfo &connInfo) {};
+    virtual void onConnParamsUpdate(NimBLEConnInfo &connInfo) {};
+    virtual void onPhyUpdate(NimBLEConnInfo &connInfo, uint8_t txPhy, uint8_t rxPhy) {};
+};
+
+class NimBLEServer
+{
+    friend class NimBLEDevice;
+    friend class NimBLEFake;
+
+public:
+    ~NimBLEServer();
+    NimBLEService *createService(const char *uuid);
+    NimBLEService *getServiceByUUID(const char *uuid, uint16_t instanceId = 0) const;
+    void removeService(NimBLEService *pService, bool deleteSvc = false);
+    void setCallbacks(NimBLEServerCallbacks *pCallbacks, bool deleteCallbacks = true) { this->pCallbacks = pCallbacks; };
+    NimBLEAdvertising *getAdvertising();
+    bool startAdvertising(uint32_t duration = 0);
+    bool stopAdvertising();
+    void advertiseOnDisconnect(bool yesOrNo) { bAdvertiseOnDisconnect = yesOrNo; };
+
+    ::std::vector<uint16_t> getPeerDevices() const;
+    uint32_t getConnectedCount() const;
+    NimBLEConnInfo getPeerInfoByHandle(uint16_t connHandle) const;
+    uint16_t getPeerMTU(uint16_t connHandle) const;
+    /**
+     * @note Asynchronous: the disconnection is delivered
+     *       by NimBLEFake::processEvents()
+     */
+    bool disconnect(uint16_t connHandle, uint8_t reason = BLE_ERR_REM_USER_CONN_TERM);
+    bool updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+    bool setDataLen(uint16_t connHandle, uint16_t octets) const;
+    bool updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxPhyMask, uint16_t phyOptions);
+    bool getPhy(uint16_t connHandle, uint8_t *txPhy, uint8_t *rxPhy);
+
+private:
+    NimBLEServer() {};
+
+    ::std::vector<NimBLEService *> services;
+    NimBLEServerCallbacks *pCallbacks = nullptr;
+    bool bAdvertiseOnDisconnect = false;
+    mutable ::std::mutex connectionsMutex;
+    ::std::map<uint16_t, NimBLEConnInfo> connections;
+    ::std::vector<uint16_t> pendingDisconnections;
+};
+
+//-----------------------------------------------------------------------------
+// Device
+//-----------------------------------------------------------------------------
+
+class NimBLEDevice
+{
+public:
+    static bool init(const ::std::string &deviceName) { return true; };
+    static bool deinit(bool clearAll = false);
+    static NimBLEServer *createServer();
+    static NimBLEServer *getServer();
+    static NimBLEAdvertising *getAdvertising();
+    static bool setMTU(uint16_t mtu);
+    static uint16_t getMTU();
+};
+
+#endif
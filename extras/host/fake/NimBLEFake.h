@@ -0,0 +1,129 @@
+/**
+ * @file NimBLEFake.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Simulated centrals for the host replacement of NimBLE
+ *
+ * @note Characteristic callbacks are executed in the calling thread,
+ *       one at a time, as the BLE host task would do.
+ *       Notifications go to a sink function.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_NIMBLEFAKE_H__
+#define __FAKE_NIMBLEFAKE_H__
+
+#include "NimBLEDevice.h"
+#include <functional>
+
+/**
+ * @brief Receiver of notifications
+ *
+ * @note Called from the notifying thread. Return false
+ *       to simulate a peer out of transmission buffers.
+ */
+typedef ::std::function<bool(uint16_t connHandle, const uint8_t *data, size_t size)> NimBLEFakeNotifySink_t;
+
+/**
+ * @brief Simulated centrals
+ *
+ */
+class NimBLEFake
+{
+public:
+    /**
+     * @brief Connect a simulated central
+     *
+     * @param mtu Negotiated ATT MTU
+     * @param connHandle Connection handle, or BLE_HS_CONN_HANDLE_NONE to pick one
+     * @return uint16_t Connection handle, or BLE_HS_CONN_HANDLE_NONE
+     *                  if there is no server or @p connHandle is in use.
+     */
+    static uint16_t connect(uint16_t mtu = 247, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+
+    /**
+     * @brief Disconnect a simulated central
+     *
+     * @note Subscriptions are cancelled first, as NimBLE does
+     *
+     * @param connHandle Connection handle
+     * @return true On success
+     * @return false If not connected
+     */
+    static bool disconnect(uint16_t connHandle);
+
+    /**
+     * @brief Check if a simulated central is connected
+     *
+     * @param connHandle Connection handle
+     * @return true If connected
+     * @return false Otherwise
+     */
+    static bool isConnected(uint16_t connHandle);
+
+    /**
+     * @brief Subscribe to notifications or unsubscribe
+     *
+     * @param connHandle Connection handle
+     * @param uuid UUID of a characteristic
+     * @param yesOrNo True to subscribe, false to unsubscribe
+     * @return true On success
+     * @return false If not connected or the characteristic does not exist
+     */
+    static bool subscribe(uint16_t connHandle, const char *uuid, bool yesOrNo = true);
+
+    /**
+     * @brief Write to a characteristic
+     *
+     * @note Returns when the onWrite() callback returns
+     *
+     * @param connHandle Connection handle
+     * @param uuid UUID of a characteristic
+     * @param data Bytes to write
+     * @param size Count of bytes to write
+     * @return true On success
+     * @return false If not connected or the characteristic does not exist
+     */
+    static bool write(uint16_t connHandle, const char *uuid, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Set the receiver of notifications
+     *
+     * @param sink Receiver, or null to accept and discard notifications
+     */
+    static void onNotify(NimBLEFakeNotifySink_t sink);
+
+    /**
+     * @brief Deliver disconnections requested by the server
+     *
+     * @note Called by connect(), subscribe() and write(), too
+     *
+     * @return size_t Count of delivered disconnections
+     */
+    static size_t processEvents();
+
+    /**
+     * @brief Get the time spent in callbacks
+     *
+     * @note Includes time blocked in callbacks, for example,
+     *       until previous data is consumed
+     *
+     * @return uint64_t Total time in microseconds
+     */
+    static uint64_t getBusyMicros();
+
+    /**
+     * @brief Deliver a notification to the sink
+     *
+     * @note For internal use
+     */
+    static bool deliver(uint16_t connHandle, const uint8_t *data, size_t size);
+
+private:
+    static void closeConnection(NimBLEServer *pServer, uint16_t connHandle, int reason);
+    static NimBLECharacteristic *find(NimBLEServer *pServer, const char *uuid);
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file Print.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino Print class
+ *
+ * @note Just the subset used by this library and the host tools.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_PRINT_H__
+#define __FAKE_PRINT_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdarg>
+#include <cstdio>
+#include "WString.h"
+
+class Print
+{
+public:
+    virtual ~Print() {};
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t count = 0;
+        while (size--)
+            count += write(*buffer++);
+        return count;
+    };
+    size_t write(const char *str)
+    {
+        return (str) ? write((const uint8_t *)str, strlen(str)) : 0;
+    };
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); };
+    virtual int availableForWrite() { return 0; };
+    virtual void flush() {};
+
+    size_t print(const char *str) { return write(str); };
+    size_t print(const String &str) { return write(str.c_str()); };
+    size_t print(char c) { return write((uint8_t)c); };
+    size_t print(long n) { return printf("%ld", n); };
+    size_t print(unsigned long n) { return printf("%lu", n); };
+    size_t print(int n) { return print((long)n); };
+    size_t print(unsigned int n) { return print((unsigned long)n); };
+    size_t print(double n) { return printf("%.2f", n); };
+    size_t println() { return write("\r\n"); };
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); };
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int size = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (size < 0)
+            return 0;
+        if ((size_t)size < sizeof(buffer))
+            return write((const uint8_t *)buffer, size);
+        char *large = new char[size + 1];
+        va_start(args, format);
+        vsnprintf(large, size + 1, format, args);
+        va_end(args);
+        size_t result = write((const uint8_t *)large, size);
+        delete[] large;
+        return result;
+    };
+};
+
+#endif
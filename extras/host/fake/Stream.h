@@ -0,0 +1,44 @@
+/**
+ * @file Stream.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino Stream class
+ *
+ * @note Just the subset used by this library and the host tools.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_STREAM_H__
+#define __FAKE_STREAM_H__
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; };
+    unsigned long getTimeout() const { return _timeout; };
+
+    virtual size_t readBytes(char *buffer, size_t length);
+    virtual size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); };
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length)
+    {
+        return readBytesUntil(terminator, (char *)buffer, length);
+    };
+    virtual String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long _timeout = 1000;
+    unsigned long _startMillis = 0;
+    int timedRead();
+};
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file WString.h
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Host replacement of the Arduino String class
+ *
+ * @note Just the subset used by this library and the host tools.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __FAKE_WSTRING_H__
+#define __FAKE_WSTRING_H__
+
+#include <string>
+#include <cstddef>
+
+class String
+{
+public:
+    String() {};
+    String(const char *str) : text(str ? str : "") {};
+    bool reserve(size_t size)
+    {
+        text.reserve(size);
+        return true;
+    };
+    bool concat(const char *str, size_t size)
+    {
+        text.append(str, size);
+        return true;
+    };
+    bool concat(char c)
+    {
+        text.push_back(c);
+        return true;
+    };
+    const char *c_str() const { return text.c_str(); };
+    size_t length() const { return text.size(); };
+    bool operator==(const char *str) const { return text == str; };
+
+private:
+    ::std::string text;
+};
+
+#endif
@@ -0,0 +1,577 @@
+/**
+ * @file nus_loadgen.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Multi-peer load generator for the Nordic UART Service in a host computer
+ *
+ * @note Each simulated central runs in its own thread. Callbacks are executed
+ *       one at a time, as the BLE host task would do.
+ *       See README.md for build instructions.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <NimBLEFake.h>
+#include "NuProfile.hpp"
+#include "NuSerial.hpp"
+#include "NuPacket.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+#define RX_CHARACTERISTIC_UUID "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+#define TX_CHARACTERISTIC_UUID "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+
+typedef ::std::chrono::steady_clock::time_point time_point_t;
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+static const char *usage =
+    "Usage: nus_loadgen [options]\n"
+    "Options:\n"
+    "  --target stream|packet   Service to load (default: stream, one session per peer)\n"
+    "  --peers <count>          Simulated centrals (default: 3)\n"
+    "  --duration <seconds>     Length of the test (default: 5)\n"
+    "  --mtu <min>[-<max>]      ATT MTU of each connection, at random (default: 247)\n"
+    "  --size <min>[-<max>]     Bytes per write, limited to MTU-3 (default: 20-244)\n"
+    "  --dist uniform|exp|bimodal  Distribution of write sizes (default: uniform)\n"
+    "  --rate <writes/s>        Writes per second of each peer, 0 for no limit (default: 0)\n"
+    "  --churn <events/s>       Unsubscribe and subscribe again, per peer (default: 0)\n"
+    "  --storm <seconds>        Disconnect all peers at once every <seconds> (default: never)\n"
+    "  --rx-buffer <bytes>      Receive buffer size (stream target, default: 0)\n"
+    "  --app-delay <us>         Application processing time per read (default: 0)\n"
+    "  --echo                   Send received data back\n"
+    "  --tx-fail <percent>      Notifications failing for lack of buffers (default: 0)\n"
+    "  --seed <number>          Seed of random numbers (default: 1)\n"
+    "  --csv                    Print results as a single CSV line\n";
+
+static ::std::string target = "stream";
+static unsigned int peerCount = 3;
+static double duration = 5.0;
+static unsigned int minMTU = 247;
+static unsigned int maxMTU = 247;
+static unsigned int minSize = 20;
+static unsigned int maxSize = 244;
+static ::std::string distribution = "uniform";
+static double writeRate = 0;
+static double churnRate = 0;
+static double stormPeriod = 0;
+static size_t rxBufferSize = 0;
+static unsigned int appDelayMicros = 0;
+static bool echo = false;
+static unsigned int txFailPercent = 0;
+static unsigned int seed = 1;
+static bool csv = false;
+
+static bool parseRange(const char *text, unsigned int &min, unsigned int &max)
+{
+    char *end;
+    min = strtoul(text, &end, 10);
+    max = min;
+    if (*end == '-')
+        max = strtoul(end + 1, &end, 10);
+    return (*end == '\0') && (min <= max);
+}
+
+static bool parseOptions(int argc, char *argv[])
+{
+    for (int index = 1; index < argc; index++)
+    {
+        const char *option = argv[index];
+        const char *value = (index + 1 < argc) ? argv[index + 1] : nullptr;
+        if (strcmp(option, "--echo") == 0)
+            echo = true;
+        else if (strcmp(option, "--csv") == 0)
+            csv = true;
+        else if (!value)
+            return false;
+        else
+        {
+            index++;
+            if (strcmp(option, "--target") == 0)
+                target = value;
+            else if (strcmp(option, "--peers") == 0)
+                peerCount = atoi(value);
+            else if (strcmp(option, "--duration") == 0)
+                duration = atof(value);
+            else if (strcmp(option, "--mtu") == 0)
+            {
+                if (!parseRange(value, minMTU, maxMTU) || (minMTU < 23) || (maxMTU > 517))
+                    return false;
+            }
+            else if (strcmp(option, "--size") == 0)
+            {
+                if (!parseRange(value, minSize, maxSize) || (minSize == 0))
+                    return false;
+            }
+            else if (strcmp(option, "--dist") == 0)
+                distribution = value;
+            else if (strcmp(option, "--rate") == 0)
+                writeRate = atof(value);
+            else if (strcmp(option, "--churn") == 0)
+                churnRate = atof(value);
+            else if (strcmp(option, "--storm") == 0)
+                stormPeriod = atof(value);
+            else if (strcmp(option, "--rx-buffer") == 0)
+                rxBufferSize = atoi(value);
+            else if (strcmp(option, "--app-delay") == 0)
+                appDelayMicros = atoi(value);
+            else if (strcmp(option, "--tx-fail") == 0)
+                txFailPercent = atoi(value);
+            else if (strcmp(option, "--seed") == 0)
+                seed = atoi(value);
+            else
+                return false;
+        }
+    }
+    return (peerCount > 0) && (duration > 0) && (writeRate >= 0) && (churnRate >= 0) &&
+           (stormPeriod >= 0) && (txFailPercent <= 100) &&
+           ((target == "stream") || (target == "packet")) &&
+           ((distribution == "uniform") || (distribution == "exp") || (distribution == "bimodal"));
+}
+
+//-----------------------------------------------------------------------------
+// Accounting
+//-----------------------------------------------------------------------------
+
+// Traffic of a single subscription
+typedef struct
+{
+    uint64_t writtenBytes;
+    uint64_t consumedBytes;
+    // End offset and time of writes not consumed yet
+    ::std::deque<::std::pair<uint64_t, time_point_t>> pending;
+} ConnectionStats_t;
+
+// Note: unread data may be discarded when a peer subscribes again,
+// so each subscription is accounted apart (connection handle and generation)
+typedef ::std::pair<uint16_t, uint32_t> SubscriptionKey_t;
+
+static ::std::mutex statsMutex;
+static ::std::map<SubscriptionKey_t, ConnectionStats_t> connections;
+static ::std::map<uint16_t, uint32_t> generations;
+static NuSCommandProfiler latency;
+static ::std::atomic<uint64_t> writeCount{0};
+static ::std::atomic<uint64_t> failedWriteCount{0};
+static ::std::atomic<uint64_t> connectCount{0};
+static ::std::atomic<uint64_t> churnCount{0};
+static ::std::atomic<uint64_t> stormCount{0};
+static ::std::atomic<uint64_t> echoedBytes{0};
+static ::std::atomic<uint64_t> notEchoedBytes{0};
+static ::std::atomic<uint64_t> notifiedBytes{0};
+static ::std::atomic<uint64_t> failedNotifyCount{0};
+
+static uint32_t getGeneration(uint16_t connHandle)
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    return generations[connHandle];
+}
+
+static void newGeneration(uint16_t connHandle)
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    generations[connHandle]++;
+}
+
+static void accountWrite(uint16_t connHandle, size_t size, time_point_t startTime)
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    ConnectionStats_t &stats = connections[{connHandle, generations[connHandle]}];
+    stats.writtenBytes += size;
+    stats.pending.push_back({stats.writtenBytes, startTime});
+}
+
+static void cancelWrite(uint16_t connHandle, size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    ConnectionStats_t &stats = connections[{connHandle, generations[connHandle]}];
+    stats.writtenBytes -= size;
+    stats.pending.pop_back();
+}
+
+static void accountRead(uint16_t connHandle, uint32_t generation, size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    auto entry = connections.find({connHandle, generation});
+    if (entry == connections.end())
+        return;
+    ConnectionStats_t &stats = entry->second;
+    stats.consumedBytes += size;
+    while (!stats.pending.empty() && (stats.pending.front().first <= stats.consumedBytes))
+    {
+        latency.stop("delivery", stats.pending.front().second);
+        stats.pending.pop_front();
+    }
+}
+
+static uint64_t getConsumedBytes()
+{
+    uint64_t result = 0;
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    for (auto &entry : connections)
+        result += entry.second.consumedBytes;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Application side
+//-----------------------------------------------------------------------------
+
+static ::std::atomic<bool> running{true};
+static ::std::vector<::std::thread> appThreads;
+static ::std::mutex appThreadsMutex;
+static ::std::set<NordicUARTSession *> sessions;
+
+static void processData(
+    uint16_t connHandle,
+    uint32_t generation,
+    const uint8_t *data,
+    size_t size,
+    NordicUARTSession *session)
+{
+    accountRead(connHandle, generation, size);
+    if (appDelayMicros)
+        ::std::this_thread::sleep_for(::std::chrono::microseconds(appDelayMicros));
+    if (echo)
+    {
+        size_t sent = (session) ? session->write(data, size) : NuPacket.write(connHandle, data, size);
+        echoedBytes += sent;
+        notEchoedBytes += size - sent;
+    }
+}
+
+static void sessionLoop(NordicUARTSession *session)
+{
+    // Note: a session object is reused for the next peer as soon as
+    // the previous one unsubscribes, so there is a single reader
+    // for each session object that follows its current peer.
+    // Unread data of a previous peer is kept until reuse.
+    uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint32_t generation = 0;
+    uint8_t buffer[512];
+    session->setTimeout(20);
+    while (running)
+    {
+        uint16_t currentConnHandle = session->getConnHandle();
+        if (currentConnHandle != BLE_HS_CONN_HANDLE_NONE)
+        {
+            connHandle = currentConnHandle;
+            generation = getGeneration(connHandle);
+        }
+        size_t count = session->readSome(buffer, sizeof(buffer));
+        if (count)
+            processData(connHandle, generation, buffer, count, session);
+        else if (!session->isConnected())
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+    }
+}
+
+static void startTarget()
+{
+    NimBLEDevice::init("nus_loadgen");
+    NimBLEDevice::setMTU(517);
+    if (target == "stream")
+    {
+        NuSerial.useSessions(true);
+        NuSerial.setRxBufferSize(rxBufferSize);
+        NuSerial.start();
+        appThreads.push_back(::std::thread(
+            []()
+            {
+                while (running)
+                {
+                    NordicUARTSession *session = NuSerial.acceptSession(50);
+                    if (session && sessions.insert(session).second)
+                    {
+                        ::std::lock_guard<::std::mutex> lock(appThreadsMutex);
+                        appThreads.push_back(::std::thread(sessionLoop, session));
+                    }
+                }
+            }));
+    }
+    else
+    {
+        NuPacket.start();
+        appThreads.push_back(::std::thread(
+            []()
+            {
+                while (running)
+                {
+                    size_t size;
+                    uint16_t connHandle;
+                    const uint8_t *data = NuPacket.read(size, connHandle);
+                    // Note: packets are consumed before the write returns,
+                    // so they belong to the current subscription
+                    if (data)
+                        processData(connHandle, getGeneration(connHandle), data, size, nullptr);
+                }
+            }));
+    }
+}
+
+static void stopTarget()
+{
+    running = false;
+    if (target == "stream")
+        NuSerial.stop();
+    else
+        NuPacket.stop();
+    NimBLEFake::processEvents();
+    // Note: the acceptor thread may add threads until it is joined
+    appThreads.front().join();
+    ::std::lock_guard<::std::mutex> lock(appThreadsMutex);
+    for (size_t index = 1; index < appThreads.size(); index++)
+        appThreads[index].join();
+}
+
+//-----------------------------------------------------------------------------
+// Simulated centrals
+//-----------------------------------------------------------------------------
+
+static ::std::atomic<uint16_t> lastConnHandle{0};
+static ::std::atomic<uint32_t> stormEpoch{0};
+
+static uint16_t connectPeer(::std::mt19937 &random)
+{
+    // Note: connection handles are not reused, so late reads are
+    // accounted for the right connection
+    uint16_t mtu = ::std::uniform_int_distribution<unsigned int>(minMTU, maxMTU)(random);
+    uint16_t connHandle = NimBLEFake::connect(mtu, ++lastConnHandle);
+    if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+    {
+        connectCount++;
+        NimBLEFake::subscribe(connHandle, TX_CHARACTERISTIC_UUID, true);
+    }
+    return connHandle;
+}
+
+static size_t nextWriteSize(::std::mt19937 &random, uint16_t connHandle)
+{
+    size_t size;
+    if (distribution == "exp")
+    {
+        ::std::exponential_distribution<double> exp(1.0 / (((maxSize - minSize) / 4.0) + 1));
+        size = minSize + (size_t)exp(random);
+    }
+    else if (distribution == "bimodal")
+        size = (::std::uniform_int_distribution<unsigned int>(0, 4)(random) == 0) ? maxSize : minSize;
+    else
+        size = ::std::uniform_int_distribution<unsigned int>(minSize, maxSize)(random);
+    size_t limit = NimBLEDevice::getServer()->getPeerMTU(connHandle) - 3;
+    if (size > maxSize)
+        size = maxSize;
+    return (size > limit) ? limit : size;
+}
+
+static void centralLoop(unsigned int index, time_point_t endTime)
+{
+    ::std::mt19937 random(seed + index);
+    ::std::exponential_distribution<double> churnInterval((churnRate > 0) ? churnRate : 1.0);
+    uint8_t data[517];
+    for (size_t offset = 0; offset < sizeof(data); offset++)
+        data[offset] = (uint8_t)(index + offset);
+
+    uint16_t connHandle = connectPeer(random);
+    uint32_t epoch = stormEpoch;
+    auto now = ::std::chrono::steady_clock::now();
+    auto nextWriteTime = now;
+    auto nextChurnTime = now + ::std::chrono::microseconds((uint64_t)(churnInterval(random) * 1e6));
+    while (now < endTime)
+    {
+        if (epoch != stormEpoch)
+        {
+            // Disconnection storm
+            epoch = stormEpoch;
+            NimBLEFake::disconnect(connHandle);
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(::std::uniform_int_distribution<int>(0, 20)(random)));
+            connHandle = connectPeer(random);
+        }
+        else if ((churnRate > 0) && (now >= nextChurnTime))
+        {
+            churnCount++;
+            NimBLEFake::subscribe(connHandle, TX_CHARACTERISTIC_UUID, false);
+            newGeneration(connHandle);
+            NimBLEFake::subscribe(connHandle, TX_CHARACTERISTIC_UUID, true);
+            nextChurnTime = now + ::std::chrono::microseconds((uint64_t)(churnInterval(random) * 1e6));
+        }
+        else if (!NimBLEFake::isConnected(connHandle))
+            // Disconnected by the server
+            connHandle = connectPeer(random);
+        else
+        {
+            size_t size = nextWriteSize(random, connHandle);
+            auto startTime = ::std::chrono::steady_clock::now();
+            // Note: accounted before writing because data may be consumed
+            // before write() returns
+            accountWrite(connHandle, size, startTime);
+            if (NimBLEFake::write(connHandle, RX_CHARACTERISTIC_UUID, data, size))
+            {
+                latency.stop("write", startTime);
+                writeCount++;
+            }
+            else
+            {
+                cancelWrite(connHandle, size);
+                failedWriteCount++;
+            }
+        }
+        if (writeRate > 0)
+        {
+            nextWriteTime += ::std::chrono::microseconds((uint64_t)(1e6 / writeRate));
+            ::std::this_thread::sleep_until(nextWriteTime);
+        }
+        now = ::std::chrono::steady_clock::now();
+    }
+    NimBLEFake::disconnect(connHandle);
+}
+
+static bool onNotify(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    if (txFailPercent > 0)
+    {
+        static thread_local ::std::mt19937 random(seed);
+        if (::std::uniform_int_distribution<unsigned int>(1, 100)(random) <= txFailPercent)
+        {
+            failedNotifyCount++;
+            return false;
+        }
+    }
+    notifiedBytes += size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Report
+//-----------------------------------------------------------------------------
+
+static void report(uint64_t elapsedMicros, uint64_t busyMicros)
+{
+    uint64_t writtenBytes = 0;
+    uint64_t consumedBytes = 0;
+    {
+        ::std::lock_guard<::std::mutex> lock(statsMutex);
+        for (auto &entry : connections)
+        {
+            writtenBytes += entry.second.writtenBytes;
+            consumedBytes += entry.second.consumedBytes;
+        }
+    }
+    uint64_t droppedBytes = writtenBytes - consumedBytes;
+    double seconds = elapsedMicros / 1e6;
+    NuSCommandProfile_t profile = latency.get();
+    NuSCommandStats_t &writeStats = profile["write"];
+    NuSCommandStats_t &deliveryStats = profile["delivery"];
+    double busyPercent = (elapsedMicros > 0) ? (100.0 * busyMicros / elapsedMicros) : 0;
+
+    if (csv)
+    {
+        printf("peers,target,mtu_min,mtu_max,size_min,size_max,rate,bytes_per_s,writes_per_s,"
+               "write_p50_us,write_p99_us,delivery_p50_us,delivery_p99_us,dropped_bytes,"
+               "not_echoed_bytes,host_busy_percent\n");
+        printf("%u,%s,%u,%u,%u,%u,%g,%.0f,%.0f,%u,%u,%u,%u,%llu,%llu,%.1f\n",
+               peerCount, target.c_str(), minMTU, maxMTU, minSize, maxSize, writeRate,
+               consumedBytes / seconds, writeCount / seconds,
+               (unsigned int)NuSCommandProfiler::getPercentile(writeStats, 50),
+               (unsigned int)NuSCommandProfiler::getPercentile(writeStats, 99),
+               (unsigned int)NuSCommandProfiler::getPercentile(deliveryStats, 50),
+               (unsigned int)NuSCommandProfiler::getPercentile(deliveryStats, 99),
+               (unsigned long long)droppedBytes,
+               (unsigned long long)notEchoedBytes.load(),
+               busyPercent);
+        return;
+    }
+    printf("target: %s, peers: %u, duration: %.1f s\n", target.c_str(), peerCount, seconds);
+    printf("connections: %llu, subscribe churn: %llu, storms: %llu\n",
+           (unsigned long long)connectCount.load(),
+           (unsigned long long)churnCount.load(),
+           (unsigned long long)stormCount.load());
+    printf("written: %llu bytes in %llu writes (%llu failed)\n",
+           (unsigned long long)writtenBytes,
+           (unsigned long long)writeCount.load(),
+           (unsigned long long)failedWriteCount.load());
+    printf("consumed: %llu bytes, %.0f bytes/s, %.0f writes/s\n",
+           (unsigned long long)consumedBytes, consumedBytes / seconds, writeCount / seconds);
+    printf("dropped: %llu bytes not consumed", (unsigned long long)droppedBytes);
+    if (echo)
+        printf(", %llu bytes not echoed", (unsigned long long)notEchoedBytes.load());
+    printf("\n");
+    if (echo)
+        printf("notified: %llu bytes (%llu failed notifications)\n",
+               (unsigned long long)notifiedBytes.load(),
+               (unsigned long long)failedNotifyCount.load());
+    printf("latency (name,count,avg,max,p50,p99 in us):\n");
+    printf("  %s\n", NuSCommandProfiler::format("write", writeStats).c_str());
+    printf("  %s\n", NuSCommandProfiler::format("delivery", deliveryStats).c_str());
+    printf("host task busy: %llu us (%.1f%%)\n", (unsigned long long)busyMicros, busyPercent);
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (!parseOptions(argc, argv))
+    {
+        fputs(usage, stderr);
+        return 2;
+    }
+    if (peerCount > NUS_MAX_PEERS)
+        fprintf(stderr, "warning: more peers than NUS_MAX_PEERS (%u)\n", (unsigned int)NUS_MAX_PEERS);
+
+    NimBLEFake::onNotify(onNotify);
+    startTarget();
+    latency.enable(true);
+
+    // Run
+    auto startTime = ::std::chrono::steady_clock::now();
+    auto endTime = startTime + ::std::chrono::microseconds((uint64_t)(duration * 1e6));
+    uint64_t startBusyMicros = NimBLEFake::getBusyMicros();
+    ::std::vector<::std::thread> centrals;
+    for (unsigned int index = 0; index < peerCount; index++)
+        centrals.push_back(::std::thread(centralLoop, index, endTime));
+    if (stormPeriod > 0)
+    {
+        auto stormTime = startTime + ::std::chrono::microseconds((uint64_t)(stormPeriod * 1e6));
+        while (stormTime < endTime)
+        {
+            ::std::this_thread::sleep_until(stormTime);
+            stormEpoch++;
+            stormCount++;
+            stormTime += ::std::chrono::microseconds((uint64_t)(stormPeriod * 1e6));
+        }
+    }
+    for (auto &central : centrals)
+        central.join();
+    uint64_t elapsedMicros = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                                 ::std::chrono::steady_clock::now() - startTime)
+                                 .count();
+    uint64_t busyMicros = NimBLEFake::getBusyMicros() - startBusyMicros;
+
+    // Let the application consume pending data
+    uint64_t consumedBytes;
+    do
+    {
+        consumedBytes = getConsumedBytes();
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+    } while (consumedBytes != getConsumedBytes());
+    stopTarget();
+
+    report(elapsedMicros, busyMicros);
+    NimBLEDevice::deinit(true);
+    return 0;
+}
@@ -0,0 +1,365 @@
+/**
+ * @file nus_replay.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Replay a traffic capture of the Nordic UART Service in a host computer
+ *
+ * @note Writes and subscriptions are fed to the service by simulated centrals
+ *       with the original packet boundaries, connection handles and ATT MTU,
+ *       one at a time, as the BLE host task would do.
+ *       See README.md for build instructions and NuCapture.hpp for
+ *       the capture format.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <NimBLEFake.h>
+#include "NuCapture.hpp"
+#include "NuProfile.hpp"
+#include "NuSerial.hpp"
+#include "NuPacket.hpp"
+#include "NuATCommands.hpp"
+#include "NuShellCommands.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#define RX_CHARACTERISTIC_UUID "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+#define TX_CHARACTERISTIC_UUID "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+static const char *usage =
+    "Usage: nus_replay [options] <capture file>\n"
+    "Options:\n"
+    "  --target stream|packet|at|shell  Service to feed (default: stream)\n"
+    "  --speed <factor>  1 for original timing (default), 10 for ten times faster,\n"
+    "                    0 for as fast as possible\n"
+    "  --mtu <bytes>     ATT MTU of peers not found in subscription records (default: 247)\n"
+    "  --echo            Send received data back (stream and packet targets)\n"
+    "  --verify          Compare notifications to the captured ones\n";
+
+static ::std::string target = "stream";
+static double speed = 1.0;
+static uint16_t defaultMTU = 247;
+static bool echo = false;
+static bool verify = false;
+
+//-----------------------------------------------------------------------------
+// Target services
+//-----------------------------------------------------------------------------
+
+static NordicUARTService *pService = nullptr;
+static ::std::atomic<bool> running{true};
+static ::std::atomic<uint64_t> consumedBytes{0};
+static ::std::thread consumer;
+
+static void registerCommands()
+{
+    // Register the AT or shell commands of your application here,
+    // so replies match the captured ones. For example:
+    // NuShellCommands.on("help", [](NuCommandLine_t &commandLine) {...});
+}
+
+static bool startTarget()
+{
+    if (target == "stream")
+    {
+        pService = &NuSerial;
+        NuSerial.setTimeout(20);
+        NuSerial.start();
+        consumer = ::std::thread(
+            []()
+            {
+                uint8_t buffer[512];
+                while (running)
+                {
+                    size_t count = NuSerial.readSome(buffer, sizeof(buffer));
+                    consumedBytes += count;
+                    if (echo && count)
+                        NuSerial.write(buffer, count);
+                }
+            });
+    }
+    else if (target == "packet")
+    {
+        pService = &NuPacket;
+        NuPacket.start();
+        consumer = ::std::thread(
+            []()
+            {
+                while (running)
+                {
+                    size_t size;
+                    uint16_t connHandle;
+                    const uint8_t *data = NuPacket.read(size, connHandle);
+                    if (data)
+                    {
+                        consumedBytes += size;
+                        if (echo)
+                            NuPacket.write(connHandle, data, size);
+                    }
+                }
+            });
+    }
+    else if (target == "at")
+    {
+        pService = &NuATCommands;
+        registerCommands();
+        NuATCommands.start();
+    }
+    else if (target == "shell")
+    {
+        pService = &NuShellCommands;
+        registerCommands();
+        NuShellCommands.start();
+    }
+    else
+        return false;
+    return true;
+}
+
+static void stopTarget()
+{
+    running = false;
+    pService->stop();
+    NimBLEFake::processEvents();
+    if (consumer.joinable())
+        consumer.join();
+}
+
+//-----------------------------------------------------------------------------
+// Notifications
+//-----------------------------------------------------------------------------
+
+static ::std::mutex notifyMutex;
+static ::std::map<uint16_t, ::std::vector<uint8_t>> notified;
+static ::std::map<uint16_t, ::std::vector<uint8_t>> captured;
+static uint64_t notifiedBytes = 0;
+static uint64_t notifyCount = 0;
+
+static bool onNotify(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(notifyMutex);
+    notifyCount++;
+    notifiedBytes += size;
+    if (verify)
+        notified[connHandle].insert(notified[connHandle].end(), data, data + size);
+    return true;
+}
+
+static bool verifyNotifications()
+{
+    bool result = true;
+    ::std::lock_guard<::std::mutex> lock(notifyMutex);
+    ::std::set<uint16_t> peers;
+    for (auto &entry : captured)
+        peers.insert(entry.first);
+    for (auto &entry : notified)
+        peers.insert(entry.first);
+    for (uint16_t connHandle : peers)
+    {
+        const ::std::vector<uint8_t> &expected = captured[connHandle];
+        const ::std::vector<uint8_t> &actual = notified[connHandle];
+        size_t offset = 0;
+        while ((offset < expected.size()) && (offset < actual.size()) && (expected[offset] == actual[offset]))
+            offset++;
+        if ((offset < expected.size()) || (offset < actual.size()))
+        {
+            printf(
+                "verify: peer %u differs at byte %zu (captured %zu bytes, replayed %zu bytes)\n",
+                connHandle, offset, expected.size(), actual.size());
+            result = false;
+        }
+    }
+    if (result)
+        printf("verify: notifications match\n");
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Replay
+//-----------------------------------------------------------------------------
+
+static uint16_t ensureConnected(uint16_t connHandle, uint16_t mtu)
+{
+    if (!NimBLEFake::isConnected(connHandle))
+        NimBLEFake::connect(mtu, connHandle);
+    return connHandle;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *fileName = nullptr;
+    for (int index = 1; index < argc; index++)
+    {
+        if ((strcmp(argv[index], "--target") == 0) && (index + 1 < argc))
+            target = argv[++index];
+        else if ((strcmp(argv[index], "--speed") == 0) && (index + 1 < argc))
+            speed = atof(argv[++index]);
+        else if ((strcmp(argv[index], "--mtu") == 0) && (index + 1 < argc))
+            defaultMTU = atoi(argv[++index]);
+        else if (strcmp(argv[index], "--echo") == 0)
+            echo = true;
+        else if (strcmp(argv[index], "--verify") == 0)
+            verify = true;
+        else if ((argv[index][0] != '-') && !fileName)
+            fileName = argv[index];
+        else
+        {
+            fputs(usage, stderr);
+            return 2;
+        }
+    }
+    if (!fileName || (speed < 0))
+    {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    // Load the capture
+    ::std::ifstream file(fileName, ::std::ios::binary);
+    ::std::vector<uint8_t> capture(
+        (::std::istreambuf_iterator<char>(file)),
+        ::std::istreambuf_iterator<char>());
+    NuSCaptureReader reader(capture.data(), capture.size());
+    if (!file || !reader.isValid())
+    {
+        fprintf(stderr, "%s: not a capture of the Nordic UART Service\n", fileName);
+        return 1;
+    }
+
+    // Start the service
+    NimBLEDevice::init("nus_replay");
+    NimBLEDevice::setMTU(517);
+    NimBLEFake::onNotify(onNotify);
+    if (!startTarget())
+    {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    // Replay
+    NuSCommandProfiler profiler;
+    NuSCaptureRecord_t record;
+    uint32_t recordCount = 0;
+    uint64_t writtenBytes = 0;
+    uint64_t capturedNotifyCount = 0;
+    uint64_t capturedNotifyBytes = 0;
+    uint32_t maxLagMicros = 0;
+    uint32_t lastTimestamp = 0;
+    auto startTime = ::std::chrono::steady_clock::now();
+    while (reader.next(record))
+    {
+        recordCount++;
+        lastTimestamp = record.timestamp;
+        if (record.event == NUS_CAPTURE_NOTIFY)
+        {
+            // Not replayed, but expected
+            capturedNotifyCount++;
+            capturedNotifyBytes += record.size;
+            if (verify)
+            {
+                ::std::lock_guard<::std::mutex> lock(notifyMutex);
+                captured[record.connHandle].insert(
+                    captured[record.connHandle].end(),
+                    record.data,
+                    record.data + record.size);
+            }
+            continue;
+        }
+
+        if (speed > 0)
+        {
+            auto dueTime = startTime + ::std::chrono::microseconds((uint64_t)(record.timestamp / speed));
+            auto now = ::std::chrono::steady_clock::now();
+            if (now < dueTime)
+                ::std::this_thread::sleep_until(dueTime);
+            else
+            {
+                uint64_t lag = ::std::chrono::duration_cast<::std::chrono::microseconds>(now - dueTime).count();
+                if (lag > maxLagMicros)
+                    maxLagMicros = (lag > UINT32_MAX) ? UINT32_MAX : lag;
+            }
+        }
+
+        switch (record.event)
+        {
+        case NUS_CAPTURE_SUBSCRIBE:
+        {
+            uint16_t mtu = (record.size >= 2) ? (record.data[0] | (record.data[1] << 8)) : defaultMTU;
+            ensureConnected(record.connHandle, mtu);
+            NimBLEFake::subscribe(record.connHandle, TX_CHARACTERISTIC_UUID, true);
+            break;
+        }
+        case NUS_CAPTURE_UNSUBSCRIBE:
+            // Note: NimBLE unsubscribes peers on disconnection
+            NimBLEFake::disconnect(record.connHandle);
+            break;
+        case NUS_CAPTURE_WRITE:
+        {
+            ensureConnected(record.connHandle, defaultMTU);
+            auto writeTime = NuSCommandProfiler::start();
+            NimBLEFake::write(record.connHandle, RX_CHARACTERISTIC_UUID, record.data, record.size);
+            profiler.stop("onWrite", writeTime);
+            writtenBytes += record.size;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    auto endTime = ::std::chrono::steady_clock::now();
+
+    // Let the application consume pending data
+    if (consumer.joinable())
+    {
+        auto deadline = ::std::chrono::steady_clock::now() + ::std::chrono::seconds(2);
+        while ((consumedBytes < writtenBytes) && (::std::chrono::steady_clock::now() < deadline))
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+    }
+    // Let pending replies go out
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+    stopTarget();
+
+    // Report
+    if (reader.next(record) || (recordCount == 0))
+        printf("warning: capture is empty or truncated\n");
+    uint64_t elapsedMicros = ::std::chrono::duration_cast<::std::chrono::microseconds>(endTime - startTime).count();
+    printf("target: %s, speed: %g\n", target.c_str(), speed);
+    printf("records: %u, captured time: %u us, replay time: %llu us\n",
+           (unsigned int)recordCount, (unsigned int)lastTimestamp, (unsigned long long)elapsedMicros);
+    printf("written: %llu bytes, %.0f bytes/s\n",
+           (unsigned long long)writtenBytes,
+           (elapsedMicros > 0) ? (writtenBytes * 1e6 / elapsedMicros) : 0.0);
+    if (consumer.joinable() || (target == "stream") || (target == "packet"))
+        printf("consumed: %llu bytes\n", (unsigned long long)consumedBytes.load());
+    printf("notified: %llu packets, %llu bytes (captured: %llu packets, %llu bytes)\n",
+           (unsigned long long)notifyCount, (unsigned long long)notifiedBytes,
+           (unsigned long long)capturedNotifyCount, (unsigned long long)capturedNotifyBytes);
+    if (speed > 0)
+        printf("max lag behind capture: %u us\n", (unsigned int)maxLagMicros);
+    NuSCommandProfile_t profile = profiler.get();
+    printf("host task (name,count,avg,max,p50,p99 in us): %s\n",
+           (profile.count("onWrite") > 0) ? NuSCommandProfiler::format("onWrite", profile["onWrite"]).c_str() : "none");
+
+    int result = 0;
+    if (verify && !verifyNotifications())
+        result = 1;
+    NimBLEDevice::deinit(true);
+    return result;
+}
@@ -0,0 +1,806 @@
+/**
+ * @file nus_stress.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Multithreaded stress test of the handoff between the BLE host task
+ *        and application tasks
+ *
+ * @note Build with -fsanitize=thread to look for data races.
+ *       Incoming bytes follow a known sequence for each peer,
+ *       so lost, duplicated or corrupted bytes are detected.
+ *       See README.md for build instructions.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <NimBLEFake.h>
+#include "NuSerial.hpp"
+#include "NuPacket.hpp"
+#include "NuWaitSet.hpp"
+#include "NuCompression.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+#define RX_CHARACTERISTIC_UUID "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+#define TX_CHARACTERISTIC_UUID "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define COMPRESSION_CHARACTERISTIC_UUID "6E400005-B5A3-F393-E0A9-E50E24DCCA9E"
+#define RESUME_CHARACTERISTIC_UUID "6E400006-B5A3-F393-E0A9-E50E24DCCA9E"
+
+// Bytes of each peer follow this sequence
+#define SEQUENCE_BYTE(position) ((uint8_t)((position) % 251))
+
+//-----------------------------------------------------------------------------
+// Options and results
+//-----------------------------------------------------------------------------
+
+static const char *usage =
+    "Usage: nus_stress [options]\n"
+    "Options:\n"
+    "  --duration <seconds>  Length of each scenario (default: 2)\n"
+    "  --seed <number>       Seed of random numbers (default: 1)\n";
+
+static double duration = 2.0;
+static unsigned int seed = 1;
+static ::std::atomic<unsigned int> errorCount{0};
+
+static void fail(const char *scenario, const char *what, unsigned long long position)
+{
+    // Report just the first errors
+    if (errorCount++ < 10)
+        printf("%s: %s at byte %llu\n", scenario, what, position);
+}
+
+static ::std::chrono::steady_clock::time_point deadline()
+{
+    return ::std::chrono::steady_clock::now() +
+           ::std::chrono::microseconds((uint64_t)(duration * 1e6));
+}
+
+//-----------------------------------------------------------------------------
+// Simulated centrals
+//-----------------------------------------------------------------------------
+
+// Write the next bytes of the sequence in random sizes
+static uint64_t writeSequence(uint16_t connHandle, uint64_t position, ::std::mt19937 &random)
+{
+    uint8_t data[244];
+    size_t size = ::std::uniform_int_distribution<size_t>(1, sizeof(data))(random);
+    for (size_t index = 0; index < size; index++)
+        data[index] = SEQUENCE_BYTE(position + index);
+    if (NimBLEFake::write(connHandle, RX_CHARACTERISTIC_UUID, data, size))
+        return position + size;
+    return position;
+}
+
+static uint16_t connectAndSubscribe(uint16_t connHandle)
+{
+    connHandle = NimBLEFake::connect(247, connHandle);
+    if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+        NimBLEFake::subscribe(connHandle, TX_CHARACTERISTIC_UUID, true);
+    return connHandle;
+}
+
+//-----------------------------------------------------------------------------
+// Scenario: a single stream, all read methods
+//-----------------------------------------------------------------------------
+
+// Check bytes read from the stream against the sequence
+class SequenceChecker
+{
+public:
+    SequenceChecker(const char *scenario) : scenario(scenario) {};
+
+    void check(const uint8_t *data, size_t size)
+    {
+        for (size_t index = 0; index < size; index++)
+            if (data[index] != SEQUENCE_BYTE(position + index))
+            {
+                fail(scenario, "unexpected byte", position + index);
+                break;
+            }
+        position = position + size;
+    };
+
+    uint64_t position = 0;
+
+private:
+    const char *scenario;
+};
+
+static void stressStream(const char *scenario, size_t rxBufferSize)
+{
+    NuSerial.useSessions(false);
+    NuSerial.setRxBufferSize(rxBufferSize);
+    NuSerial.setTimeout(5);
+    NuSerial.start();
+    ::std::atomic<bool> running{true};
+    ::std::atomic<uint64_t> writtenBytes{0};
+
+    // Another task polling available() meanwhile
+    ::std::thread poller(
+        [&]()
+        {
+            while (running)
+            {
+                int available = NuSerial.available();
+                if ((available < 0) || ((size_t)available > 244 + rxBufferSize))
+                    fail(scenario, "wrong available() result", available);
+            }
+        });
+
+    // Reader
+    ::std::thread reader(
+        [&]()
+        {
+            SequenceChecker checker(scenario);
+            ::std::mt19937 random(seed);
+            uint8_t buffer[300];
+            while (true)
+            {
+                size_t count = 0;
+                switch (random() % 4)
+                {
+                case 0:
+                {
+                    int next = NuSerial.peek();
+                    int c = NuSerial.read();
+                    if (c >= 0)
+                    {
+                        buffer[0] = c;
+                        count = 1;
+                    }
+                    if ((next >= 0) && (next != c))
+                        fail(scenario, "peek() does not match read()", checker.position);
+                    break;
+                }
+                case 1:
+                    count = NuSerial.readBytes(buffer, 1 + (random() % sizeof(buffer)));
+                    break;
+                case 2:
+                    count = NuSerial.readSome(buffer, 1 + (random() % sizeof(buffer)));
+                    break;
+                default:
+                {
+                    int available = NuSerial.available();
+                    if (available > 0)
+                        count = NuSerial.readBytes(buffer, ((size_t)available > sizeof(buffer)) ? sizeof(buffer) : available);
+                    break;
+                }
+                }
+                checker.check(buffer, count);
+                if (!running && (count == 0) && (NuSerial.available() == 0))
+                    break;
+            }
+            if (checker.position != writtenBytes)
+                fail(scenario, "bytes lost", checker.position);
+        });
+
+    // Central
+    ::std::mt19937 random(seed);
+    uint16_t connHandle = connectAndSubscribe(1);
+    auto endTime = deadline();
+    uint64_t position = 0;
+    while (::std::chrono::steady_clock::now() < endTime)
+    {
+        position = writeSequence(connHandle, position, random);
+        writtenBytes = position;
+    }
+    running = false;
+    reader.join();
+    poller.join();
+    NimBLEFake::disconnect(connHandle);
+    NuSerial.stop();
+    NimBLEFake::processEvents();
+    printf("%s: %llu bytes\n", scenario, (unsigned long long)position);
+}
+
+//-----------------------------------------------------------------------------
+// Scenario: sessions, peers coming and going
+//-----------------------------------------------------------------------------
+
+// Wait for a condition, with a limit
+template <typename Predicate>
+static bool waitFor(Predicate predicate)
+{
+    auto limit = ::std::chrono::steady_clock::now() + ::std::chrono::seconds(5);
+    while (!predicate())
+    {
+        if (::std::chrono::steady_clock::now() > limit)
+            return false;
+        ::std::this_thread::sleep_for(::std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+static void stressSessions(const char *scenario, size_t rxBufferSize)
+{
+    NuSerial.useSessions(true);
+    NuSerial.setRxBufferSize(rxBufferSize);
+    size_t capacity = (rxBufferSize > 0) ? rxBufferSize : NUS_SESSION_RX_BUFFER_SIZE;
+    NuSerial.start();
+    ::std::atomic<bool> running{true};
+    ::std::atomic<uint64_t> totalBytes{0};
+    ::std::mutex readersMutex;
+    ::std::vector<::std::thread> readers;
+    // Bytes written by each connection, known at disconnection
+    ::std::map<uint16_t, uint64_t> writtenBytes;
+
+    // Acceptor. A reader for each session, until disconnection.
+    // Note: a session is not reused for another peer
+    // until its reader is aware of the disconnection.
+    ::std::thread acceptor(
+        [&]()
+        {
+            while (running)
+            {
+                NordicUARTSession *session = NuSerial.acceptSession(10);
+                if (!session)
+                    continue;
+                ::std::lock_guard<::std::mutex> lock(readersMutex);
+                readers.push_back(::std::thread(
+                    [&, session]()
+                    {
+                        uint16_t connHandle = session->getConnHandle();
+                        SequenceChecker checker(scenario);
+                        uint8_t buffer[300];
+                        session->setTimeout(5);
+                        size_t count;
+                        do
+                        {
+                            count = session->readSome(buffer, sizeof(buffer));
+                            checker.check(buffer, count);
+                        } while ((count > 0) || session->isConnected());
+                        totalBytes += checker.position;
+                        ::std::lock_guard<::std::mutex> lock(readersMutex);
+                        // Note: the peer may be gone before getConnHandle()
+                        auto written = writtenBytes.find(connHandle);
+                        if (written != writtenBytes.end())
+                        {
+                            if (written->second != checker.position)
+                                fail(scenario, "bytes lost", checker.position);
+                            writtenBytes.erase(written);
+                        }
+                        else if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+                            fail(scenario, "unknown peer", checker.position);
+                    }));
+            }
+        });
+
+    // Centrals.
+    // Note: sessions drop incoming data when their receive buffer is full,
+    // so centrals wait for room before writing.
+    ::std::vector<::std::thread> centrals;
+    auto endTime = deadline();
+    for (unsigned int index = 0; index < NUS_MAX_PEERS; index++)
+        centrals.push_back(::std::thread(
+            [&, index]()
+            {
+                ::std::mt19937 random(seed + index);
+                unsigned int connection = 0;
+                while (::std::chrono::steady_clock::now() < endTime)
+                {
+                    uint16_t connHandle = index + 1 + (NUS_MAX_PEERS * (connection++ % 5000));
+                    if (connectAndSubscribe(connHandle) == BLE_HS_CONN_HANDLE_NONE)
+                        continue;
+                    NordicUARTSession *session = NuSerial.getSession(connHandle);
+                    if (!session)
+                    {
+                        // All sessions are still held by readers of previous peers
+                        NimBLEFake::disconnect(connHandle);
+                        ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+                        continue;
+                    }
+                    uint64_t position = 0;
+                    unsigned int writeCount = ::std::uniform_int_distribution<unsigned int>(1, 200)(random);
+                    while ((writeCount-- > 0) && (::std::chrono::steady_clock::now() < endTime))
+                    {
+                        if (!waitFor([&]()
+                                     { return (size_t)session->available() + 244 <= capacity; }))
+                        {
+                            fail(scenario, "session not read", position);
+                            break;
+                        }
+                        position = writeSequence(connHandle, position, random);
+                    }
+                    if (session->getDroppedByteCount() > 0)
+                        fail(scenario, "dropped bytes", position);
+                    {
+                        ::std::lock_guard<::std::mutex> lock(readersMutex);
+                        writtenBytes[connHandle] = position;
+                    }
+                    NimBLEFake::disconnect(connHandle);
+                }
+            }));
+    for (auto &central : centrals)
+        central.join();
+    running = false;
+    acceptor.join();
+    for (auto &reader : readers)
+        reader.join();
+    NuSerial.stop();
+    NimBLEFake::processEvents();
+    NuSerial.useSessions(false);
+    printf("%s: %llu bytes in %u sessions\n",
+           scenario, (unsigned long long)totalBytes.load(), (unsigned int)readers.size());
+}
+
+// Sessions do not block other peers and are not reused while held
+static void checkSessionIsolation(const char *scenario)
+{
+    NuSerial.useSessions(true);
+    NuSerial.setRxBufferSize(0);
+    NuSerial.start();
+    ::std::mt19937 random(seed);
+
+    // A peer never read. Its writes must not block.
+    uint16_t idle = connectAndSubscribe(1);
+    NordicUARTSession *idleSession = NuSerial.getSession(idle);
+    uint64_t position = 0;
+    while (position + 244 <= NUS_SESSION_RX_BUFFER_SIZE)
+        position = writeSequence(idle, position, random);
+
+    // Another peer is served meanwhile
+    uint16_t busy = connectAndSubscribe(2);
+    NordicUARTSession *session = NuSerial.acceptSession(100);
+    if (session == idleSession)
+        session = NuSerial.acceptSession(100);
+    if (!session || (session->getConnHandle() != busy))
+        fail(scenario, "session not accepted", 0);
+    else
+    {
+        uint64_t written = writeSequence(busy, 0, random);
+        SequenceChecker checker(scenario);
+        uint8_t buffer[300];
+        checker.check(buffer, session->readSome(buffer, sizeof(buffer)));
+        if (checker.position != written)
+            fail(scenario, "bytes lost", checker.position);
+
+        // On overrun, the idle peer is disconnected, so it is aware of the loss
+        while ((position < 4 * NUS_SESSION_RX_BUFFER_SIZE) && NimBLEFake::isConnected(idle))
+        {
+            position = writeSequence(idle, position, random);
+            NimBLEFake::processEvents();
+        }
+        if (NimBLEFake::isConnected(idle))
+            fail(scenario, "overrunning peer not disconnected", position);
+        if (!idleSession ||
+            (idleSession->getDroppedByteCount() == 0) ||
+            ((size_t)idleSession->available() + idleSession->getDroppedByteCount() != position))
+            fail(scenario, "wrong count of dropped bytes", position);
+
+        // A held session is not reused until its holder is aware of the disconnection.
+        // Other sessions are taken first.
+        NimBLEFake::disconnect(idle);
+        NimBLEFake::disconnect(busy);
+        ::std::vector<uint16_t> others;
+        for (uint16_t connHandle = 3; connHandle < 3 + NUS_MAX_PEERS - 1; connHandle++)
+            others.push_back(connectAndSubscribe(connHandle));
+        uint16_t other = connectAndSubscribe(3 + NUS_MAX_PEERS);
+        if (NuSerial.getSession(other) != nullptr)
+            fail(scenario, "held session reused", 0);
+        NimBLEFake::disconnect(other);
+        if (session->isConnected())
+            fail(scenario, "disconnection not reported", 0);
+        other = connectAndSubscribe(4 + NUS_MAX_PEERS);
+        if (NuSerial.getSession(other) != session)
+            fail(scenario, "released session not reused", 0);
+        others.push_back(other);
+
+        // Peers beyond NUS_MAX_PEERS are refused
+        uint16_t extra = connectAndSubscribe(5 + NUS_MAX_PEERS);
+        NimBLEFake::processEvents();
+        if (NimBLEFake::isConnected(extra))
+            fail(scenario, "extra peer not refused", 0);
+        for (uint16_t connHandle : others)
+            NimBLEFake::disconnect(connHandle);
+    }
+    NuSerial.stop();
+    NimBLEFake::processEvents();
+    NuSerial.useSessions(false);
+    printf("%s: done\n", scenario);
+}
+
+//-----------------------------------------------------------------------------
+// Scenario: packets, with read() or a dispatcher thread
+//-----------------------------------------------------------------------------
+
+static void stressPacket(const char *scenario, bool useDispatcher)
+{
+    ::std::mutex positionsMutex;
+    ::std::map<uint16_t, uint64_t> positions;
+    ::std::atomic<uint64_t> totalBytes{0};
+    ::std::atomic<bool> running{true};
+
+    // Packets are whole writes, but they may be lost on unsubscription
+    // or partially consumed by the callback, so each one starts with
+    // its position in the sequence
+    auto check = [&](const uint8_t *data, size_t size, uint16_t connHandle) -> size_t
+    {
+        if (size < 4)
+        {
+            fail(scenario, "short packet", size);
+            return size;
+        }
+        uint32_t start = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        for (size_t index = 4; index < size; index++)
+            if (data[index] != SEQUENCE_BYTE(start + index))
+            {
+                fail(scenario, "unexpected byte", start + index);
+                break;
+            }
+        ::std::lock_guard<::std::mutex> lock(positionsMutex);
+        if (start < positions[connHandle])
+            fail(scenario, "duplicated packet", start);
+        positions[connHandle] = start + size;
+        totalBytes += size;
+        return size;
+    };
+
+    if (useDispatcher)
+        NuPacket.onData(
+            [&](const uint8_t *data, size_t size, uint16_t connHandle) -> size_t
+            {
+                // Do not consume some packets at first, so they are delivered again at resumeData()
+                static thread_local ::std::mt19937 random(seed);
+                if ((random() % 10) == 0)
+                    return 0;
+                return check(data, size, connHandle);
+            },
+            true);
+    NuPacket.start();
+
+    ::std::thread reader;
+    ::std::thread waiter;
+    if (useDispatcher)
+        reader = ::std::thread(
+            [&]()
+            {
+                // Also called while no data is held, which must not deliver it twice
+                while (running)
+                {
+                    NuPacket.resumeData();
+                    ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+                }
+            });
+    else
+    {
+        reader = ::std::thread(
+            [&]()
+            {
+                while (running)
+                {
+                    size_t size;
+                    uint16_t connHandle;
+                    const uint8_t *data = NuPacket.read(size, connHandle);
+                    if (data)
+                        check(data, size, connHandle);
+                }
+            });
+        waiter = ::std::thread(
+            [&]()
+            {
+                // Readability is polled meanwhile
+                NuSWaitSet waitSet;
+                waitSet.add(NuPacket, NUS_WAIT_READABLE);
+                while (running)
+                    waitSet.wait(5);
+            });
+    }
+
+    // Centrals, unsubscribing from time to time
+    ::std::vector<::std::thread> centrals;
+    auto endTime = deadline();
+    for (unsigned int index = 0; index < NUS_MAX_PEERS; index++)
+        centrals.push_back(::std::thread(
+            [&, index]()
+            {
+                ::std::mt19937 random(seed + index);
+                uint16_t connHandle = connectAndSubscribe(index + 1);
+                uint32_t position = 0;
+                while (::std::chrono::steady_clock::now() < endTime)
+                {
+                    if ((random() % 50) == 0)
+                    {
+                        NimBLEFake::disconnect(connHandle);
+                        connectAndSubscribe(connHandle);
+                        continue;
+                    }
+                    uint8_t data[244];
+                    size_t size = ::std::uniform_int_distribution<size_t>(4, sizeof(data))(random);
+                    data[0] = position;
+                    data[1] = position >> 8;
+                    data[2] = position >> 16;
+                    data[3] = position >> 24;
+                    for (size_t offset = 4; offset < size; offset++)
+                        data[offset] = SEQUENCE_BYTE(position + offset);
+                    if (NimBLEFake::write(connHandle, RX_CHARACTERISTIC_UUID, data, size))
+                        position = position + size;
+                }
+                NimBLEFake::disconnect(connHandle);
+            }));
+    for (auto &central : centrals)
+        central.join();
+    running = false;
+    NuPacket.stop();
+    NimBLEFake::processEvents();
+    if (reader.joinable())
+        reader.join();
+    if (waiter.joinable())
+        waiter.join();
+    NuPacket.onData(nullptr);
+    printf("%s: %llu bytes\n", scenario, (unsigned long long)totalBytes.load());
+}
+
+// Bytes not consumed are delivered again at resumeData(), and only then
+static void checkDataResume(const char *scenario)
+{
+    ::std::atomic<unsigned int> deliveries{0};
+    ::std::atomic<bool> consume{false};
+    NuPacket.onData(
+        [&](const uint8_t *data, size_t size, uint16_t connHandle) -> size_t
+        {
+            deliveries++;
+            return consume ? size : 0;
+        },
+        true);
+    NuPacket.start();
+    uint16_t connHandle = connectAndSubscribe(1);
+    uint8_t data[8] = {0};
+    NimBLEFake::write(connHandle, RX_CHARACTERISTIC_UUID, data, sizeof(data));
+    if (!waitFor([&]() { return deliveries == 1; }))
+        fail(scenario, "packet not delivered", deliveries);
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+    if (deliveries != 1)
+        fail(scenario, "delivered again before resumeData()", deliveries);
+    consume = true;
+    NuPacket.resumeData();
+    if (!waitFor([&]() { return deliveries == 2; }))
+        fail(scenario, "not delivered again at resumeData()", deliveries);
+
+    // Nothing held now
+    NuPacket.resumeData();
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+    if (deliveries != 2)
+        fail(scenario, "consumed packet delivered again", deliveries);
+    NimBLEFake::disconnect(connHandle);
+    NuPacket.stop();
+    NimBLEFake::processEvents();
+    NuPacket.onData(nullptr);
+    printf("%s: done\n", scenario);
+}
+
+//-----------------------------------------------------------------------------
+// Scenario: compressed transmission, peer out of buffers from time to time
+//-----------------------------------------------------------------------------
+
+static void stressCompression(const char *scenario)
+{
+    NuSerial.useSessions(false);
+    NuSerial.useCompression(true);
+    NuSerial.start();
+    uint16_t connHandle = connectAndSubscribe(1);
+    uint8_t codec = NUS_COMPRESSION_LZ;
+    NimBLEFake::write(connHandle, COMPRESSION_CHARACTERISTIC_UUID, &codec, 1);
+    NimBLEFake::processEvents();
+
+    // The central decompresses notifications, failing some of them
+    uint64_t received = 0;
+    NuSDecompressor decompressor;
+    ::std::mt19937 random(seed);
+    bool failNotifications = true;
+    NimBLEFake::onNotify(
+        [&](uint16_t, const uint8_t *data, size_t size) -> bool
+        {
+            if (failNotifications && ((random() % 10) == 0))
+                return false;
+            uint8_t output[512];
+            while (size > 0)
+            {
+                size_t count = decompressor.decompress(data, size, output, sizeof(output));
+                for (size_t index = 0; index < count; index++)
+                    if (output[index] != SEQUENCE_BYTE((received + index) / 4))
+                    {
+                        fail(scenario, "unexpected byte", received + index);
+                        break;
+                    }
+                received = received + count;
+            }
+            return true;
+        });
+
+    // Accepted bytes must reach the central, even if not sent at once
+    uint64_t position = 0;
+    uint8_t data[600];
+    auto endTime = deadline();
+    while (::std::chrono::steady_clock::now() < endTime)
+    {
+        size_t size = ::std::uniform_int_distribution<size_t>(1, sizeof(data))(random);
+        for (size_t index = 0; index < size; index++)
+            // Repetitive data, so it is actually compressed
+            data[index] = SEQUENCE_BYTE((position + index) / 4);
+        position = position + NuSerial.write(data, size);
+    }
+    failNotifications = false;
+    // Pending bytes are sent before the next ones
+    for (int attempt = 0; (received < position) && (attempt < 100); attempt++)
+    {
+        data[0] = SEQUENCE_BYTE(position / 4);
+        position = position + NuSerial.write(data, 1);
+    }
+    if (received != position)
+        fail(scenario, "bytes lost", received);
+    NimBLEFake::onNotify(nullptr);
+    NimBLEFake::disconnect(connHandle);
+    NuSerial.stop();
+    NuSerial.useCompression(false);
+    NimBLEFake::processEvents();
+    printf("%s: %llu bytes\n", scenario, (unsigned long long)position);
+}
+
+//-----------------------------------------------------------------------------
+// Scenario: session resumption, another peer meanwhile
+//-----------------------------------------------------------------------------
+
+static void writeResumeRequest(uint16_t connHandle, uint8_t code, uint32_t value)
+{
+    uint8_t request[9] = {code, 0, 0, 0, 0, 0, 0, 0, 0};
+    size_t size = 5;
+    if (code == NUS_RESUME_HELLO)
+        // Zero token and offset: a new session
+        size = 9;
+    else
+    {
+        request[1] = value;
+        request[2] = value >> 8;
+        request[3] = value >> 16;
+        request[4] = value >> 24;
+    }
+    NimBLEFake::write(connHandle, RESUME_CHARACTERISTIC_UUID, request, size);
+}
+
+static void stressResumption(const char *scenario)
+{
+    NuSerial.useSessions(false);
+    NuSerial.useResumption(4096, 30000);
+    NuSerial.start();
+
+    // The resuming peer runs out of transmission buffers from time to time
+    ::std::atomic<uint64_t> received[2];
+    received[0] = 0;
+    received[1] = 0;
+    ::std::atomic<unsigned int> failPercent{10};
+    ::std::mt19937 notifyRandom(seed);
+    NimBLEFake::onNotify(
+        [&](uint16_t connHandle, const uint8_t *data, size_t size) -> bool
+        {
+            unsigned int index = (connHandle == 1) ? 0 : 1;
+            if ((index == 0) && ((notifyRandom() % 100) < failPercent))
+                return false;
+            for (size_t offset = 0; offset < size; offset++)
+                if (data[offset] != SEQUENCE_BYTE(received[index] + offset))
+                {
+                    fail(scenario, "unexpected byte", received[index] + offset);
+                    break;
+                }
+            received[index] += size;
+            return true;
+        });
+    uint16_t resumingPeer = connectAndSubscribe(1);
+    writeResumeRequest(resumingPeer, NUS_RESUME_HELLO, 0);
+    uint16_t otherPeer = connectAndSubscribe(2);
+    NimBLEFake::processEvents();
+
+    // Both peers get the same bytes
+    ::std::mt19937 random(seed);
+    uint64_t position = 0;
+    uint8_t data[300];
+    auto endTime = deadline();
+    while (::std::chrono::steady_clock::now() < endTime)
+    {
+        size_t size = ::std::uniform_int_distribution<size_t>(1, sizeof(data))(random);
+        for (size_t index = 0; index < size; index++)
+            data[index] = SEQUENCE_BYTE(position + index);
+        position = position + NuSerial.write(data, size);
+        writeResumeRequest(resumingPeer, NUS_RESUME_ACK, (uint32_t)received[0]);
+    }
+
+    // Unsent bytes are sent again with no need to write more
+    failPercent = 100;
+    for (size_t index = 0; index < sizeof(data); index++)
+        data[index] = SEQUENCE_BYTE(position + index);
+    position = position + NuSerial.write(data, sizeof(data));
+    failPercent = 0;
+    if (!waitFor([&]() { return received[0] == position; }))
+        fail(scenario, "unsent bytes not sent again", received[0]);
+    if (received[1] != position)
+        fail(scenario, "other peer not served", received[1]);
+
+    // The other peer is served while the resuming peer is away
+    NimBLEFake::disconnect(resumingPeer);
+    NimBLEFake::processEvents();
+    for (size_t index = 0; index < sizeof(data); index++)
+        data[index] = SEQUENCE_BYTE(position + index);
+    position = position + NuSerial.write(data, sizeof(data));
+    if (received[1] != position)
+        fail(scenario, "other peer not served while detached", received[1]);
+
+    // The session expires when the retention buffer gets full,
+    // so other peers are not stalled
+    uint64_t expected = position + 20 * sizeof(data);
+    for (int count = 0; count < 20; count++)
+    {
+        for (size_t index = 0; index < sizeof(data); index++)
+            data[index] = SEQUENCE_BYTE(position + index);
+        position = position + NuSerial.write(data, sizeof(data));
+    }
+    if ((position != expected) || (received[1] != position))
+        fail(scenario, "other peer stalled", received[1]);
+    if (NuSerial.getResumeStats().expiredSessions != 1)
+        fail(scenario, "session not expired", position);
+
+    NimBLEFake::onNotify(nullptr);
+    NimBLEFake::disconnect(otherPeer);
+    NuSerial.stop();
+    NuSerial.useResumption(0);
+    NimBLEFake::processEvents();
+    printf("%s: %llu bytes\n", scenario, (unsigned long long)position);
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    for (int index = 1; index < argc; index++)
+    {
+        if ((strcmp(argv[index], "--duration") == 0) && (index + 1 < argc))
+            duration = atof(argv[++index]);
+        else if ((strcmp(argv[index], "--seed") == 0) && (index + 1 < argc))
+            seed = atoi(argv[++index]);
+        else
+        {
+            fputs(usage, stderr);
+            return 2;
+        }
+    }
+    if (duration <= 0)
+    {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    NimBLEDevice::init("nus_stress");
+    NimBLEDevice::setMTU(517);
+    stressStream("stream", 0);
+    stressStream("stream, receive buffer", 512);
+    checkSessionIsolation("session isolation");
+    stressSessions("sessions", 0);
+    stressSessions("sessions, receive buffer", 2048);
+    stressPacket("packet", false);
+    stressPacket("packet, dispatcher", true);
+    checkDataResume("packet, resumeData()");
+    stressCompression("compression");
+    stressResumption("resumption");
+    NimBLEDevice::deinit(true);
+
+    if (errorCount > 0)
+    {
+        printf("FAILED: %u errors\n", errorCount.load());
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
@@ -9,6 +9,7 @@
 
 #include "NuATCommandsLegacy2.hpp"
 #include <string.h>
+#include <string>
 
 using namespace NuSLegacy2;
 
@@ -27,6 +28,9 @@ public:
     bool bTest = false;
     bool bPrintParams = false;
     bool bPrintCmd = false;
+    int idRequestCount = 0;
+    size_t paramCount = 0;
+    ::std::string nonATText;
 
 public:
     virtual void printATResponse(const char message[]) override
@@ -45,6 +49,7 @@ public:
     {
         if (bPrintCmd)
             Serial.printf("Command: %s\n", commandName);
+        idRequestCount++;
         return id;
     };
 
@@ -63,6 +68,7 @@ public:
                 Serial.printf("Parameter %d: %s\n", count++, param);
         }
         bWrite = true;
+        paramCount = parameters.size();
         return AT_RESULT_OK;
     };
 
@@ -77,6 +83,11 @@ public:
         bTest = true;
     };
 
+    virtual void onNonATCommand(const char text[]) override
+    {
+        nonATText = text;
+    };
+
 public:
     void reset()
     {
@@ -88,6 +99,10 @@ public:
         bTest = false;
         bPrintParams = false;
         bPrintCmd = false;
+        idRequestCount = 0;
+        paramCount = 0;
+        nonATText.clear();
+        invalidateATCommandIdCache();
     };
 
     NuATCommandResult_t test(const char commandLine[])
@@ -96,6 +111,12 @@ public:
         return lastResponse;
     };
 
+    NuATCommandResult_t test(const uint8_t *commandLine, size_t size)
+    {
+        parseCommandLine(commandLine, size);
+        return lastResponse;
+    };
+
     NuATCommandTester()
     {
         setATCallbacks(this);
@@ -157,6 +178,37 @@ void Test_actionFlags(char commandLine[], bool mustExecute, bool mustRead, bool
     testNumber++;
 }
 
+void Test_idCache(char commandLine[], int repeat, int expectedRequestCount)
+{
+    Serial.printf("--Test #%d. Command ID cache for %s\n", testNumber, commandLine);
+    tester.reset();
+    for (int i = 0; i < repeat; i++)
+        tester.test(commandLine);
+    assert_eq<int>(expectedRequestCount, tester.idRequestCount, testNumber);
+    testNumber++;
+}
+
+void Test_binaryParsing(const char commandLine[], size_t size, NuATCommandResult_t expectedResult, size_t expectedParamCount)
+{
+    tester.reset();
+    Serial.printf("--Test #%d. Parsing %u bytes from: %s\n", testNumber, size, commandLine);
+    NuATCommandResult_t actualResult = tester.test((const uint8_t *)commandLine, size);
+    assert_eq<NuATCommandResult_t>(expectedResult, actualResult, testNumber);
+    assert_eq<size_t>(expectedParamCount, tester.paramCount, testNumber);
+    testNumber++;
+}
+
+void Test_nonATCommand(const char commandLine[], size_t size, const char expectedText[])
+{
+    tester.reset();
+    Serial.printf("--Test #%d. Non-AT text from %u bytes\n", testNumber, (unsigned int)size);
+    tester.test((const uint8_t *)commandLine, size);
+    if (tester.nonATText != expectedText)
+        Serial.printf("  --Test #%d failure: expected \"%s\", found \"%s\"\n",
+                      testNumber, expectedText, tester.nonATText.c_str());
+    testNumber++;
+}
+
 void Test_setActionParameters(char commandLine[])
 {
     tester.reset();
@@ -246,19 +298,35 @@ void setup()
     Test_actionFlags("AT&F;&G=99\n", true, false, true, false);
 
     Test_actionFlags("AT&F=1;&G=?\n", false, false, true, true);
+    Test_idCache("AT+ABC\n", 3, 1);
+    Test_idCache("AT+ABC;+ABC;+ABD\n", 2, 2);
+    Test_idCache("AT+A;+B;+C;+D;+E;+F;+G;+H;+I;+J;+K;+L;+M;+N;+O;+P;+Q\n", 2, 18);
+    Test_binaryParsing("AT+F=\"a\0b\",1\n", 14, AT_RESULT_OK, 2);
+    Test_binaryParsing("AT+F=\"a\\\0b\",1\n", 15, AT_RESULT_OK, 2);
+
+    // Test #51
+    Test_binaryParsing("AT+F=1,2\0,3\n", 10, AT_RESULT_OK, 2);
+    Test_binaryParsing("AT+F=1,2,3\n", 8, AT_RESULT_OK, 2);
+    Test_binaryParsing("AT+F=\"abc\"\n", 9, AT_RESULT_ERROR, 0);
+    Test_idCache("AT+ABCDEFGHIJKLMNOPQ\n", 2, 2);
+    Test_nonATCommand("hello world", 5, "hello");
+
+    // Test #56
+    Test_nonATCommand("hello\0world", 11, "hello");
+    Test_nonATCommand("0123456789012345678901234567890123456789012345", 46, "01234567890123456789012345678901234567890");
 
     Serial.println("*****************************************");
     Serial.println(" Non-Automated test (check visually)     ");
     Serial.println("*****************************************");
 
-    // Test #46
+    // Test #58
 
     Test_setActionParameters("AT&F=\"value\"\n");
     Test_setActionParameters("AT&F=1,2,3,4,5\n");
     Test_setActionParameters("AT&F=\"a \\\\ b\"\n");
     Test_setActionParameters("AT&F=\"a \\, b\"\n");
 
-    // Test #50
+    // Test #62
     Test_setActionParameters("AT&F=\"a \\; b\"\n");
     Test_setActionParameters("AT&F=\"a \\\" b\"\n");
     Test_setActionParameters("AT&F=\"a \\\n b\"\n");
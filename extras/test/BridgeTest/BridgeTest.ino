@@ -0,0 +1,327 @@
+/**
+ * @file BridgeTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of the UART bridge
+ *
+ * @note No peer is needed. Incoming data and UARTs are simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include "NuBridge.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedStream : public NordicUARTStream
+{
+public:
+    ::std::mutex sentMutex;
+    ::std::string sent;
+    ::std::vector<size_t> writeSizes;
+
+    // Called from the BLE host task
+    void feed(const char *text)
+    {
+        NimBLEAttValue value((const uint8_t *)text, strlen(text));
+        receive(value);
+    };
+
+    // Instead of notifying peers
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        ::std::lock_guard<::std::mutex> lock(sentMutex);
+        sent.append((const char *)buffer, size);
+        writeSizes.push_back(size);
+        return size;
+    };
+};
+
+class SimulatedUART : public HardwareSerial
+{
+public:
+    ::std::mutex uartMutex;
+    ::std::deque<uint8_t> input;
+    ::std::string output;
+
+    // Bytes arriving from the wire
+    void feed(const char *text)
+    {
+        {
+            ::std::lock_guard<::std::mutex> lock(uartMutex);
+            while (*text)
+                input.push_back((uint8_t)*text++);
+        }
+        received();
+    };
+
+    ::std::string getOutput()
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        return output;
+    };
+
+    virtual int available() override
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        return input.size();
+    };
+
+    virtual int peek() override
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        return input.empty() ? -1 : input.front();
+    };
+
+    virtual int read() override
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        if (input.empty())
+            return -1;
+        int result = input.front();
+        input.pop_front();
+        return result;
+    };
+
+    virtual size_t readBytes(uint8_t *buffer, size_t length) override
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        size_t count = 0;
+        while ((count < length) && !input.empty())
+        {
+            buffer[count++] = input.front();
+            input.pop_front();
+        }
+        return count;
+    };
+
+    virtual size_t readBytes(char *buffer, size_t length) override
+    {
+        return readBytes((uint8_t *)buffer, length);
+    };
+
+    virtual size_t write(uint8_t byte) override
+    {
+        return write(&byte, 1);
+    };
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        ::std::lock_guard<::std::mutex> lock(uartMutex);
+        output.append((const char *)buffer, size);
+        return size;
+    };
+};
+
+void sleepMillis(unsigned int millis)
+{
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(millis));
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_downlink(int index)
+{
+    SimulatedStream ble;
+    SimulatedUART uart1, uart2;
+    NuSBridge bridge(ble);
+    bridge.add(uart1);
+    bridge.add(uart2);
+    bridge.begin();
+    ble.feed("Hello ");
+    ble.feed("world");
+    sleepMillis(200);
+    bridge.end();
+
+    if (uart1.getOutput() != "Hello world")
+        Serial.printf("--Test #%d failed. UART 1 got \"%s\"\n", index, uart1.getOutput().c_str());
+    if (uart2.getOutput() != "Hello world")
+        Serial.printf("--Test #%d failed. UART 2 got \"%s\"\n", index, uart2.getOutput().c_str());
+    NuSBridgeStats_t stats = bridge.getDownlinkStats();
+    if (stats.bytes != 11)
+        Serial.printf("--Test #%d failed. Downlink bytes=%u\n", index, stats.bytes);
+    if (stats.droppedBytes != 0)
+        Serial.printf("--Test #%d failed. Downlink dropped=%u\n", index, stats.droppedBytes);
+}
+
+void Test_batching(int index)
+{
+    SimulatedStream ble;
+    SimulatedUART uart;
+    NuSBridge bridge(ble);
+    bridge.add(uart);
+    bridge.setFlushThresholds(64, 50);
+    bridge.begin();
+
+    // 200 bytes at once: three full batches and a timed flush
+    ::std::string message;
+    for (int i = 0; i < 200; i++)
+        message += (char)('a' + (i % 26));
+    uart.feed(message.c_str());
+    sleepMillis(300);
+    bridge.end();
+
+    if (ble.sent != message)
+        Serial.printf("--Test #%d failed. Data does not match (%u bytes sent)\n", index, (unsigned int)ble.sent.size());
+    for (size_t size : ble.writeSizes)
+        if ((size % 64) != 0 && (size != 8))
+            Serial.printf("--Test #%d failed. Unexpected batch of %u bytes\n", index, (unsigned int)size);
+    NuSBridgeStats_t stats = bridge.getUplinkStats();
+    if (stats.bytes != 200)
+        Serial.printf("--Test #%d failed. Uplink bytes=%u\n", index, stats.bytes);
+    if (stats.fullFlushes == 0)
+        Serial.printf("--Test #%d failed. No full flushes\n", index);
+    if (stats.timedFlushes != 1)
+        Serial.printf("--Test #%d failed. Timed flushes=%u\n", index, stats.timedFlushes);
+}
+
+void Test_latency(int index, unsigned int flushMillis)
+{
+    SimulatedStream ble;
+    SimulatedUART uart;
+    NuSBridge bridge(ble);
+    bridge.add(uart);
+    bridge.setFlushThresholds(0, flushMillis);
+    bridge.begin();
+
+    // Less than a batch: sent when the latency threshold expires
+    auto start = ::std::chrono::steady_clock::now();
+    uart.feed("ping");
+    long long elapsed = -1;
+    while (elapsed < 0)
+    {
+        {
+            ::std::lock_guard<::std::mutex> lock(ble.sentMutex);
+            if (ble.sent.size() > 0)
+                elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                              ::std::chrono::steady_clock::now() - start)
+                              .count();
+        }
+        if (::std::chrono::steady_clock::now() - start > ::std::chrono::seconds(2))
+            break;
+        sleepMillis(1);
+    }
+    bridge.end();
+
+    if (elapsed < 0)
+        Serial.printf("--Test #%d failed. Not sent\n", index);
+    else if ((elapsed < (long long)flushMillis) || (elapsed > (long long)flushMillis + 50))
+        Serial.printf("--Test #%d failed. Sent after %lld ms\n", index, elapsed);
+    if (ble.sent != "ping")
+        Serial.printf("--Test #%d failed. Sent \"%s\"\n", index, ble.sent.c_str());
+}
+
+void Test_wakeUp(int index, bool polled)
+{
+    SimulatedStream ble;
+    SimulatedUART uart;
+    NuSBridge bridge(ble);
+    if (polled)
+        bridge.add(static_cast<Stream &>(uart));
+    else
+        bridge.add(uart);
+    bridge.setFlushThresholds(4, 1000);
+    bridge.begin();
+    sleepMillis(20);
+
+    // A full batch is sent as soon as the bridge is awakened
+    auto start = ::std::chrono::steady_clock::now();
+    uart.feed("ping");
+    long long elapsed = -1;
+    while (elapsed < 0)
+    {
+        {
+            ::std::lock_guard<::std::mutex> lock(ble.sentMutex);
+            if (ble.sent.size() > 0)
+                elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                              ::std::chrono::steady_clock::now() - start)
+                              .count();
+        }
+        if (::std::chrono::steady_clock::now() - start > ::std::chrono::seconds(2))
+            break;
+        sleepMillis(1);
+    }
+    bridge.end();
+
+    if ((elapsed < 0) || (elapsed > 20))
+        Serial.printf("--Test #%d failed. Sent after %lld ms\n", index, elapsed);
+}
+
+void Test_watchedStream(int index)
+{
+    SimulatedStream ble;
+    SimulatedUART uart;
+    NuSBridge bridge(ble);
+    bridge.add(uart);
+    NuSWaitSet waitSet;
+    waitSet.add(ble);
+    if (bridge.begin() || bridge.isRunning())
+        Serial.printf("--Test #%d failed. Started on a watched stream\n", index);
+    waitSet.clear();
+    if (!bridge.begin())
+        Serial.printf("--Test #%d failed. Not started\n", index);
+    bridge.end();
+}
+
+void Test_restart(int index)
+{
+    SimulatedStream ble;
+    SimulatedUART uart;
+    NuSBridge bridge(ble);
+    bridge.add(uart);
+    bridge.begin();
+    if (!bridge.isRunning())
+        Serial.printf("--Test #%d failed. Not running\n", index);
+    if (bridge.add(uart))
+        Serial.printf("--Test #%d failed. Stream added while running\n", index);
+    bridge.end();
+    if (bridge.isRunning())
+        Serial.printf("--Test #%d failed. Still running\n", index);
+    bridge.begin();
+    uart.feed("again");
+    sleepMillis(100);
+    bridge.end();
+    if (ble.sent != "again")
+        Serial.printf("--Test #%d failed. Sent \"%s\" after restart\n", index, ble.sent.c_str());
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("*****************************");
+    Serial.println(" Automated test for NuSBridge");
+    Serial.println("*****************************");
+
+    Test_downlink(1);
+    Test_batching(2);
+    Test_latency(3, 5);
+    Test_latency(4, 40);
+    Test_restart(5);
+    Test_wakeUp(6, false);
+    Test_wakeUp(7, true);
+    Test_watchedStream(8);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file CaptureTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of traffic captures
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <vector>
+#include "NuCapture.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class MemoryPrint : public Print
+{
+public:
+    ::std::vector<uint8_t> content;
+
+    virtual size_t write(uint8_t c) override
+    {
+        content.push_back(c);
+        return 1;
+    };
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        content.insert(content.end(), buffer, buffer + size);
+        return size;
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_roundTrip(int index)
+{
+    MemoryPrint out;
+    NuSCaptureRecorder recorder;
+    uint8_t mtu[2] = {247, 0};
+    const char *command = "AT+X?\n";
+
+    // Not recording yet
+    recorder.record(NUS_CAPTURE_SUBSCRIBE, 1, mtu, sizeof(mtu));
+    if (!out.content.empty() || recorder.isRecording())
+        Serial.printf("--Test #%d failed. Recorded before begin()\n", index);
+
+    recorder.begin(out);
+    recorder.record(NUS_CAPTURE_SUBSCRIBE, 0x0102, mtu, sizeof(mtu));
+    delay(2);
+    recorder.record(NUS_CAPTURE_WRITE, 0x0102, (const uint8_t *)command, strlen(command));
+    recorder.record(NUS_CAPTURE_UNSUBSCRIBE, 0x0102);
+    recorder.end();
+    recorder.record(NUS_CAPTURE_WRITE, 0x0102, (const uint8_t *)command, strlen(command));
+    if (recorder.getRecordCount() != 3)
+        Serial.printf("--Test #%d failed. Record count is %u\n", index, (unsigned int)recorder.getRecordCount());
+    size_t expectedSize = NUS_CAPTURE_HEADER_SIZE + (3 * NUS_CAPTURE_RECORD_HEADER_SIZE) + 2 + strlen(command);
+    if (out.content.size() != expectedSize)
+        Serial.printf("--Test #%d failed. Capture size is %u\n", index, (unsigned int)out.content.size());
+
+    NuSCaptureReader reader(out.content.data(), out.content.size());
+    NuSCaptureRecord_t record;
+    if (!reader.isValid())
+    {
+        Serial.printf("--Test #%d failed. Invalid header\n", index);
+        return;
+    }
+    if (!reader.next(record) || (record.event != NUS_CAPTURE_SUBSCRIBE) ||
+        (record.connHandle != 0x0102) || (record.size != 2) || (record.data[0] != 247))
+        Serial.printf("--Test #%d failed. Wrong first record\n", index);
+    uint32_t firstTimestamp = record.timestamp;
+    if (!reader.next(record) || (record.event != NUS_CAPTURE_WRITE) ||
+        (record.size != strlen(command)) || (memcmp(record.data, command, record.size) != 0))
+        Serial.printf("--Test #%d failed. Wrong second record\n", index);
+    if (record.timestamp < firstTimestamp + 2000)
+        Serial.printf("--Test #%d failed. Wrong timestamps: %u %u\n",
+                      index, (unsigned int)firstTimestamp, (unsigned int)record.timestamp);
+    if (!reader.next(record) || (record.event != NUS_CAPTURE_UNSUBSCRIBE) || (record.size != 0))
+        Serial.printf("--Test #%d failed. Wrong third record\n", index);
+    if (reader.next(record))
+        Serial.printf("--Test #%d failed. Too many records\n", index);
+
+    // Read again
+    reader.rewind();
+    if (!reader.next(record) || (record.event != NUS_CAPTURE_SUBSCRIBE))
+        Serial.printf("--Test #%d failed. Not rewound\n", index);
+}
+
+void Test_malformed(int index)
+{
+    MemoryPrint out;
+    NuSCaptureRecorder recorder;
+    uint8_t data[4] = {1, 2, 3, 4};
+    recorder.begin(out);
+    recorder.record(NUS_CAPTURE_NOTIFY, 1, data, sizeof(data));
+    recorder.record(NUS_CAPTURE_NOTIFY, 1, data, sizeof(data));
+    recorder.end();
+
+    // Truncated in the middle of the second record
+    NuSCaptureRecord_t record;
+    NuSCaptureReader truncated(out.content.data(), out.content.size() - 1);
+    if (!truncated.next(record) || truncated.next(record))
+        Serial.printf("--Test #%d failed. Truncated record accepted\n", index);
+
+    // Wrong version
+    out.content[4] = NUS_CAPTURE_VERSION + 1;
+    NuSCaptureReader wrongVersion(out.content.data(), out.content.size());
+    if (wrongVersion.isValid() || wrongVersion.next(record))
+        Serial.printf("--Test #%d failed. Wrong version accepted\n", index);
+
+    // Too short
+    NuSCaptureReader empty(out.content.data(), 3);
+    if (empty.isValid())
+        Serial.printf("--Test #%d failed. Short capture accepted\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("***********************************");
+    Serial.println(" Automated test for traffic capture");
+    Serial.println("***********************************");
+
+    Test_roundTrip(1);
+    Test_malformed(2);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,235 @@
+/**
+ * @file CompressionBenchmark.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test and benchmark of streaming compression
+ *
+ * @note No peer is needed. Traffic is simulated as recorded
+ *       from a typical device: JSON telemetry and log text.
+ *       Also runs on a desktop computer given mocks of the
+ *       Arduino and NimBLE APIs.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include "NuCompression.hpp"
+
+// Typical application throughput of a BLE 4.2 link (1M PHY, notifications)
+#define LINK_BYTES_PER_SECOND 20000
+
+//-----------------------------------------------------------------------------
+// Recorded traffic
+//-----------------------------------------------------------------------------
+
+::std::mt19937 randomGenerator(1234);
+
+// Each element is written in a single call to write()
+::std::vector<::std::string> recordTelemetry(size_t count)
+{
+    ::std::vector<::std::string> result;
+    char line[160];
+    for (size_t i = 0; i < count; i++)
+    {
+        snprintf(
+            line,
+            sizeof(line),
+            "{\"id\":\"sensor-04\",\"seq\":%u,\"temp\":%.2f,\"hum\":%.1f,\"bat\":%u,\"rssi\":%d,\"ok\":true}\n",
+            (unsigned)i,
+            21.0 + (randomGenerator() % 400) / 100.0,
+            40.0 + (randomGenerator() % 200) / 10.0,
+            (unsigned)(3700 + randomGenerator() % 50),
+            -(int)(50 + randomGenerator() % 30));
+        result.push_back(line);
+    }
+    return result;
+}
+
+::std::vector<::std::string> recordLog(size_t count)
+{
+    const char *messages[] = {
+        "[I][wifi.cpp:512] onEvent(): station connected",
+        "[D][sensor.cpp:88] read(): sample ready",
+        "[W][power.cpp:140] check(): battery below threshold",
+        "[I][mqtt.cpp:233] publish(): message queued",
+        "[E][sensor.cpp:97] read(): timeout waiting for data"};
+    ::std::vector<::std::string> result;
+    char line[160];
+    for (size_t i = 0; i < count; i++)
+    {
+        snprintf(
+            line,
+            sizeof(line),
+            "%08u %s\n",
+            (unsigned)(i * 137 + randomGenerator() % 100),
+            messages[randomGenerator() % 5]);
+        result.push_back(line);
+    }
+    return result;
+}
+
+::std::vector<::std::string> recordRandom(size_t count)
+{
+    ::std::vector<::std::string> result;
+    for (size_t i = 0; i < count; i++)
+    {
+        ::std::string block(1 + randomGenerator() % 300, ' ');
+        for (auto &c : block)
+            c = randomGenerator() & 0xFF;
+        result.push_back(block);
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+// Compress each write, split compressed data at random points
+// (like BLE packets) and decompress to a small buffer
+void Test_roundTrip(int index, const char *name, const ::std::vector<::std::string> &traffic)
+{
+    NuSCompressor compressor;
+    NuSDecompressor decompressor;
+    ::std::string original;
+    ::std::string compressed;
+    for (auto &message : traffic)
+    {
+        original += message;
+        ::std::vector<uint8_t> output(NuSCompressor::getMaxCompressedSize(message.size()));
+        size_t size = compressor.compress((const uint8_t *)message.data(), message.size(), output.data());
+        if (size > output.size())
+            Serial.printf("--Test #%d failed. Buffer overflow\n", index);
+        compressed.append((const char *)output.data(), size);
+    }
+
+    ::std::string decompressed;
+    size_t offset = 0;
+    while (offset < compressed.size())
+    {
+        size_t packetSize = 1 + randomGenerator() % 244;
+        if (packetSize > (compressed.size() - offset))
+            packetSize = compressed.size() - offset;
+        const uint8_t *data = (const uint8_t *)compressed.data() + offset;
+        size_t size = packetSize;
+        uint8_t buffer[37];
+        size_t count;
+        do
+        {
+            count = decompressor.decompress(data, size, buffer, sizeof(buffer));
+            decompressed.append((const char *)buffer, count);
+        } while (count == sizeof(buffer));
+        if (size != 0)
+            Serial.printf("--Test #%d failed. Input not consumed\n", index);
+        offset = offset + packetSize;
+    }
+
+    if (decompressed != original)
+        Serial.printf("--Test #%d failed. %s: data does not match\n", index, name);
+}
+
+void Test_boundaries(int index)
+{
+    // Long runs, matches at the maximum distance and overlapping copies
+    ::std::vector<::std::string> traffic;
+    traffic.push_back(::std::string(5000, 'a'));
+    ::std::string pattern;
+    for (int i = 0; i < 1024; i++)
+        pattern += (char)(randomGenerator() & 0xFF);
+    traffic.push_back(pattern);
+    traffic.push_back(pattern);
+    traffic.push_back(pattern + pattern + pattern);
+    traffic.push_back("");
+    traffic.push_back("x");
+    Test_roundTrip(index, "boundaries", traffic);
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+void Benchmark(const char *name, const ::std::vector<::std::string> &traffic)
+{
+    NuSCompressor compressor;
+    NuSDecompressor decompressor;
+    ::std::vector<uint8_t> compressed;
+    ::std::vector<size_t> sizes;
+    size_t originalSize = 0;
+
+    auto start = ::std::chrono::steady_clock::now();
+    for (auto &message : traffic)
+    {
+        size_t offset = compressed.size();
+        compressed.resize(offset + NuSCompressor::getMaxCompressedSize(message.size()));
+        size_t size = compressor.compress((const uint8_t *)message.data(), message.size(), compressed.data() + offset);
+        compressed.resize(offset + size);
+        originalSize += message.size();
+    }
+    auto compressTime = ::std::chrono::steady_clock::now() - start;
+
+    uint8_t buffer[512];
+    const uint8_t *data = compressed.data();
+    size_t size = compressed.size();
+    size_t decompressedSize = 0;
+    start = ::std::chrono::steady_clock::now();
+    size_t count;
+    do
+    {
+        count = decompressor.decompress(data, size, buffer, sizeof(buffer));
+        decompressedSize += count;
+    } while (count > 0);
+    auto decompressTime = ::std::chrono::steady_clock::now() - start;
+
+    double ratio = (double)originalSize / compressed.size();
+    double megabytes = (double)originalSize / 1e6;
+    Serial.printf(
+        "%-10s ratio %5.2f, compress %7.2f MB/s, decompress %7.2f MB/s, effective link %6.0f B/s (was %d B/s)\n",
+        name,
+        ratio,
+        megabytes / ::std::chrono::duration<double>(compressTime).count(),
+        megabytes / ::std::chrono::duration<double>(decompressTime).count(),
+        ratio * LINK_BYTES_PER_SECOND,
+        LINK_BYTES_PER_SECOND);
+    if (decompressedSize != originalSize)
+        Serial.println("--Benchmark failed. Size does not match");
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test and benchmark of compression ");
+    Serial.println("**************************************************");
+
+    ::std::vector<::std::string> telemetry = recordTelemetry(2000);
+    ::std::vector<::std::string> log = recordLog(2000);
+    ::std::vector<::std::string> noise = recordRandom(200);
+
+    Test_roundTrip(1, "telemetry", telemetry);
+    Test_roundTrip(2, "log", log);
+    Test_roundTrip(3, "random", noise);
+    Test_boundaries(4);
+
+    Serial.println("-- END --");
+    Serial.println("");
+
+    Benchmark("telemetry", telemetry);
+    Benchmark("log", log);
+    Benchmark("random", noise);
+}
+
+void loop()
+{
+    delay(30000);
+}
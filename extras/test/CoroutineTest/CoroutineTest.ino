@@ -0,0 +1,294 @@
+/**
+ * @file CoroutineTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of coroutine awaitables
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *       Requires C++20.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "NuCoroutines.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const char *text)
+    {
+        NimBLEAttValue value((const uint8_t *)text, strlen(text));
+        receive(value);
+    };
+
+    // Called from the BLE host task
+    void simulateDisconnection()
+    {
+        hangUp();
+    };
+
+    // Simulate a BLE stack accepting a few bytes at a time
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        size_t count = (size > maxBytesPerWrite) ? maxBytesPerWrite : size;
+        sent.append((const char *)buffer, count);
+        writeCount++;
+        return count;
+    };
+
+    size_t maxBytesPerWrite = 7;
+    ::std::string sent;
+    int writeCount = 0;
+};
+
+// Awaitable operation counting its polls
+class CountingAwaitable : public NuSAwaitableResult<bool>
+{
+public:
+    CountingAwaitable(NordicUARTSession &session, ::std::atomic<bool> &ready, int &polls)
+        : session(session), ready(ready), polls(polls) {};
+
+    virtual bool poll() override
+    {
+        polls++;
+        result = ready;
+        return result;
+    };
+
+    virtual NordicUARTSession *getSource() override { return &session; };
+
+private:
+    NordicUARTSession &session;
+    ::std::atomic<bool> &ready;
+    int &polls;
+};
+
+class SimulatedService : public NordicUARTService
+{
+public:
+    virtual void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override {};
+};
+
+//-----------------------------------------------------------------------------
+// Coroutines
+//-----------------------------------------------------------------------------
+
+NuSTask readOnce(
+    NordicUARTSession &session,
+    unsigned int timeoutMillis,
+    ::std::string &output,
+    bool &finished)
+{
+    uint8_t buffer[32];
+    size_t count = co_await NuSAsync::read(session, buffer, sizeof(buffer), timeoutMillis);
+    output.assign((const char *)buffer, count);
+    finished = true;
+}
+
+NuSTask countdown(int from, int &counter)
+{
+    uint8_t dummy;
+    SimulatedSession idle;
+    while (from-- > 0)
+    {
+        // Yield to other coroutines
+        co_await NuSAsync::read(idle, &dummy, 1, 1);
+        counter++;
+    }
+}
+
+NuSTask writeAll(NordicUARTSession &session, const char *text, size_t &written)
+{
+    written = co_await NuSAsync::write(session, (const uint8_t *)text, strlen(text));
+}
+
+NuSTask awaitCounting(NordicUARTSession &session, ::std::atomic<bool> &ready, int &polls)
+{
+    co_await CountingAwaitable(session, ready, polls);
+}
+
+NuSTask connectOnce(NordicUARTService &service, unsigned int timeoutMillis, int &result)
+{
+    bool connected = co_await NuSAsync::connect(service, timeoutMillis);
+    result = connected ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_readData(int index)
+{
+    SimulatedSession session;
+    NuSExecutor executor;
+    ::std::string output;
+    bool finished = false;
+    executor.spawn(readOnce(session, 0, output, finished));
+
+    ::std::thread host([&]()
+                       {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        session.feed("hello"); });
+    executor.run();
+    host.join();
+
+    if (!finished || (output != "hello"))
+        Serial.printf("--Test #%d failed. Expected [hello] Found [%s]\n", index, output.c_str());
+}
+
+void Test_readTimeout(int index)
+{
+    SimulatedSession session;
+    NuSExecutor executor;
+    ::std::string output = "not empty";
+    bool finished = false;
+    auto start = ::std::chrono::steady_clock::now();
+    executor.spawn(readOnce(session, 100, output, finished));
+    executor.run();
+    auto elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                       ::std::chrono::steady_clock::now() - start)
+                       .count();
+
+    if (!finished || !output.empty())
+        Serial.printf("--Test #%d failed. Data read on timeout\n", index);
+    if (elapsed < 100)
+        Serial.printf("--Test #%d failed. Timeout too short (%lld ms)\n", index, (long long)elapsed);
+}
+
+void Test_readDisconnection(int index)
+{
+    SimulatedSession session;
+    NuSExecutor executor;
+    ::std::string output = "not empty";
+    bool finished = false;
+    executor.spawn(readOnce(session, 0, output, finished));
+
+    ::std::thread host([&]()
+                       {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        session.simulateDisconnection(); });
+    executor.run();
+    host.join();
+
+    if (!finished || !output.empty())
+        Serial.printf("--Test #%d failed. Data read on disconnection\n", index);
+}
+
+void Test_multiplexing(int index, int coroutineCount)
+{
+    NuSExecutor executor;
+    int counter = 0;
+    for (int i = 0; i < coroutineCount; i++)
+        executor.spawn(countdown(5, counter));
+    if (executor.size() != (size_t)coroutineCount)
+        Serial.printf("--Test #%d failed. Expected %d coroutines. Found %d\n", index, coroutineCount, (int)executor.size());
+    executor.run();
+
+    if (counter != (coroutineCount * 5))
+        Serial.printf("--Test #%d failed. Expected count %d. Found %d\n", index, coroutineCount * 5, counter);
+    if (executor.size() != 0)
+        Serial.printf("--Test #%d failed. Unfinished coroutines\n", index);
+}
+
+void Test_writeBackpressure(int index, const char *text)
+{
+    SimulatedSession session;
+    NuSExecutor executor;
+    size_t written = 0;
+    executor.spawn(writeAll(session, text, written));
+    executor.run();
+
+    int expectedWrites = (strlen(text) + session.maxBytesPerWrite - 1) / session.maxBytesPerWrite;
+    if ((written != strlen(text)) || (session.sent != text))
+        Serial.printf("--Test #%d failed. Expected [%s] Found [%s]\n", index, text, session.sent.c_str());
+    if (session.writeCount != expectedWrites)
+        Serial.printf("--Test #%d failed. Expected %d writes. Found %d\n", index, expectedWrites, session.writeCount);
+}
+
+void Test_connectTimeout(int index)
+{
+    SimulatedService service;
+    NuSExecutor executor;
+    int result = -1;
+    executor.spawn(connectOnce(service, 50, result));
+    executor.run();
+
+    if (result != 0)
+        Serial.printf("--Test #%d failed. Connection not expected\n", index);
+}
+
+void Test_pollOnNotification(int index)
+{
+    SimulatedSession notified;
+    SimulatedSession idle;
+    ::std::atomic<bool> notifiedReady{false};
+    ::std::atomic<bool> idleReady{false};
+    int notifiedPolls = 0;
+    int idlePolls = 0;
+    NuSExecutor executor;
+    executor.spawn(awaitCounting(notified, notifiedReady, notifiedPolls));
+    executor.spawn(awaitCounting(idle, idleReady, idlePolls));
+
+    ::std::thread host([&]()
+                       {
+        // Nothing happens for a while
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(100));
+        notifiedReady = true;
+        notified.feed("x");
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        idleReady = true;
+        idle.feed("x"); });
+    executor.run();
+    host.join();
+
+    // Polled once when awaited and once when notified.
+    // A spurious wake up is tolerated.
+    if ((notifiedPolls < 2) || (notifiedPolls > 3))
+        Serial.printf("--Test #%d failed. Expected 2 polls. Found %d\n", index, notifiedPolls);
+    if ((idlePolls < 2) || (idlePolls > 3))
+        Serial.printf("--Test #%d failed. Expected 2 polls of the idle coroutine. Found %d\n", index, idlePolls);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for coroutine awaitables ");
+    Serial.println("**************************************************");
+
+    Test_readData(1);
+    Test_readTimeout(2);
+    Test_readDisconnection(3);
+    Test_multiplexing(4, 1);
+    Test_multiplexing(5, 50);
+    Test_writeBackpressure(6, "");
+    Test_writeBackpressure(7, "short");
+    Test_writeBackpressure(8, "This text does not fit in a single write");
+    Test_connectTimeout(9);
+    Test_pollOnNotification(10);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
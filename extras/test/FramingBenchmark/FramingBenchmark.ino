@@ -0,0 +1,344 @@
+/**
+ * @file FramingBenchmark.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test and benchmark of message framing
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *       Also runs on a desktop computer given mocks of the
+ *       Arduino and NimBLE APIs.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <random>
+#include "NuFramer.hpp"
+
+#define CONN_HANDLE 7
+#define CHUNK_SIZE 244
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedFramer : public NordicUARTFramer
+{
+public:
+    SimulatedFramer(
+        NuSFraming_t framing,
+        NuSFrameCheck_t check,
+        size_t maxFrameSize = 512,
+        size_t ringSize = 2048)
+        : NordicUARTFramer(framing, check, maxFrameSize, ringSize) {};
+
+    // Called from the BLE host task.
+    // Data is split in BLE-sized packets.
+    void feed(const ::std::vector<uint8_t> &data, uint16_t connHandle = CONN_HANDLE)
+    {
+        for (size_t offset = 0; offset < data.size(); offset += CHUNK_SIZE)
+        {
+            size_t size = data.size() - offset;
+            if (size > CHUNK_SIZE)
+                size = CHUNK_SIZE;
+            receive(data.data() + offset, size, connHandle);
+        }
+    };
+
+    // Called from the BLE host task
+    void simulateDisconnection()
+    {
+        onUnsubscribe(0);
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Auxiliary
+//-----------------------------------------------------------------------------
+
+const char *framingName[] = {"COBS", "SLIP", "LENGTH"};
+const char *checkName[] = {"NONE", "CRC16", "CRC32"};
+
+::std::mt19937 randomGenerator(1234);
+
+::std::vector<uint8_t> randomMessage(size_t size)
+{
+    ::std::vector<uint8_t> message(size);
+    for (auto &byte : message)
+    {
+        // Plenty of special bytes
+        switch (randomGenerator() % 8)
+        {
+        case 0:
+            byte = 0x00;
+            break;
+        case 1:
+            byte = 0xC0;
+            break;
+        case 2:
+            byte = 0xDB;
+            break;
+        default:
+            byte = randomGenerator() & 0xFF;
+        }
+    }
+    return message;
+}
+
+// Append an encoded message to a stream of bytes
+void appendFrame(
+    ::std::vector<uint8_t> &stream,
+    NuSFraming_t framing,
+    NuSFrameCheck_t check,
+    const ::std::vector<uint8_t> &message)
+{
+    ::std::vector<uint8_t> buffer(message);
+    buffer.resize(NordicUARTFramer::getEncodedSize(framing, check, message.size()));
+    size_t size = NordicUARTFramer::encode(framing, check, buffer.data(), message.size(), buffer.size());
+    stream.insert(stream.end(), buffer.begin(), buffer.begin() + size);
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_crc(int index)
+{
+    const uint8_t *text = (const uint8_t *)"123456789";
+    uint16_t crc16 = NordicUARTFramer::crc16(text, 9);
+    uint32_t crc32 = NordicUARTFramer::crc32(text, 9);
+    if (crc16 != 0x29B1)
+        Serial.printf("--Test #%d failed. CRC-16 expected 29B1. Found %04X\n", index, crc16);
+    if (crc32 != 0xCBF43926)
+        Serial.printf("--Test #%d failed. CRC-32 expected CBF43926. Found %08X\n", index, crc32);
+    // Incremental computation
+    crc16 = NordicUARTFramer::crc16(text + 4, 5, NordicUARTFramer::crc16(text, 4));
+    crc32 = NordicUARTFramer::crc32(text + 4, 5, NordicUARTFramer::crc32(text, 4));
+    if ((crc16 != 0x29B1) || (crc32 != 0xCBF43926))
+        Serial.printf("--Test #%d failed. Incremental CRC\n", index);
+}
+
+void Test_capacity(int index)
+{
+    uint8_t buffer[8] = {1, 2, 3};
+    if (NordicUARTFramer::encode(NUS_FRAMING_SLIP, NUS_CHECK_CRC32, buffer, 3, sizeof(buffer)) != 0)
+        Serial.printf("--Test #%d failed. Buffer overflow not prevented\n", index);
+}
+
+void Test_roundTrip(int index, NuSFraming_t framing, NuSFrameCheck_t check)
+{
+    // Note: sizes around COBS block boundaries
+    ::std::vector<::std::vector<uint8_t>> messages;
+    for (size_t size : {1, 2, 253, 254, 255, 508, 509, 512})
+        messages.push_back(randomMessage(size));
+    for (int i = 0; i < 100; i++)
+        messages.push_back(randomMessage(1 + randomGenerator() % 512));
+    ::std::vector<uint8_t> stream;
+    for (auto &message : messages)
+        appendFrame(stream, framing, check, message);
+
+    // Note: the ring is too small for all the frames,
+    // so the host task gets blocked from time to time
+    SimulatedFramer framer(framing, check);
+    ::std::thread host([&]()
+                       {
+        framer.feed(stream);
+        framer.simulateDisconnection(); });
+    size_t count = 0;
+    size_t size;
+    uint16_t connHandle;
+    const uint8_t *frame;
+    bool ok = true;
+    while ((frame = framer.readFrame(size, connHandle)))
+    {
+        if ((count >= messages.size()) ||
+            (size != messages[count].size()) ||
+            (memcmp(frame, messages[count].data(), size) != 0) ||
+            (connHandle != CONN_HANDLE))
+            ok = false;
+        count++;
+    }
+    host.join();
+    NuSFrameStats_t stats = framer.getFrameStats();
+
+    if (!ok || (count != messages.size()) || (stats.receivedFrames != messages.size()))
+        Serial.printf(
+            "--Test #%d failed. %s+%s: %d of %d frames received\n",
+            index, framingName[framing], checkName[check], (int)count, (int)messages.size());
+    if (stats.checkErrors || stats.encodingErrors || stats.oversizedFrames)
+        Serial.printf("--Test #%d failed. Unexpected errors\n", index);
+}
+
+void Test_callback(int index)
+{
+    SimulatedFramer framer(NUS_FRAMING_COBS, NUS_CHECK_CRC16);
+    size_t count = 0;
+    framer.onFrame([&count](const uint8_t *data, size_t size, uint16_t connHandle)
+                   {
+                       if ((size == 5) && (memcmp(data, "hello", 5) == 0))
+                           count++; });
+    ::std::vector<uint8_t> message((const uint8_t *)"hello", (const uint8_t *)"hello" + 5);
+    ::std::vector<uint8_t> stream;
+    for (int i = 0; i < 1000; i++)
+        appendFrame(stream, NUS_FRAMING_COBS, NUS_CHECK_CRC16, message);
+    framer.feed(stream);
+    if (count != 1000)
+        Serial.printf("--Test #%d failed. Expected 1000 frames. Found %d\n", index, (int)count);
+}
+
+void Test_corrupted(int index, NuSFraming_t framing)
+{
+    SimulatedFramer framer(framing, NUS_CHECK_CRC16);
+    ::std::vector<uint8_t> stream;
+    appendFrame(stream, framing, NUS_CHECK_CRC16, {1, 2, 3, 4, 5, 6});
+    // Flip a bit which is not a delimiter nor an escape
+    stream[4] ^= 0x10;
+    appendFrame(stream, framing, NUS_CHECK_CRC16, {7, 8, 9});
+    framer.feed(stream);
+    framer.simulateDisconnection();
+
+    size_t size;
+    const uint8_t *frame = framer.readFrame(size);
+    if ((frame == nullptr) || (size != 3) || (frame[0] != 7))
+        Serial.printf("--Test #%d failed. Valid frame not received\n", index);
+    if (framer.getFrameStats().checkErrors != 1)
+        Serial.printf("--Test #%d failed. Check error not detected\n", index);
+}
+
+void Test_oversized(int index, NuSFraming_t framing)
+{
+    SimulatedFramer framer(framing, NUS_CHECK_CRC32, 64, 256);
+    ::std::vector<uint8_t> stream;
+    appendFrame(stream, framing, NUS_CHECK_CRC32, randomMessage(65));
+    appendFrame(stream, framing, NUS_CHECK_CRC32, randomMessage(64));
+    framer.feed(stream);
+    framer.simulateDisconnection();
+
+    size_t size;
+    const uint8_t *frame = framer.readFrame(size);
+    NuSFrameStats_t stats = framer.getFrameStats();
+    if ((frame == nullptr) || (size != 64))
+        Serial.printf("--Test #%d failed. Valid frame not received\n", index);
+    if ((stats.oversizedFrames != 1) || (stats.receivedFrames != 1))
+        Serial.printf("--Test #%d failed. Oversized frame not detected\n", index);
+}
+
+void Test_interleaved(int index)
+{
+    SimulatedFramer framer(NUS_FRAMING_SLIP, NUS_CHECK_CRC16);
+    ::std::vector<uint8_t> stream;
+    appendFrame(stream, NUS_FRAMING_SLIP, NUS_CHECK_CRC16, {1, 2, 3, 4});
+    // Half a frame from one peer, then a whole frame from another
+    framer.feed(::std::vector<uint8_t>(stream.begin(), stream.begin() + 3), 1);
+    framer.feed(stream, 2);
+
+    uint16_t connHandle;
+    size_t size;
+    const uint8_t *frame = framer.readFrame(size, connHandle, 100);
+    if ((frame == nullptr) || (connHandle != 2))
+        Serial.printf("--Test #%d failed. Frame from the second peer not received\n", index);
+    if (framer.getFrameStats().encodingErrors != 1)
+        Serial.printf("--Test #%d failed. Unfinished frame not discarded\n", index);
+}
+
+void Test_timeout(int index)
+{
+    SimulatedFramer framer(NUS_FRAMING_COBS, NUS_CHECK_NONE);
+    size_t size;
+    auto start = ::std::chrono::steady_clock::now();
+    const uint8_t *frame = framer.readFrame(size, 100);
+    auto elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                       ::std::chrono::steady_clock::now() - start)
+                       .count();
+    if ((frame != nullptr) || (size != 0) || (elapsed < 100))
+        Serial.printf("--Test #%d failed. Timeout not honored\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+void Benchmark(NuSFraming_t framing, NuSFrameCheck_t check, size_t messageSize)
+{
+    const size_t messageCount = 2000;
+    ::std::vector<uint8_t> message = randomMessage(messageSize);
+    ::std::vector<uint8_t> buffer(NordicUARTFramer::getEncodedSize(framing, check, messageSize));
+    ::std::vector<uint8_t> stream;
+    stream.reserve(buffer.size() * messageCount);
+
+    auto start = ::std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messageCount; i++)
+    {
+        memcpy(buffer.data(), message.data(), messageSize);
+        size_t size = NordicUARTFramer::encode(framing, check, buffer.data(), messageSize, buffer.size());
+        stream.insert(stream.end(), buffer.begin(), buffer.begin() + size);
+    }
+    auto encodeTime = ::std::chrono::steady_clock::now() - start;
+
+    SimulatedFramer framer(framing, check, messageSize);
+    size_t count = 0;
+    framer.onFrame([&count](const uint8_t *data, size_t size, uint16_t connHandle)
+                   { count++; });
+    start = ::std::chrono::steady_clock::now();
+    framer.feed(stream);
+    auto decodeTime = ::std::chrono::steady_clock::now() - start;
+
+    double megabytes = (double)(messageSize * messageCount) / 1e6;
+    double encodeSeconds = ::std::chrono::duration<double>(encodeTime).count();
+    double decodeSeconds = ::std::chrono::duration<double>(decodeTime).count();
+    Serial.printf(
+        "%-6s %-5s %4d bytes: encode %8.2f MB/s, decode %8.2f MB/s, overhead %5.2f%%\n",
+        framingName[framing],
+        checkName[check],
+        (int)messageSize,
+        megabytes / encodeSeconds,
+        megabytes / decodeSeconds,
+        100.0 * ((double)stream.size() / (messageSize * messageCount) - 1.0));
+    if (count != messageCount)
+        Serial.printf("--Benchmark failed. %d of %d frames received\n", (int)count, (int)messageCount);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test and benchmark of message framing ");
+    Serial.println("**************************************************");
+
+    Test_crc(1);
+    Test_capacity(2);
+    int testIndex = 10;
+    for (NuSFraming_t framing : {NUS_FRAMING_COBS, NUS_FRAMING_SLIP, NUS_FRAMING_LENGTH})
+    {
+        for (NuSFrameCheck_t check : {NUS_CHECK_NONE, NUS_CHECK_CRC16, NUS_CHECK_CRC32})
+            Test_roundTrip(testIndex++, framing, check);
+        Test_corrupted(testIndex++, framing);
+        Test_oversized(testIndex++, framing);
+    }
+    Test_callback(30);
+    Test_interleaved(31);
+    Test_timeout(32);
+
+    Serial.println("-- END --");
+    Serial.println("");
+
+    for (NuSFraming_t framing : {NUS_FRAMING_COBS, NUS_FRAMING_SLIP, NUS_FRAMING_LENGTH})
+        for (NuSFrameCheck_t check : {NUS_CHECK_NONE, NUS_CHECK_CRC16, NUS_CHECK_CRC32})
+            for (size_t messageSize : {20, 240})
+                Benchmark(framing, check, messageSize);
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,167 @@
+/**
+ * @file ProfileTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of command profiling
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "NuATParser.hpp"
+#include "NuCLIParser.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class ATTester : public NuATParser
+{
+public:
+    ::std::vector<::std::string> responses;
+
+    virtual void printATResponse(::std::string message) override
+    {
+        responses.push_back(message);
+    };
+};
+
+class CLITester : public NuCLIParser
+{
+public:
+    int profileRequestCount = 0;
+
+protected:
+    virtual void onProfileRequest(NuCommandLine_t &commandLine) noexcept override
+    {
+        profileRequestCount++;
+    };
+};
+
+NuATCommandResult_t slowCommand(NuATCommandParameters_t &params)
+{
+    delay(5);
+    return AT_RESULT_OK;
+}
+
+NuATCommandResult_t fastCommand(NuATCommandParameters_t &params)
+{
+    return AT_RESULT_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_percentile(int index)
+{
+    NuSCommandStats_t stats{};
+    // 90 executions of 3 microseconds (bucket 1) and 10 of 100 (bucket 6)
+    stats.count = 100;
+    stats.maxMicros = 100;
+    stats.totalMicros = 90 * 3 + 10 * 100;
+    stats.histogram[1] = 90;
+    stats.histogram[6] = 10;
+    uint32_t p50 = NuSCommandProfiler::getPercentile(stats, 50);
+    uint32_t p99 = NuSCommandProfiler::getPercentile(stats, 99);
+    uint32_t p100 = NuSCommandProfiler::getPercentile(stats, 100);
+    if (p50 != 3)
+        Serial.printf("--Test #%d failed. p50=%u\n", index, (unsigned int)p50);
+    if (p99 != 100)
+        Serial.printf("--Test #%d failed. p99=%u\n", index, (unsigned int)p99);
+    if (p100 != 100)
+        Serial.printf("--Test #%d failed. p100=%u\n", index, (unsigned int)p100);
+    ::std::string line = NuSCommandProfiler::format("CMD", stats);
+    if (line != "CMD,100,12,100,3,100")
+        Serial.printf("--Test #%d failed. Formatted as \"%s\"\n", index, line.c_str());
+}
+
+void Test_AT(int index)
+{
+    ATTester tester;
+    tester.onExecute("SLOW", slowCommand).onQuery("FAST", fastCommand).onSet("FAST", fastCommand);
+
+    // Not measured while disabled
+    tester.execute("AT+SLOW\n");
+    if (!tester.getProfile().empty())
+        Serial.printf("--Test #%d failed. Measured while disabled\n", index);
+
+    tester.profile(true);
+    tester.execute("AT+SLOW;+FAST?;+FAST=1;+FAST?\n");
+    NuSCommandProfile_t profile = tester.getProfile();
+    if ((profile.size() != 3) || (profile.count("SLOW") == 0) ||
+        (profile.count("FAST?") == 0) || (profile.count("FAST=") == 0))
+    {
+        Serial.printf("--Test #%d failed. Wrong command names\n", index);
+        return;
+    }
+    if ((profile["SLOW"].count != 1) || (profile["FAST?"].count != 2))
+        Serial.printf("--Test #%d failed. Wrong counts\n", index);
+    if (profile["SLOW"].maxMicros < 5000)
+        Serial.printf("--Test #%d failed. SLOW took %u us\n", index, (unsigned int)profile["SLOW"].maxMicros);
+    if (profile["SLOW"].maxMicros <= profile["FAST?"].maxMicros)
+        Serial.printf("--Test #%d failed. FAST is slower than SLOW\n", index);
+
+    // Built-in command
+    tester.responses.clear();
+    tester.execute("AT+PERF?\n");
+    if ((tester.responses.size() != 4) ||
+        (tester.responses[0].rfind("+PERF: FAST=,1,", 0) != 0) ||
+        (tester.responses[3] != "OK"))
+        Serial.printf("--Test #%d failed. Wrong AT+PERF? response\n", index);
+
+    tester.resetProfile();
+    if (!tester.getProfile().empty())
+        Serial.printf("--Test #%d failed. Not reset\n", index);
+}
+
+void Test_CLI(int index)
+{
+    CLITester tester;
+    tester.on("slow", [](NuCommandLine_t &commandLine)
+              { delay(5); });
+    tester.execute("slow");
+    tester.execute("perf");
+    if (!tester.getProfile().empty() || (tester.profileRequestCount != 0))
+        Serial.printf("--Test #%d failed. Measured while disabled\n", index);
+
+    tester.profile(true);
+    tester.execute("slow");
+    tester.execute("slow 1 2");
+    tester.execute("PERF");
+    NuSCommandProfile_t profile = tester.getProfile();
+    if ((profile.size() != 1) || (profile["slow"].count != 2))
+        Serial.printf("--Test #%d failed. Wrong counts\n", index);
+    if (profile["slow"].maxMicros < 5000)
+        Serial.printf("--Test #%d failed. slow took %u us\n", index, (unsigned int)profile["slow"].maxMicros);
+    if (tester.profileRequestCount != 1)
+        Serial.printf("--Test #%d failed. Built-in command not found\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("************************************");
+    Serial.println(" Automated test for command profiles");
+    Serial.println("************************************");
+
+    Test_percentile(1);
+    Test_AT(2);
+    Test_CLI(3);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
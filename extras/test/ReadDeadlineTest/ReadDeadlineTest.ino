@@ -0,0 +1,204 @@
+/**
+ * @file ReadDeadlineTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of timeouts and wake reasons at readBytes() and readSome()
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include "NuStream.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const char *text)
+    {
+        NimBLEAttValue value((const uint8_t *)text, strlen(text));
+        receive(value);
+    };
+
+    // Called from the BLE host task
+    void simulateDisconnection()
+    {
+        hangUp();
+    };
+
+    // Called from any task
+    void simulateStop()
+    {
+        halt();
+    };
+};
+
+long long elapsedMillis(::std::chrono::steady_clock::time_point start)
+{
+    return ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+               ::std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_trickle(int index, size_t rxBufferSize)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(200);
+    ::std::atomic<bool> stop{false};
+    ::std::thread host([&]()
+                       {
+        // A slow trickle of small packets, faster than the timeout
+        while (!stop)
+        {
+            session.feed("x");
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        } });
+    uint8_t buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    size_t count = session.readBytes(buffer, sizeof(buffer));
+    long long elapsed = elapsedMillis(start);
+    stop = true;
+    session.setTimeout(100);
+    while (session.readBytes(buffer, sizeof(buffer)) > 0)
+        ;
+    host.join();
+
+    if ((elapsed < 200) || (elapsed > 300))
+        Serial.printf("--Test #%d failed. Timeout not honored (%lld ms)\n", index, elapsed);
+    if ((count == 0) || (count >= sizeof(buffer)))
+        Serial.printf("--Test #%d failed. Unexpected count %d\n", index, (int)count);
+}
+
+void Test_disconnectionAlongWithData(int index, size_t rxBufferSize)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(1000);
+    // Both wake reasons are signaled before reading
+    session.feed("abc");
+    session.simulateDisconnection();
+
+    uint8_t buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    size_t count = session.readBytes(buffer, sizeof(buffer));
+    long long elapsed = elapsedMillis(start);
+
+    if (count != 3)
+        Serial.printf("--Test #%d failed. Expected 3 bytes. Found %d\n", index, (int)count);
+    if (elapsed > 50)
+        Serial.printf("--Test #%d failed. Did not return at once (%lld ms)\n", index, elapsed);
+}
+
+void Test_disconnectionReportedOnce(int index)
+{
+    SimulatedSession session;
+    session.setTimeout(100);
+    session.simulateDisconnection();
+
+    // The first read is awakened by the disconnection
+    uint8_t buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    size_t count = session.readBytes(buffer, sizeof(buffer));
+    long long elapsed = elapsedMillis(start);
+    if ((count != 0) || (elapsed > 50))
+        Serial.printf("--Test #%d failed. Not awakened by disconnection (%lld ms)\n", index, elapsed);
+
+    // The next one waits for the timeout, so a loop does not spin
+    start = ::std::chrono::steady_clock::now();
+    count = session.readSome(buffer, sizeof(buffer));
+    elapsed = elapsedMillis(start);
+    if ((count != 0) || (elapsed < 100))
+        Serial.printf("--Test #%d failed. Disconnection reported again (%lld ms)\n", index, elapsed);
+}
+
+void Test_stop(int index)
+{
+    SimulatedSession session;
+    session.setTimeout(ULONG_MAX);
+    ::std::thread other([&]()
+                        {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        session.simulateStop(); });
+    uint8_t buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    size_t count = session.readBytes(buffer, sizeof(buffer));
+    long long elapsed = elapsedMillis(start);
+    other.join();
+
+    if ((count != 0) || (elapsed > 500))
+        Serial.printf("--Test #%d failed. Not awakened by stop\n", index);
+    if (session.readSome(buffer, sizeof(buffer)) != 0)
+        Serial.printf("--Test #%d failed. Stop is not sticky\n", index);
+}
+
+void Test_readSome(int index, size_t rxBufferSize)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(1000);
+    ::std::thread host([&]()
+                       {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        session.feed("hello"); });
+    uint8_t buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    size_t count = session.readSome(buffer, sizeof(buffer));
+    long long elapsed = elapsedMillis(start);
+    host.join();
+
+    if ((count != 5) || (memcmp(buffer, "hello", 5) != 0))
+        Serial.printf("--Test #%d failed. Expected [hello]. Found %d bytes\n", index, (int)count);
+    if (elapsed > 500)
+        Serial.printf("--Test #%d failed. Waited for a full buffer (%lld ms)\n", index, elapsed);
+
+    session.setTimeout(100);
+    start = ::std::chrono::steady_clock::now();
+    count = session.readSome(buffer, sizeof(buffer));
+    elapsed = elapsedMillis(start);
+    if ((count != 0) || (elapsed < 100))
+        Serial.printf("--Test #%d failed. Expected timeout\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for read deadlines ");
+    Serial.println("**************************************************");
+
+    Test_trickle(1, 0);
+    Test_trickle(2, 1024);
+    Test_disconnectionAlongWithData(3, 0);
+    Test_disconnectionAlongWithData(4, 1024);
+    Test_stop(5);
+    Test_readSome(6, 0);
+    Test_readSome(7, 1024);
+    Test_disconnectionReportedOnce(8);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
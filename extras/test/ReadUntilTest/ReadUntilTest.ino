@@ -0,0 +1,152 @@
+/**
+ * @file ReadUntilTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of readBytesUntil() and readStringUntil()
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "NuStream.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const ::std::string &text)
+    {
+        NimBLEAttValue value((const uint8_t *)text.data(), text.size());
+        receive(value);
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_readBytesUntil(
+    int index,
+    size_t rxBufferSize,
+    const ::std::vector<::std::string> &packets,
+    size_t size,
+    const ::std::string &expected)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(200);
+    ::std::thread host([&]()
+                       {
+        for (auto &packet : packets)
+            session.feed(packet); });
+    char buffer[128];
+    size_t count = session.readBytesUntil('\n', buffer, size);
+    ::std::string found(buffer, count);
+    // Let the host task finish
+    session.setTimeout(50);
+    while (session.readBytes(buffer, sizeof(buffer)) > 0)
+        ;
+    host.join();
+
+    if (found != expected)
+        Serial.printf("--Test #%d failed. Expected [%s] Found [%s]\n", index, expected.c_str(), found.c_str());
+}
+
+void Test_readStringUntil(
+    int index,
+    size_t rxBufferSize,
+    const ::std::vector<::std::string> &packets,
+    const ::std::string &expected,
+    const ::std::string &remainder)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(200);
+    ::std::thread host([&]()
+                       {
+        for (auto &packet : packets)
+            session.feed(packet); });
+    String found = session.readStringUntil('\n');
+    char buffer[128];
+    size_t count = session.readBytes(buffer, remainder.size());
+    host.join();
+
+    if (expected.compare(found.c_str()) != 0)
+        Serial.printf("--Test #%d failed. Expected [%s] Found [%s]\n", index, expected.c_str(), found.c_str());
+    if (remainder.compare(0, ::std::string::npos, buffer, count) != 0)
+        Serial.printf("--Test #%d failed. Remainder not kept\n", index);
+}
+
+void Test_deadline(int index)
+{
+    SimulatedSession session;
+    session.setTimeout(100);
+    ::std::thread host([&]()
+                       {
+        // Bytes arrive faster than the timeout, but the line never ends
+        for (int i = 0; i < 10; i++)
+        {
+            session.feed("x");
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(30));
+        } });
+    char buffer[64];
+    auto start = ::std::chrono::steady_clock::now();
+    session.readBytesUntil('\n', buffer, sizeof(buffer));
+    auto elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                       ::std::chrono::steady_clock::now() - start)
+                       .count();
+    // Let the host task finish
+    while (session.readBytes(buffer, sizeof(buffer)) > 0)
+        ;
+    host.join();
+
+    if ((elapsed < 100) || (elapsed > 250))
+        Serial.printf("--Test #%d failed. Not a single deadline (%lld ms)\n", index, (long long)elapsed);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for readBytesUntil() ");
+    Serial.println("**************************************************");
+
+    ::std::string longLine(200, 'a');
+    for (size_t rxBufferSize : {0, 16, 1024})
+    {
+        int base = (rxBufferSize == 0) ? 0 : ((rxBufferSize == 16) ? 100 : 200);
+        Test_readBytesUntil(base + 1, rxBufferSize, {"hello\n"}, 64, "hello");
+        Test_readBytesUntil(base + 2, rxBufferSize, {"\n"}, 64, "");
+        Test_readBytesUntil(base + 3, rxBufferSize, {"hel", "lo", "\n"}, 64, "hello");
+        Test_readBytesUntil(base + 4, rxBufferSize, {"hello world\n"}, 5, "hello");
+        Test_readBytesUntil(base + 5, rxBufferSize, {"no terminator"}, 64, "no terminator");
+        Test_readStringUntil(base + 6, rxBufferSize, {"hello\nworld"}, "hello", "world");
+        Test_readStringUntil(base + 7, rxBufferSize, {longLine, "\nz"}, longLine, "z");
+        Test_readStringUntil(base + 8, rxBufferSize, {"abc"}, "abc", "");
+    }
+    Test_deadline(300);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,164 @@
+/**
+ * @file ResumeTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of the retention buffer for session resumption
+ *
+ * @note No peer is needed. Link drops are simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <string>
+#include <random>
+#include "NuResume.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+::std::mt19937 randomGenerator(1234);
+
+// Peer at the other side of a lossy link
+class SimulatedPeer
+{
+public:
+    ::std::string received;
+    uint32_t receivedCount = 0;
+    bool linkUp = true;
+
+    // Returns the count of bytes notified
+    size_t notify(const uint8_t *data, size_t size)
+    {
+        if (!linkUp)
+            return 0;
+        // The link drops at random, losing bytes in flight
+        if ((randomGenerator() % 10) == 0)
+        {
+            linkUp = false;
+            return size;
+        }
+        received.append((const char *)data, size);
+        receivedCount = receivedCount + size;
+        return size;
+    }
+};
+
+void flush(NuSRetentionBuffer &retention, SimulatedPeer &peer)
+{
+    const uint8_t *data;
+    size_t count;
+    while ((count = retention.peek(data)) > 0)
+    {
+        // Chunks of MTU size
+        if (count > 20)
+            count = 20;
+        size_t sent = peer.notify(data, count);
+        retention.markSent(sent);
+        if (sent < count)
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_transfer(int index, uint32_t firstOffset)
+{
+    NuSRetentionBuffer retention;
+    retention.setCapacity(256);
+    retention.reset(firstOffset);
+    SimulatedPeer peer;
+    peer.receivedCount = firstOffset;
+
+    ::std::string message;
+    for (int i = 0; i < 20000; i++)
+        message += (char)('a' + (i % 26));
+
+    size_t written = 0;
+    int resumeCount = 0;
+    int loops = 0;
+    while ((peer.received.size() < message.size()) && (loops++ < 100000))
+    {
+        // write()
+        size_t size = 1 + randomGenerator() % 64;
+        if (size > (message.size() - written))
+            size = message.size() - written;
+        written += retention.append((const uint8_t *)message.data() + written, size);
+        flush(retention, peer);
+
+        if (peer.linkUp)
+        {
+            // Acknowledge from time to time
+            if ((randomGenerator() % 4) == 0)
+                if (!retention.acknowledge(peer.receivedCount))
+                    Serial.printf("--Test #%d failed. Acknowledge rejected\n", index);
+        }
+        else
+        {
+            // Reconnect and resume
+            peer.linkUp = true;
+            if (!retention.rewind(peer.receivedCount))
+            {
+                Serial.printf("--Test #%d failed. Resume rejected\n", index);
+                return;
+            }
+            resumeCount++;
+            flush(retention, peer);
+        }
+    }
+
+    if (peer.received != message)
+        Serial.printf("--Test #%d failed. Data does not match (%d resumes)\n", index, resumeCount);
+    if (resumeCount == 0)
+        Serial.printf("--Test #%d failed. No link drops\n", index);
+}
+
+void Test_bounds(int index)
+{
+    NuSRetentionBuffer retention;
+    retention.setCapacity(8);
+    uint8_t data[16] = {0};
+    if (retention.append(data, 16) != 8)
+        Serial.printf("--Test #%d failed. Capacity not honored\n", index);
+    if (retention.acknowledge(1))
+        Serial.printf("--Test #%d failed. Acknowledged bytes not sent\n", index);
+    retention.markSent(4);
+    if (!retention.acknowledge(2) || (retention.getRetainedSize() != 6))
+        Serial.printf("--Test #%d failed. Acknowledge\n", index);
+    if (retention.rewind(1) || retention.rewind(9))
+        Serial.printf("--Test #%d failed. Rewind out of range\n", index);
+    if (!retention.rewind(3) || (retention.getUnsentSize() != 5) || (retention.getStartOffset() != 3))
+        Serial.printf("--Test #%d failed. Rewind\n", index);
+    if (retention.append(data, 16) != 3)
+        Serial.printf("--Test #%d failed. Room not released\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for session resumption ");
+    Serial.println("**************************************************");
+
+    Test_transfer(1, 0);
+    // Offsets wrap around
+    Test_transfer(2, 0xFFFFF000);
+    Test_bounds(3);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
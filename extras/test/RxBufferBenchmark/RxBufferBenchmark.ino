@@ -0,0 +1,121 @@
+/**
+ * @file RxBufferBenchmark.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Compare incoming data throughput with and without a receive buffer.
+ *        Bursts of packets are received, as happens when
+ *        write without response is allowed, while the reading task
+ *        is busy from time to time.
+ *
+ * @note No peer is needed. Incoming packets are simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include "NuStream.hpp"
+
+#define PACKET_SIZE 244
+#define PACKET_COUNT 2000
+#define BURST_SIZE 8
+#define READ_SIZE 61
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const uint8_t *data, size_t size)
+    {
+        NimBLEAttValue value(data, size);
+        receive(value);
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+void benchmark(const char *name, size_t rxBufferSize)
+{
+    SimulatedSession session;
+    session.setRxBufferSize(rxBufferSize);
+    session.setTimeout(ULONG_MAX);
+
+    uint8_t packet[PACKET_SIZE];
+    long long hostBlockedUs = 0;
+    long long hostMaxBlockedUs = 0;
+
+    auto start = ::std::chrono::steady_clock::now();
+    ::std::thread host([&]()
+                       {
+        uint8_t sequence = 0;
+        for (int i = 0; i < PACKET_COUNT; i++)
+        {
+            for (size_t j = 0; j < PACKET_SIZE; j++)
+                packet[j] = sequence++;
+            auto before = ::std::chrono::steady_clock::now();
+            session.feed(packet, PACKET_SIZE);
+            long long blockedUs = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                ::std::chrono::steady_clock::now() - before).count();
+            hostBlockedUs += blockedUs;
+            if (blockedUs > hostMaxBlockedUs)
+                hostMaxBlockedUs = blockedUs;
+            if ((i % BURST_SIZE) == (BURST_SIZE - 1))
+                // Next connection event
+                ::std::this_thread::sleep_for(::std::chrono::microseconds(500));
+        } });
+
+    // Read and check data. The reading task is busy from time to time.
+    uint8_t buffer[READ_SIZE];
+    uint8_t expected = 0;
+    size_t totalCount = 0;
+    bool ok = true;
+    while (totalCount < (PACKET_SIZE * PACKET_COUNT))
+    {
+        size_t count = session.readBytes(buffer, READ_SIZE);
+        for (size_t i = 0; i < count; i++)
+            ok = ok && (buffer[i] == expected++);
+        totalCount += count;
+        if ((totalCount % (READ_SIZE * 64)) < READ_SIZE)
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(2));
+    }
+    host.join();
+    long long elapsedUs = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                              ::std::chrono::steady_clock::now() - start)
+                              .count();
+
+    Serial.printf(
+        "%-14s: %8lld bytes/s, host task blocked %6lld us (max %5lld us) %s\n",
+        name,
+        (long long)totalCount * 1000000LL / elapsedUs,
+        hostBlockedUs,
+        hostMaxBlockedUs,
+        ok ? "" : "DATA MISMATCH");
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("-- GO --");
+    benchmark("No buffer", 0);
+    benchmark("1 KB buffer", 1024);
+    benchmark("4 KB buffer", 4096);
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file SemaphoreBenchmark.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Compare the available semaphore backends:
+ *        handoff latency between two tasks and uncontended overhead.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include "NuSemaphore.hpp"
+#include "cyan_semaphore.h"
+#if __cplusplus >= 202002L
+#include <semaphore>
+#endif
+
+#define HANDOFF_COUNT 20000
+
+//-----------------------------------------------------------------------------
+// Benchmarks
+//-----------------------------------------------------------------------------
+
+template <class Semaphore>
+void benchmark(const char *name)
+{
+    Semaphore ping{0};
+    Semaphore pong{0};
+
+    // Uncontended release/acquire in a single task
+    auto start = ::std::chrono::steady_clock::now();
+    for (int i = 0; i < HANDOFF_COUNT; i++)
+    {
+        ping.release();
+        ping.acquire();
+    }
+    auto elapsed = ::std::chrono::steady_clock::now() - start;
+    long long uncontendedNs =
+        ::std::chrono::duration_cast<::std::chrono::nanoseconds>(elapsed).count() / HANDOFF_COUNT;
+
+    // Ping-pong between two tasks (two handoffs per round trip)
+    ::std::thread peer([&]()
+                       {
+        for (int i = 0; i < HANDOFF_COUNT; i++)
+        {
+            ping.acquire();
+            pong.release();
+        } });
+    start = ::std::chrono::steady_clock::now();
+    for (int i = 0; i < HANDOFF_COUNT; i++)
+    {
+        ping.release();
+        pong.acquire();
+    }
+    elapsed = ::std::chrono::steady_clock::now() - start;
+    peer.join();
+    long long handoffNs =
+        ::std::chrono::duration_cast<::std::chrono::nanoseconds>(elapsed).count() / (2 * HANDOFF_COUNT);
+
+    Serial.printf("%-10s uncontended: %6lld ns  handoff: %8lld ns\n", name, uncontendedNs, handoffNs);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry points
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("*****************************************");
+    Serial.println(" Semaphore backend benchmark             ");
+    Serial.println("*****************************************");
+
+    benchmark<::cyan::binary_semaphore>("cyan");
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_STD)
+    benchmark<NuSStdBinarySemaphore>("std");
+#elif __cplusplus >= 202002L
+    benchmark<::std::binary_semaphore>("std");
+#endif
+    benchmark<NuSAtomicBinarySemaphore>("atomic");
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_FREERTOS)
+    benchmark<NuSFreeRTOSBinarySemaphore>("FreeRTOS");
+#endif
+
+    Serial.println("*****************************************");
+    Serial.println("END");
+    Serial.println("*****************************************");
+}
+
+void loop()
+{
+    delay(30000);
+}
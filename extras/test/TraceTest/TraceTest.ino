@@ -0,0 +1,184 @@
+/**
+ * @file TraceTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of the event trace
+ *
+ * @note Tracing must be enabled when building the library,
+ *       for example, with the build flag `-DNUS_TRACE_SIZE=1024`.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include "NuTrace.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class CapturedOutput : public Print
+{
+public:
+    ::std::string text;
+
+    virtual size_t write(uint8_t byte) override
+    {
+        text.push_back((char)byte);
+        return 1;
+    };
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        text.append((const char *)buffer, size);
+        return size;
+    };
+
+    // Records, ignoring comments
+    ::std::vector<::std::string> getLines()
+    {
+        ::std::vector<::std::string> result;
+        size_t start = 0;
+        size_t end;
+        while ((end = text.find('\n', start)) != ::std::string::npos)
+        {
+            if (text[start] != '#')
+                result.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+        return result;
+    };
+};
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_dump(int index)
+{
+    NuSTrace::clear();
+    NuSTrace::record(NUS_TRACE_AT_COMMAND, NUS_TRACE_BEGIN, NuSTrace::tag("CMD", 3));
+    NuSTrace::record(NUS_TRACE_NOTIFY, NUS_TRACE_INSTANT, 0x00010014);
+    NuSTrace::record(NUS_TRACE_AT_COMMAND, NUS_TRACE_END, NuSTrace::tag("CMD", 3));
+
+    CapturedOutput out;
+    size_t count = NuSTrace::dump(out);
+    ::std::vector<::std::string> lines = out.getLines();
+    if ((count != 3) || (lines.size() != 3))
+    {
+        Serial.printf("--Test #%d failed. %u records dumped\n", index, (unsigned int)count);
+        return;
+    }
+    unsigned int timestamp, task, arg;
+    char phase;
+    char event[32];
+    if ((sscanf(lines[1].c_str(), "%u %u %c %31s %x", &timestamp, &task, &phase, event, &arg) != 5) ||
+        (phase != 'i') || (::std::string(event) != "NOTIFY") || (arg != 0x00010014))
+        Serial.printf("--Test #%d failed. Wrong record: %s\n", index, lines[1].c_str());
+    if ((sscanf(lines[0].c_str(), "%u %u %c %31s %x", &timestamp, &task, &phase, event, &arg) != 5) ||
+        (phase != 'B') || (arg != 0x00444d43))
+        Serial.printf("--Test #%d failed. Wrong record: %s\n", index, lines[0].c_str());
+}
+
+void Test_overflow(int index)
+{
+    NuSTrace::clear();
+    for (int i = 0; i < NUS_TRACE_SIZE + 10; i++)
+        NuSTrace::record(NUS_TRACE_READ, NUS_TRACE_INSTANT, i);
+    if (NuSTrace::getLostCount() != 10)
+        Serial.printf("--Test #%d failed. %u records lost\n", index, (unsigned int)NuSTrace::getLostCount());
+
+    // Oldest records are overwritten
+    CapturedOutput out;
+    NuSTrace::dump(out);
+    ::std::vector<::std::string> lines = out.getLines();
+    unsigned int timestamp, task, arg;
+    char phase;
+    char event[32];
+    if (lines.empty() ||
+        (sscanf(lines[0].c_str(), "%u %u %c %31s %x", &timestamp, &task, &phase, event, &arg) != 5) ||
+        (arg != 10))
+        Serial.printf("--Test #%d failed. Oldest record is not #10\n", index);
+}
+
+void Test_concurrency(int index, int taskCount)
+{
+    // Many writers and a reader at the same time
+    NuSTrace::clear();
+    ::std::vector<::std::thread> writers;
+    for (int t = 0; t < taskCount; t++)
+        writers.push_back(::std::thread([]()
+                                        {
+            for (uint32_t i = 0; i < 10000; i++)
+                NuSTrace::record(NUS_TRACE_RX, NUS_TRACE_INSTANT, i); }));
+    size_t dumpedCount = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        CapturedOutput out;
+        dumpedCount += NuSTrace::dump(out);
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    // Records of each task are in order
+    CapturedOutput out;
+    NuSTrace::dump(out);
+    ::std::vector<::std::string> lines = out.getLines();
+    if (lines.size() != NUS_TRACE_SIZE)
+        Serial.printf("--Test #%d failed. %u records\n", index, (unsigned int)lines.size());
+    ::std::vector<long long> lastArg(256, -1);
+    for (auto &line : lines)
+    {
+        unsigned int timestamp, task, arg;
+        char phase;
+        char event[32];
+        if ((sscanf(line.c_str(), "%u %u %c %31s %x", &timestamp, &task, &phase, event, &arg) != 5) ||
+            (task >= lastArg.size()))
+        {
+            Serial.printf("--Test #%d failed. Torn record: %s\n", index, line.c_str());
+            return;
+        }
+        if ((long long)arg <= lastArg[task])
+        {
+            Serial.printf("--Test #%d failed. Out of order: %s\n", index, line.c_str());
+            return;
+        }
+        lastArg[task] = arg;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("****************************");
+    Serial.println(" Automated test for NuSTrace");
+    Serial.println("****************************");
+
+    if (NuSTrace::isEnabled())
+    {
+        Test_dump(1);
+        Test_overflow(2);
+        Test_concurrency(3, 2);
+        Test_concurrency(4, 4);
+    }
+    else
+        Serial.println("Tracing is disabled. Define NUS_TRACE_SIZE.");
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file VirtualClockTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of timeouts under a virtual clock
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *       build_opt.h defines NUS_VIRTUAL_CLOCK for the whole build.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "NuSerial.hpp"
+
+#if !defined(NUS_VIRTUAL_CLOCK)
+#error This test requires NUS_VIRTUAL_CLOCK (see build_opt.h)
+#endif
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const char *text)
+    {
+        NimBLEAttValue value((const uint8_t *)text, strlen(text));
+        receive(value);
+    };
+
+    // Called from the BLE host task
+    void simulateDisconnection()
+    {
+        hangUp();
+    };
+};
+
+long long elapsedMillis(::std::chrono::steady_clock::time_point start)
+{
+    return ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+               ::std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+void Test_semaphore(int index)
+{
+    nus_semaphore semaphore{0};
+    ::std::atomic<int> result{-1};
+    ::std::thread waiter([&]()
+                         { result = semaphore.try_acquire_for(::std::chrono::hours(1)) ? 1 : 0; });
+    if (!NuSVirtualClock::waitUntilBlocked(1))
+        Serial.printf("--Test #%d failed. Waiter not blocked\n", index);
+
+    // Not expired yet
+    NuSVirtualClock::advance(::std::chrono::minutes(59));
+    delay(20);
+    if (result != -1)
+        Serial.printf("--Test #%d failed. Expired too early\n", index);
+
+    NuSVirtualClock::advance(::std::chrono::minutes(1));
+    waiter.join();
+    if (result != 0)
+        Serial.printf("--Test #%d failed. Did not expire\n", index);
+    if (NuSVirtualClock::getBlockedCount() != 0)
+        Serial.printf("--Test #%d failed. Blocked count is %u\n",
+                      index, (unsigned int)NuSVirtualClock::getBlockedCount());
+
+    // Released before expiration
+    waiter = ::std::thread([&]()
+                           { result = semaphore.try_acquire_for(::std::chrono::seconds(10)) ? 1 : 0; });
+    NuSVirtualClock::waitUntilBlocked(1);
+    semaphore.release();
+    waiter.join();
+    if (result != 1)
+        Serial.printf("--Test #%d failed. Not acquired\n", index);
+}
+
+void Test_realTimeWait(int index)
+{
+    // Waits with a deadline in real time are not affected
+    nus_semaphore semaphore{0};
+    auto start = ::std::chrono::steady_clock::now();
+    bool acquired = semaphore.try_acquire_until(start + ::std::chrono::milliseconds(50));
+    long long elapsed = elapsedMillis(start);
+    if (acquired || (elapsed < 50) || (elapsed > 500))
+        Serial.printf("--Test #%d failed. Real time wait took %lld ms\n", index, elapsed);
+}
+
+void Test_readTimeouts(int index, size_t rxBufferSize, unsigned int scenarioCount)
+{
+    // Many long timeouts in a short real time
+    auto start = ::std::chrono::steady_clock::now();
+    for (unsigned int scenario = 0; scenario < scenarioCount; scenario++)
+    {
+        SimulatedSession session;
+        session.setRxBufferSize(rxBufferSize);
+        session.setTimeout(60000);
+        session.feed("ab");
+        uint8_t buffer[16];
+        size_t count = 0;
+        ::std::thread reader([&]()
+                             { count = session.readBytes(buffer, sizeof(buffer)); });
+        NuSVirtualClock::waitUntilBlocked(1);
+        if ((scenario % 2) == 0)
+            NuSVirtualClock::advance(::std::chrono::milliseconds(60000));
+        else
+            session.simulateDisconnection();
+        reader.join();
+        if ((count != 2) || (memcmp(buffer, "ab", 2) != 0))
+        {
+            Serial.printf("--Test #%d failed. Scenario %u: expected 2 bytes. Found %d\n",
+                          index, scenario, (int)count);
+            return;
+        }
+    }
+    long long elapsed = elapsedMillis(start);
+    if (elapsed > (long long)scenarioCount)
+        Serial.printf("--Test #%d failed. %u scenarios took %lld ms\n", index, scenarioCount, elapsed);
+}
+
+void Test_connect(int index)
+{
+    ::std::atomic<int> result{-1};
+    ::std::thread waiter([&]()
+                         { result = NuSerial.connect(5000) ? 1 : 0; });
+    NuSVirtualClock::waitUntilBlocked(1);
+    NuSVirtualClock::advance(::std::chrono::milliseconds(4999));
+    delay(20);
+    if (result != -1)
+        Serial.printf("--Test #%d failed. Expired too early\n", index);
+    NuSVirtualClock::advance(::std::chrono::milliseconds(1));
+    waiter.join();
+    if (result != 0)
+        Serial.printf("--Test #%d failed. Did not expire\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for timeouts under a virtual clock ");
+    Serial.println("**************************************************");
+
+    Test_semaphore(1);
+    Test_realTimeWait(2);
+    Test_readTimeouts(3, 0, 1000);
+    Test_readTimeouts(4, 1024, 1000);
+    Test_connect(5);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
@@ -0,0 +1 @@
+-DNUS_VIRTUAL_CLOCK
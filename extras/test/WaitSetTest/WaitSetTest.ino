@@ -0,0 +1,200 @@
+/**
+ * @file WaitSetTest.ino
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ *
+ * @brief Automated test of wait sets
+ *
+ * @note No peer is needed. Incoming data is simulated.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include <Arduino.h>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "NuWaitSet.hpp"
+
+//-----------------------------------------------------------------------------
+// Mocks
+//-----------------------------------------------------------------------------
+
+class SimulatedSession : public NordicUARTSession
+{
+public:
+    // Called from the BLE host task
+    void feed(const char *text)
+    {
+        NimBLEAttValue value((const uint8_t *)text, strlen(text));
+        receive(value);
+    };
+
+    // Called from the BLE host task
+    void simulateDisconnection()
+    {
+        hangUp();
+    };
+};
+
+class SimulatedUART : public Stream
+{
+public:
+    ::std::atomic<int> pending{0};
+
+    virtual int available() override { return pending; };
+    virtual int read() override { return (pending-- > 0) ? 'x' : -1; };
+    virtual int peek() override { return (pending > 0) ? 'x' : -1; };
+    virtual size_t write(uint8_t byte) override { return 1; };
+};
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+long long elapsedMillis(::std::chrono::steady_clock::time_point start)
+{
+    return ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+               ::std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+void Test_timeout(int index)
+{
+    SimulatedSession session1, session2;
+    NuSWaitSet waitSet;
+    waitSet.add(session1);
+    waitSet.add(session2);
+    auto start = ::std::chrono::steady_clock::now();
+    int count = waitSet.wait(100);
+    long long elapsed = elapsedMillis(start);
+
+    if (count != 0)
+        Serial.printf("--Test #%d failed. Expected no events. Found %d\n", index, count);
+    if (elapsed < 100)
+        Serial.printf("--Test #%d failed. Timeout too short (%lld ms)\n", index, elapsed);
+}
+
+void Test_readable(int index)
+{
+    SimulatedSession session1, session2;
+    NuSWaitSet waitSet;
+    int index1 = waitSet.add(session1);
+    int index2 = waitSet.add(session2);
+
+    ::std::thread host([&]()
+                       {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        session2.feed("hello"); });
+    auto start = ::std::chrono::steady_clock::now();
+    int count = waitSet.wait();
+    long long elapsed = elapsedMillis(start);
+    host.join();
+
+    if (count != 1)
+        Serial.printf("--Test #%d failed. Expected 1 event. Found %d\n", index, count);
+    if ((waitSet.getEvents(index1) != 0) || (waitSet.getEvents(index2) != NUS_WAIT_READABLE))
+        Serial.printf("--Test #%d failed. Wrong events\n", index);
+    if (elapsed < 40)
+        Serial.printf("--Test #%d failed. Awakened too soon (%lld ms)\n", index, elapsed);
+    char buffer[8];
+    size_t size = session2.readBytes(buffer, session2.available());
+    if ((size != 5) || (waitSet.poll() != 0))
+        Serial.printf("--Test #%d failed. Still readable after reading\n", index);
+}
+
+void Test_disconnected(int index)
+{
+    SimulatedSession session;
+    NuSWaitSet waitSet;
+    int sessionIndex = waitSet.add(session, NUS_WAIT_READABLE | NUS_WAIT_DISCONNECTED);
+
+    // Note: a session not bound to any peer is not connected
+    int count = waitSet.wait(100);
+    if ((count != 1) || (waitSet.getEvents(sessionIndex) != NUS_WAIT_DISCONNECTED))
+        Serial.printf("--Test #%d failed. Disconnection not reported\n", index);
+}
+
+void Test_arduinoStream(int index)
+{
+    SimulatedSession session;
+    SimulatedUART uart;
+    NuSWaitSet waitSet;
+    waitSet.add(session);
+    int uartIndex = waitSet.add(uart);
+    waitSet.setPollingInterval(5);
+
+    ::std::thread other([&]()
+                        {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+        uart.pending = 3; });
+    int count = waitSet.wait(1000);
+    other.join();
+
+    if ((count != 1) || (waitSet.getEvents(uartIndex) != NUS_WAIT_READABLE))
+        Serial.printf("--Test #%d failed. Arduino stream not readable\n", index);
+}
+
+void Test_exclusive(int index)
+{
+    SimulatedSession session;
+    NuSWaitSet waitSet1;
+    NuSWaitSet waitSet2;
+    if (waitSet1.add(session) != 0)
+        Serial.printf("--Test #%d failed. Not added\n", index);
+    if (waitSet2.add(session) != -1)
+        Serial.printf("--Test #%d failed. Watched by two wait sets\n", index);
+    waitSet1.clear();
+    if (waitSet2.add(session) != 0)
+        Serial.printf("--Test #%d failed. Not added after clear()\n", index);
+}
+
+void Test_manyEvents(int index)
+{
+    SimulatedSession sessions[4];
+    NuSWaitSet waitSet;
+    for (auto &session : sessions)
+        waitSet.add(session);
+
+    ::std::thread host([&]()
+                       {
+        sessions[1].feed("a");
+        sessions[3].feed("b"); });
+    host.join();
+    int count = waitSet.wait(100);
+
+    if ((count != 2) ||
+        (waitSet.getEvents(1) != NUS_WAIT_READABLE) ||
+        (waitSet.getEvents(3) != NUS_WAIT_READABLE))
+        Serial.printf("--Test #%d failed. Expected 2 events. Found %d\n", index, count);
+    if (waitSet.getEvents(100) != 0)
+        Serial.printf("--Test #%d failed. Events at invalid index\n", index);
+}
+
+//-----------------------------------------------------------------------------
+// Arduino entry point
+//-----------------------------------------------------------------------------
+
+void setup()
+{
+    // Initialize serial monitor
+    Serial.begin(115200);
+    Serial.println("**************************************************");
+    Serial.println(" Automated test for wait sets ");
+    Serial.println("**************************************************");
+
+    Test_timeout(1);
+    Test_readable(2);
+    Test_disconnected(3);
+    Test_arduinoStream(4);
+    Test_exclusive(5);
+    Test_manyEvents(6);
+
+    Serial.println("-- END --");
+}
+
+void loop()
+{
+    delay(30000);
+}
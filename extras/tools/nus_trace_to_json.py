@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Convert the output of NuSTrace::dump() into Chrome trace JSON.
+
+Open the result in chrome://tracing or https://ui.perfetto.dev.
+
+Usage:
+    nus_trace_to_json.py [input.txt [output.json]]
+
+Standard input and output are used if not given.
+Lines not being trace records (for example, other serial output)
+are ignored, so a serial monitor log can be converted as is.
+
+Author: Ángel Fernández Pineda. Madrid. Spain.
+License: Creative Commons Attribution 4.0 International (CC BY 4.0)
+"""
+
+import json
+import re
+import sys
+
+RECORD = re.compile(r"^\s*(\d+) (\d+) ([BEi]) ([A-Z_]+) ([0-9a-fA-F]{8})\s*$")
+
+# Events having a connection handle and a size as argument
+CONN_AND_SIZE = {"RX", "NOTIFY", "NOTIFY_FAILED"}
+# Events having a connection handle as argument
+CONN = {"SUBSCRIBE", "UNSUBSCRIBE"}
+# Events having a command name as argument
+COMMAND = {"AT_COMMAND", "CLI_COMMAND"}
+
+
+def decode_tag(arg):
+    chars = []
+    for index in range(4):
+        code = (arg >> (8 * index)) & 0xFF
+        if code == 0:
+            break
+        chars.append(chr(code))
+    return "".join(chars)
+
+
+def decode_args(event, arg):
+    if event in CONN_AND_SIZE:
+        return {"conn": arg >> 16, "size": arg & 0xFFFF}
+    if event in CONN:
+        return {"conn": arg}
+    if event in COMMAND:
+        return {"command": decode_tag(arg)}
+    return {"arg": arg}
+
+
+def convert(lines):
+    events = []
+    # Timestamps are 32-bit microseconds, so they wrap around
+    offset = 0
+    last = None
+    for line in lines:
+        match = RECORD.match(line)
+        if not match:
+            continue
+        timestamp, task, phase, event, arg = match.groups()
+        timestamp = int(timestamp)
+        arg = int(arg, 16)
+        if (last is not None) and (timestamp + offset < last - (1 << 31)):
+            offset += 1 << 32
+        last = timestamp + offset
+        name = event
+        if (event in COMMAND) and (phase == "B"):
+            name = event + " " + decode_tag(arg)
+        record = {
+            "name": name,
+            "ph": phase,
+            "ts": last,
+            "pid": 1,
+            "tid": int(task),
+            "args": decode_args(event, arg),
+        }
+        if phase == "i":
+            record["s"] = "t"
+        events.append(record)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main(argv):
+    source = open(argv[1], encoding="utf-8", errors="replace") if len(argv) > 1 else sys.stdin
+    target = open(argv[2], "w", encoding="utf-8") if len(argv) > 2 else sys.stdout
+    with source, target:
+        json.dump(convert(source), target, indent=1)
+        target.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -9,32 +9,45 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include "NuATCommandParserLegacy2.hpp"
 
 //-----------------------------------------------------------------------------
 // Parsing macros
 //-----------------------------------------------------------------------------
 
-inline bool isATPreamble(const char *in, bool allowLowerCase)
+// Note: all the following functions work within the bounds
+// given by `end` (one byte past the last byte in the command line),
+// so they do not rely on null-terminated strings.
+
+inline bool isATPreamble(const char *in, const char *end, bool allowLowerCase)
 {
-    return ((in[0] == 'A') && (in[1] == 'T')) || (allowLowerCase && (in[0] == 'a') && (in[1] == 't'));
+    return ((end - in) >= 2) &&
+           (((in[0] == 'A') && (in[1] == 'T')) || (allowLowerCase && (in[0] == 'a') && (in[1] == 't')));
 }
 
-inline bool isCommandEndToken(const char c)
+inline bool isCommandEndToken(const char *in, const char *end)
 {
-    return (c == '\n') || (c == '\0') || (c == ';');
+    return (in >= end) || (in[0] == '\n') || (in[0] == '\0') || (in[0] == ';');
 }
 
-bool isAlphaString(const char *in)
+inline bool isStringEndToken(const char *in, const char *end)
 {
-    while (((in[0] >= 'A') && (in[0] <= 'Z')) || ((in[0] >= 'a') && (in[0] <= 'z')))
-        in++;
-    return (in[0] == '\0');
+    // Note: null characters are allowed inside string parameters
+    return (in >= end) || (in[0] == '\n') || (in[0] == ';');
+}
+
+bool isAlphaString(const char *in, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        if (!(((in[i] >= 'A') && (in[i] <= 'Z')) || ((in[i] >= 'a') && (in[i] <= 'z'))))
+            return false;
+    return true;
 }
 
-const char *followingCommand(const char *in, NuATCommandResult_t conditional = AT_RESULT_OK)
+const char *followingCommand(const char *in, const char *end, NuATCommandResult_t conditional = AT_RESULT_OK)
 {
-    if ((conditional < 0) || (in[0] == '\0') || (in[0] == '\n'))
+    if ((conditional < 0) || (in >= end) || (in[0] == '\0') || (in[0] == '\n'))
         return nullptr;
     else if (in[0] == ';')
         return in + 1;
@@ -43,30 +56,64 @@ const char *followingCommand(const char *in, NuATCommandResult_t conditional = A
         return nullptr;
 }
 
-const char *findSuffix(const char *in)
+const char *findSuffix(const char *in, const char *end)
 {
-    while ((in[0] != '\0') && (in[0] != '\n') && (in[0] != ';') && (in[0] != '?') && (in[0] != '='))
+    while ((in < end) && (in[0] != '\0') && (in[0] != '\n') && (in[0] != ';') && (in[0] != '?') && (in[0] != '='))
         in++;
     return in;
 }
 
+inline uint32_t hashCommandName(const char *name, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 //-----------------------------------------------------------------------------
 // Parsing machinery
 //-----------------------------------------------------------------------------
 
 void NuATCommandParser::parseCommandLine(const char *in)
+{
+    if (in)
+        parseCommandLine((const uint8_t *)in, strlen(in));
+}
+
+void NuATCommandParser::parseCommandLine(const uint8_t *commandLine, size_t size)
 {
     lastParsingResult = AT_PR_NO_CALLBACKS;
     if (!pCmdCallbacks)
         // no callbacks: nothing to do here
         return;
 
+    // Allocate the scratch buffer once.
+    // It is reused by all the commands in this and following command lines.
+    if (!pBuffer)
+    {
+        pBuffer = (char *)malloc(bufferSize);
+        if (!pBuffer)
+        {
+            lastParsingResult = AT_PR_NO_HEAP;
+            printResultResponse(AT_RESULT_ERROR);
+            return;
+        }
+    }
+
+    const char *in = (const char *)commandLine;
+    const char *end = in + size;
+
     // Detect AT preamble
-    if (isATPreamble(in, bLowerCasePreamble))
+    if (isATPreamble(in, end, bLowerCasePreamble))
     {
         // skip preamble
         in = in + 2;
-        if ((in[0] == '\n') || (in[0] == '\0'))
+        if ((in >= end) || (in[0] == '\n') || (in[0] == '\0'))
         {
             // This is a preamble with no commands at all.
             // Response is OK to signal that AT commands are accepted.
@@ -81,6 +128,15 @@ void NuATCommandParser::parseCommandLine(const char *in)
         lastParsingResult = AT_PR_NO_PREAMBLE;
         try
         {
+            // Note: a null-terminated string is required here.
+            // Unless already terminated, copy to the scratch buffer.
+            if (!memchr(in, '\0', size))
+            {
+                size_t length = (size < bufferSize) ? size : bufferSize - 1;
+                memcpy(pBuffer, in, length);
+                pBuffer[length] = '\0';
+                in = pBuffer;
+            }
             pCmdCallbacks->onNonATCommand(in);
         }
         catch (...)
@@ -93,9 +149,8 @@ void NuATCommandParser::parseCommandLine(const char *in)
     int commandIndex = 0;
     do
     {
-        // Serial.printf("parseCommandLine(): %s\n", in);
         lastParsingResult = AT_PR_OK; // may be changed later
-        in = parseSingleCommand(in);
+        in = parseSingleCommand(in, end);
         try
         {
             pCmdCallbacks->onFinished(commandIndex++, lastParsingResult);
@@ -106,83 +161,71 @@ void NuATCommandParser::parseCommandLine(const char *in)
     } while (in);
 }
 
-const char *NuATCommandParser::parseSingleCommand(const char *in)
+const char *NuATCommandParser::parseSingleCommand(const char *in, const char *end)
 {
     // Detect prefix.
     // Note: if prefix is '&', just a single letter is allowed as command name
-    // Serial.printf("parseSingleCommand(): %s\n", in);
-    if ((in[0] == '&') || (in[0] == '+'))
+    if ((in < end) && ((in[0] == '&') || (in[0] == '+')))
     {
         // Prefix is valid, now detect suffix.
         // Text between a prefix and a suffix is a command name.
         // Text between a prefix and ";", "\n" or "\0" is also a command name.
-        const char *suffix = findSuffix(in + 1);
-        size_t cmdNameLength = suffix - (in + 1);
+        const char *name = in + 1;
+        const char *suffix = findSuffix(name, end);
+        size_t cmdNameLength = suffix - name;
         if ((cmdNameLength > 0) && (cmdNameLength < bufferSize) && ((in[0] == '+') || (cmdNameLength == 1)))
         {
-            // Serial.printf("parseSingleCommand(1): %s. Suffix: %s. Length: %d\n", in + 1, suffix, cmdNameLength);
-            // store command name in "cmdName" as a null-terminated string
-            // char cmdName[bufferSize];
-            char *cmdName = (char *)malloc(cmdNameLength + 1);
-            if (!cmdName)
-            {
-                lastParsingResult = AT_PR_NO_HEAP;
-                printResultResponse(AT_RESULT_ERROR);
-                return nullptr;
-            }
-            // memcpy(cmdName, in + 1, cmdNameLength);
-            for (int i = 0; i < cmdNameLength; i++)
-                cmdName[i] = *(in + 1 + i);
-            cmdName[cmdNameLength] = '\0';
-            // Serial.printf("parseSingleCommand(2): %s. Suffix: %s. Name: %s. Length: %d. pName %d. pIn+1:%d\n", in + 1, suffix, cmdName, cmdNameLength, cmdName, in + 1);
-
-            if (isAlphaString(cmdName))
+            if (isAlphaString(name, cmdNameLength))
             {
                 // check if command is supported
-                int commandId;
-                try
+                uint32_t hash = hashCommandName(name, cmdNameLength);
+                int commandId = getCachedATCommandId(name, cmdNameLength, hash);
+                if (commandId < 0)
                 {
-                    commandId = pCmdCallbacks->getATCommandId(cmdName);
-                }
-                catch (...)
-                {
-                    commandId = -1;
+                    // Cache miss.
+                    // Store command name in the scratch buffer as a null-terminated string.
+                    // Note: the command name is no longer needed after getATCommandId(),
+                    // so the buffer may be reused for parameters later.
+                    char *cmdName = pBuffer;
+                    memcpy(cmdName, name, cmdNameLength);
+                    cmdName[cmdNameLength] = '\0';
+                    try
+                    {
+                        commandId = pCmdCallbacks->getATCommandId(cmdName);
+                    }
+                    catch (...)
+                    {
+                        commandId = -1;
+                    }
+                    if (commandId >= 0)
+                        cacheATCommandId(name, cmdNameLength, hash, commandId);
                 }
                 if (commandId >= 0)
-                {
                     // continue parsing
-                    free(cmdName);
-                    return parseAction(suffix, commandId);
-                }
+                    return parseAction(suffix, end, commandId);
                 else // this command is not supported
                     lastParsingResult = AT_PR_UNSUPPORTED_CMD;
             }
             else // command name contains non-alphabetic characters
                 lastParsingResult = AT_PR_INVALID_CMD2;
-
-            free(cmdName);
         }
         else // error: no command name, buffer overflow or command name has "&" prefix but more than one letter
             lastParsingResult = AT_PR_INVALID_CMD1;
 
     } // invalid prefix
     else
-    {
         lastParsingResult = AT_PR_INVALID_PREFIX;
-        // Serial.printf("Invalid prefix\n");
-    }
     printResultResponse(AT_RESULT_ERROR);
     return nullptr;
 }
 
-const char *NuATCommandParser::parseAction(const char *in, int commandId)
+const char *NuATCommandParser::parseAction(const char *in, const char *end, int commandId)
 {
-    // Serial.printf("parseAction(): %s\n", in);
     //  Note: "in" points to a suffix or an end-of-command token
-    if ((in[0] == '=') && (in[1] == '?'))
+    if ((in < end) && (in[0] == '=') && ((in + 1) < end) && (in[1] == '?'))
     {
         // This is a TEST command
-        if (isCommandEndToken(in[2]))
+        if (isCommandEndToken(in + 2, end))
         {
             NuATCommandResult_t result = AT_RESULT_OK;
             try
@@ -194,13 +237,13 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
                 result = AT_RESULT_ERROR;
             }
             printResultResponse(result);
-            return followingCommand(in + 2, result);
+            return followingCommand(in + 2, end, result);
         } // else syntax error
     }
-    else if (in[0] == '?')
+    else if ((in < end) && (in[0] == '?'))
     {
         // This is a READ/QUERY command
-        if (isCommandEndToken(in[1]))
+        if (isCommandEndToken(in + 1, end))
         {
             NuATCommandResult_t response;
             try
@@ -212,15 +255,15 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
                 response = AT_RESULT_ERROR;
             }
             printResultResponse(response);
-            return followingCommand(in + 1, response);
+            return followingCommand(in + 1, end, response);
         } // else syntax Error
     }
-    else if (in[0] == '=')
+    else if ((in < end) && (in[0] == '='))
     {
         // This is a SET/WRITE command
-        return parseWriteParameters(in + 1, commandId);
+        return parseWriteParameters(in + 1, end, commandId);
     }
-    else if (isCommandEndToken(in[0]))
+    else if (isCommandEndToken(in, end))
     {
         // This is an EXECUTE Command
         NuATCommandResult_t response;
@@ -233,38 +276,32 @@ const char *NuATCommandParser::parseAction(const char *in, int commandId)
             response = AT_RESULT_ERROR;
         }
         printResultResponse(response);
-        return followingCommand(in, response);
+        return followingCommand(in, end, response);
     } // else syntax error
     lastParsingResult = AT_PR_END_TOKEN_EXPECTED;
     printResultResponse(AT_RESULT_ERROR);
     return nullptr;
 }
 
-const char *NuATCommandParser::parseWriteParameters(const char *in, int commandId)
+const char *NuATCommandParser::parseWriteParameters(const char *in, const char *end, int commandId)
 {
     // See https://docs.espressif.com/projects/esp-at/en/release-v2.2.0.0_esp8266/AT_Command_Set/index.html
     // about parameters' syntax.
 
-    NuATCommandParameters_t paramList;
-    // char buffer[bufferSize];
-    char *buffer = (char *)malloc(bufferSize);
-    if (!buffer)
-    {
-        lastParsingResult = AT_PR_NO_HEAP;
-        printResultResponse(AT_RESULT_ERROR);
-        return nullptr;
-    }
+    // Note: paramList keeps its capacity between commands
+    paramList.clear();
+    char *buffer = pBuffer;
     size_t l = 0;
     bool doubleQuotes = false;
     bool syntaxError = false;
     char *currentParam = buffer;
 
     // Parse, tokenize and copy parameters to buffer
-    while (!isCommandEndToken(in[0]) && (l < bufferSize))
+    while ((l < bufferSize) && !(doubleQuotes ? isStringEndToken(in, end) : isCommandEndToken(in, end)))
     {
         if (doubleQuotes)
         {
-            if ((in[0] == '\"') && ((in[1] == ',') || isCommandEndToken(in[1])))
+            if ((in[0] == '\"') && ((((in + 1) < end) && (in[1] == ',')) || isCommandEndToken(in + 1, end)))
             {
                 // Closing double quotes
                 doubleQuotes = false;
@@ -277,7 +314,7 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
                 syntaxError = true;
                 break;
             }
-            else if ((in[0] == '\\') && (in[1] != '\0'))
+            else if ((in[0] == '\\') && ((in + 1) < end))
             {
                 // Escaped character
                 in++;
@@ -306,7 +343,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
         // copy char to buffer and tokenize
         if (in[0] == ',')
         {
-            // Serial.println("param token");
             if (doubleQuotes)
             {
                 // Missing closing double quotes
@@ -318,7 +354,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
                 // End of this parameter
                 buffer[l++] = '\0';
                 paramList.push_back(currentParam);
-                // Serial.printf("Prev param: %s\n", currentParam);
                 currentParam = (buffer + l);
                 in++;
             }
@@ -333,7 +368,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // check for syntax errors or missing double quotes in last parameter
     if (syntaxError || doubleQuotes)
     {
-        free(buffer);
         lastParsingResult = AT_PR_ILL_FORMED_STRING;
         printResultResponse(AT_RESULT_ERROR);
         return nullptr;
@@ -342,7 +376,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // check for buffer overflow
     if (l >= bufferSize)
     {
-        free(buffer);
         lastParsingResult = AT_PR_SET_OVERFLOW;
         printResultResponse(AT_RESULT_ERROR);
         return nullptr;
@@ -351,7 +384,6 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     // Add the last parameter
     buffer[l] = '\0';
     paramList.push_back(currentParam);
-    // Serial.printf("Last param: %s\n", currentParam);
 
     // Invoke callback
     NuATCommandResult_t response;
@@ -363,9 +395,53 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
     {
         response = AT_RESULT_ERROR;
     }
-    free(buffer);
     printResultResponse(response);
-    return followingCommand(in, response);
+    return followingCommand(in, end, response);
+}
+
+//-----------------------------------------------------------------------------
+// Command ID cache
+//-----------------------------------------------------------------------------
+
+int NuATCommandParser::getCachedATCommandId(const char *name, size_t length, uint32_t hash)
+{
+    // Linear probing. Empty slots have an empty name.
+    size_t slot = hash % ID_CACHE_SIZE;
+    for (size_t probe = 0; probe < ID_CACHE_SIZE; probe++)
+    {
+        auto &entry = idCache[slot];
+        if (entry.length == 0)
+            return -1;
+        if ((entry.hash == hash) &&
+            (entry.length == length) &&
+            (memcmp(entry.name, name, length) == 0))
+            return entry.id;
+        slot = (slot + 1) % ID_CACHE_SIZE;
+    }
+    return -1;
+}
+
+void NuATCommandParser::cacheATCommandId(const char *name, size_t length, uint32_t hash, int id)
+{
+    if ((idCacheCount >= ID_CACHE_SIZE) || (length > ID_CACHE_NAME_SIZE))
+        // Cache is full or the name is too long.
+        // Command IDs will be resolved by the callbacks.
+        return;
+    size_t slot = hash % ID_CACHE_SIZE;
+    while (idCache[slot].length != 0)
+        slot = (slot + 1) % ID_CACHE_SIZE;
+    idCache[slot].hash = hash;
+    idCache[slot].id = id;
+    idCache[slot].length = length;
+    memcpy(idCache[slot].name, name, length);
+    idCacheCount++;
+}
+
+void NuATCommandParser::invalidateATCommandIdCache()
+{
+    for (auto &entry : idCache)
+        entry.length = 0;
+    idCacheCount = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -374,13 +450,21 @@ const char *NuATCommandParser::parseWriteParameters(const char *in, int commandI
 
 void NuATCommandParser::setBufferSize(size_t size)
 {
-    if (size > 5)
+    if (size < 5)
+        // absolute minimum
+        size = 5;
+    if (size != bufferSize)
     {
         bufferSize = size;
+        // Will be allocated again at the next command line
+        free(pBuffer);
+        pBuffer = nullptr;
     }
-    else
-        // absolute minimum
-        bufferSize = 5;
+}
+
+NuATCommandParser::~NuATCommandParser()
+{
+    free(pBuffer);
 }
 
 //-----------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 #define __NU_AT_COMMAND_PARSER_LEGACY2_HPP__
 
 #include <vector>
+#include <cstdint>
 
 /**
  * @brief Pseudo-standardized result of AT command execution
@@ -83,6 +84,8 @@ public:
      *
      * @param text Null-terminated incoming string,
      *             not matching an AT command line.
+     *             Unless terminated by the sender, truncated to
+     *             the parsing buffer size. See NuATCommandParser::setBufferSize().
      */
     virtual void onNonATCommand(const char text[]){};
 
@@ -102,6 +105,11 @@ public:
      *        Will comprise alphabetic characters only, as required by the AT
      *        standard, so don't expect something like "PARAM1".
      *
+     * @note The ID of a supported command name is cached by the parser,
+     *       so this method is not called again for the same command name.
+     *       If the set of supported commands changes at run time,
+     *       call NuATCommandParser::invalidateATCommandIdCache().
+     *
      * @return int Any negative value if @p commandName is not a supported
      *         AT command. Any positive number as an **unique**
      *         identification (ID) of a supported command name.
@@ -201,17 +209,33 @@ public:
     void setATCallbacks(NuATCommandCallbacks *pCallbacks)
     {
         pCmdCallbacks = pCallbacks;
+        invalidateATCommandIdCache();
     };
 
+    /**
+     * @brief Forget all cached command IDs
+     *
+     * @note Command IDs returned by NuATCommandCallbacks::getATCommandId()
+     *       are cached, so that method is called just once for each
+     *       supported command name. Call this method if
+     *       getATCommandId() would return a different ID now.
+     *
+     * @note Not thread-safe.
+     */
+    void invalidateATCommandIdCache();
+
     /**
      * @brief Size of the parsing buffer
      *
      * @note An error response will be printed if command names or
      *       command parameters exceed this size. Buffer is allocated
-     *       in the heap.
+     *       in the heap just once, at the first parsed command line,
+     *       and reused for all the following commands.
      *
      * @note Default size is 42 bytes
      *
+     * @note Not thread-safe. Should be called before start().
+     *
      * @param size Size in bytes
      */
     void setBufferSize(size_t size);
@@ -239,18 +263,64 @@ public:
      */
     NuATParsingResult_t lastParsingResult = AT_PR_OK;
 
+public:
+    NuATCommandParser() {};
+    NuATCommandParser(const NuATCommandParser &) = delete;
+    NuATCommandParser &operator=(const NuATCommandParser &) = delete;
+    virtual ~NuATCommandParser();
+
 private:
     NuATCommandCallbacks *pCmdCallbacks = nullptr;
     size_t bufferSize = 42;
     bool bLowerCasePreamble = false;
+    // Scratch buffer for command names and parameters
+    char *pBuffer = nullptr;
+    // Parameters of the last SET command (pointing to pBuffer)
+    NuATCommandParameters_t paramList;
+
+    // Command ID cache (open addressing hash table).
+    // Empty slots have a zero length. Longer names are not cached.
+    static constexpr size_t ID_CACHE_SIZE = 16;
+    static constexpr size_t ID_CACHE_NAME_SIZE = 16;
+    struct
+    {
+        uint32_t hash;
+        int id;
+        uint8_t length;
+        char name[ID_CACHE_NAME_SIZE];
+    } idCache[ID_CACHE_SIZE] = {};
+    size_t idCacheCount = 0;
+
+    int getCachedATCommandId(const char *name, size_t length, uint32_t hash);
+    void cacheATCommandId(const char *name, size_t length, uint32_t hash, int id);
 
-    const char *parseSingleCommand(const char *in);
-    const char *parseAction(const char *in, int commandId);
-    const char *parseWriteParameters(const char *in, int commandId);
+    const char *parseSingleCommand(const char *in, const char *end);
+    const char *parseAction(const char *in, const char *end, int commandId);
+    const char *parseWriteParameters(const char *in, const char *end, int commandId);
 
 protected:
     virtual void printResultResponse(const NuATCommandResult_t response);
+
+    /**
+     * @brief Parse and execute a null-terminated command line
+     *
+     * @param in Null-terminated command line
+     */
     void parseCommandLine(const char *in);
+
+    /**
+     * @brief Parse and execute a command line
+     *
+     * @note Parsing never goes beyond @p size, so @p commandLine does not
+     *       need to be null-terminated. Null characters are allowed
+     *       inside string parameters (between double quotes), but
+     *       note that parameters are given to
+     *       NuATCommandCallbacks::onSet() as null-terminated strings.
+     *
+     * @param commandLine Pointer to a buffer containing a command line
+     * @param size Size in bytes of @p commandLine
+     */
+    void parseCommandLine(const uint8_t *commandLine, size_t size);
 };
 
 #endif
\ No newline at end of file
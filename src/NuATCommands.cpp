@@ -27,6 +27,9 @@ void NuATCommandProcessor::onWrite(
     // Incoming data
     NimBLEAttValue incomingPacket = pCharacteristic->getValue();
     const char *in = incomingPacket.c_str();
+
+    // Responses go to the requesting peer only
+    replyTo(connInfo.getConnHandle());
     if ((uMaxCommandLineLength > 0) &&
         (incomingPacket.size() > uMaxCommandLineLength))
     {
@@ -35,6 +38,7 @@ void NuATCommandProcessor::onWrite(
     }
     else
         execute((const uint8_t *)in, incomingPacket.size());
+    replyTo(BLE_HS_CONN_HANDLE_NONE);
 }
 
 //-----------------------------------------------------------------------------
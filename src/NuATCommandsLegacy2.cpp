@@ -29,12 +29,12 @@ void NuSLegacy2::NuATCommandProcessor::onWrite(
 {
     // Incoming data
     NimBLEAttValue incomingPacket = pCharacteristic->getValue();
-    // const char *in = pCharacteristic->getValue().c_str();
-    const char *in = incomingPacket.c_str();
-    // Serial.printf("onWrite(): %s\n");
 
-    // Parse
-    parseCommandLine(in);
+    // Parse.
+    // Responses go to the requesting peer only.
+    replyTo(connInfo.getConnHandle());
+    parseCommandLine(incomingPacket.data(), incomingPacket.size());
+    replyTo(BLE_HS_CONN_HANDLE_NONE);
 }
 
 //-----------------------------------------------------------------------------
@@ -9,6 +9,7 @@
  */
 
 #include "NuATParser.hpp"
+#include "NuTrace.hpp"
 #include <HardwareSerial.h> // For testing
 #include <algorithm>
 
@@ -553,7 +554,7 @@ void NuATParser::doExecute(const uint8_t *in, size_t size)
     if (findCallback(name, vsOnExecuteCN, vcbOnExecuteCallback, callback))
     {
         NuATCommandParameters_t empty;
-        NuATCommandResult_t result = callback(empty);
+        NuATCommandResult_t result = invoke(callback, empty, name, "");
         printResultResponse(result);
     }
     else
@@ -572,9 +573,11 @@ void NuATParser::doQuery(const uint8_t *in, size_t size)
     if (findCallback(name, vsOnQueryCN, vcbOnQueryCallback, callback))
     {
         NuATCommandParameters_t empty;
-        NuATCommandResult_t result = callback(empty);
+        NuATCommandResult_t result = invoke(callback, empty, name, "?");
         printResultResponse(result);
     }
+    else if (printProfile(name))
+        printResultResponse(NuATCommandResult_t::AT_RESULT_OK);
     else
     {
         printResultResponse(NuATCommandResult_t::AT_RESULT_ERROR);
@@ -591,7 +594,7 @@ void NuATParser::doTest(const uint8_t *in, size_t size)
     if (findCallback(name, vsOnTestCN, vcbOnTestCallback, callback))
     {
         NuATCommandParameters_t empty;
-        NuATCommandResult_t result = callback(empty);
+        NuATCommandResult_t result = invoke(callback, empty, name, "=?");
         printResultResponse(result);
     }
     else
@@ -608,7 +611,7 @@ void NuATParser::doSet(::std::string command, NuATCommandParameters_t &params)
     NuATCommandCallback_t callback;
     if (findCallback(command, vsOnSetCN, vcbOnSetCallback, callback))
     {
-        NuATCommandResult_t result = callback(params);
+        NuATCommandResult_t result = invoke(callback, params, command, "=");
         printResultResponse(result);
     }
     else
@@ -620,6 +623,50 @@ void NuATParser::doSet(::std::string command, NuATCommandParameters_t &params)
 
 //-----------------------------------------------------------------------------
 
+NuATCommandResult_t NuATParser::invoke(
+    NuATCommandCallback_t &callback,
+    NuATCommandParameters_t &params,
+    const ::std::string &name,
+    const char *suffix)
+{
+    // Note: the profile name is built only when needed.
+    bool bProfile = profiler.isEnabled();
+    ::std::string profileName;
+    if (bProfile || (NUS_TRACE_SIZE > 0))
+    {
+        profileName = name;
+        profileName.append(suffix);
+        if (bAllowLowerCase)
+            transform(profileName.begin(), profileName.end(), profileName.begin(), ::toupper);
+    }
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_AT_COMMAND, NuSTrace::tag(profileName.data(), profileName.size()));
+    auto startTime = bProfile ? NuSCommandProfiler::start() : ::std::chrono::steady_clock::time_point();
+    NuATCommandResult_t result = callback(params);
+    if (bProfile)
+        profiler.stop(profileName, startTime);
+    NUS_TRACE_END_EVENT(NUS_TRACE_AT_COMMAND, NuSTrace::tag(profileName.data(), profileName.size()));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+bool NuATParser::printProfile(const ::std::string &name)
+{
+    // Built-in AT+PERF? command
+    if (!profiler.isEnabled())
+        return false;
+    ::std::string upperCaseName = name;
+    if (bAllowLowerCase)
+        transform(upperCaseName.begin(), upperCaseName.end(), upperCaseName.begin(), ::toupper);
+    if (upperCaseName != "PERF")
+        return false;
+    for (auto &entry : profiler.get())
+        printATResponse("+PERF: " + NuSCommandProfiler::format(entry.first, entry.second));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
 void NuATParser::doNotACommandLine(const uint8_t *in, size_t size)
 {
     if (cbNoCommandsCallback)
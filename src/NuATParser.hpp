@@ -15,6 +15,7 @@
 #include <string>
 #include <functional>
 #include <cstring> // Needed for strlen()
+#include "NuProfile.hpp"
 
 /**
  * @brief Pseudo-standardized result of AT command execution
@@ -126,6 +127,36 @@ public:
      */
     bool stopOnFirstFailure(bool yesOrNo) noexcept;
 
+    /**
+     * @brief Measure the execution time of command callbacks, or not
+     *
+     * @note Disabled by default. While enabled, the built-in
+     *       `AT+PERF?` command prints one response per command:
+     *       `+PERF: <name>,<count>,<average>,<maximum>,<p50>,<p99>`
+     *       (times in microseconds), unless there is a callback for it.
+     *       Command names include the suffix, for example, `V?`.
+     *
+     * @param yesOrNo True to enable, false to disable
+     * @return true Previously, enabled
+     * @return false Previously, disabled
+     */
+    bool profile(bool yesOrNo) noexcept { return profiler.enable(yesOrNo); };
+
+    /**
+     * @brief Get the execution counters of all commands
+     *
+     * @note See profile()
+     *
+     * @return NuSCommandProfile_t Counters by command name (including the suffix)
+     */
+    NuSCommandProfile_t getProfile() { return profiler.get(); };
+
+    /**
+     * @brief Clear the execution counters of all commands
+     *
+     */
+    void resetProfile() { profiler.reset(); };
+
     /**
      * @brief Set a callback for a command with no suffix
      *
@@ -283,6 +314,7 @@ private:
     ::std::vector<NuATCommandCallback_t> vcbOnTestCallback;
     NuATErrorCallback_t cbErrorCallback = nullptr;
     NuATNotACommandLineCallback_t cbNoCommandsCallback = nullptr;
+    NuSCommandProfiler profiler;
 
     bool findCallback(
         ::std::string name,
@@ -297,6 +329,14 @@ private:
 
     bool executeSingleCommand(const uint8_t *in, size_t size);
 
+    NuATCommandResult_t invoke(
+        NuATCommandCallback_t &callback,
+        NuATCommandParameters_t &params,
+        const ::std::string &name,
+        const char *suffix);
+
+    bool printProfile(const ::std::string &name);
+
     bool parseParameter(const uint8_t *in, size_t size, ::std::string &text);
 };
 
@@ -0,0 +1,243 @@
+/**
+ * @file NuBridge.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Bridge between Arduino streams (UARTs) and the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuBridge.hpp"
+#include <chrono>
+#include <cstring> // For memmove()
+
+// Time between checks for a stop request, in milliseconds
+#define STOP_CHECK_MILLIS 100
+
+//-----------------------------------------------------------------------------
+// Configuration
+//-----------------------------------------------------------------------------
+
+bool NuSBridge::add(Stream &stream)
+{
+    if (bRunning || (streamCount >= NUS_BRIDGE_MAX_STREAMS))
+        return false;
+    serials[streamCount] = nullptr;
+    streams[streamCount++] = &stream;
+    return true;
+}
+
+bool NuSBridge::add(HardwareSerial &serial)
+{
+    if (!add(static_cast<Stream &>(serial)))
+        return false;
+    serials[streamCount - 1] = &serial;
+    return true;
+}
+
+void NuSBridge::setFlushThresholds(size_t flushSize, unsigned int flushMillis) noexcept
+{
+    this->flushSize = flushSize;
+    this->flushMillis = flushMillis;
+}
+
+size_t NuSBridge::setBufferSize(size_t size) noexcept
+{
+    size_t result = bufferSize;
+    if (size > 0)
+        bufferSize = size;
+    return result;
+}
+
+size_t NuSBridge::getBatchSize()
+{
+    size_t result = flushSize;
+    if (result == 0)
+    {
+        // Maximum size of a notification to all peers
+        uint16_t minMTU = 0;
+        for (uint16_t connHandle : ble.getSubscribers())
+        {
+            uint16_t mtu = ble.getMTU(connHandle);
+            if ((minMTU == 0) || (mtu < minMTU))
+                minMTU = mtu;
+        }
+        if (minMTU < 23)
+            minMTU = 23;
+        result = minMTU - 3;
+    }
+    return (result > bufferSize) ? bufferSize : result;
+}
+
+//-----------------------------------------------------------------------------
+// Start/stop
+//-----------------------------------------------------------------------------
+
+bool NuSBridge::begin()
+{
+    if (bRunning)
+        return true;
+
+    // Note: the BLE host task awakes the downlink thread,
+    // so the stream must not be watched by another wait set
+    if (downlinkWaitSet.add(ble) < 0)
+        return false;
+    // Note: hardware UARTs awake the uplink thread.
+    // Other streams have no way to do so, so they are polled.
+    // The polling interval is short to keep latency low.
+    uplinkWaitSet.setPollingInterval(1);
+    for (size_t index = 0; index < streamCount; index++)
+        if (serials[index])
+            uplinkWaitSet.add(*serials[index]);
+        else
+            uplinkWaitSet.add(*streams[index]);
+
+    {
+        ::std::lock_guard<::std::mutex> lock(statsMutex);
+        uplinkStats = {};
+        downlinkStats = {};
+    }
+    ble.setRxBufferSize(bufferSize);
+    bRunning = true;
+    uplinkThread = ::std::thread(&NuSBridge::uplinkLoop, this);
+    downlinkThread = ::std::thread(&NuSBridge::downlinkLoop, this);
+    return true;
+}
+
+void NuSBridge::end()
+{
+    bRunning = false;
+    // Awake both threads, so they are aware of the stop request at once
+    uplinkWaitSet.notify();
+    downlinkWaitSet.notify();
+    if (uplinkThread.joinable())
+        uplinkThread.join();
+    if (downlinkThread.joinable())
+        downlinkThread.join();
+    uplinkWaitSet.clear();
+    downlinkWaitSet.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+NuSBridgeStats_t NuSBridge::getUplinkStats()
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    return uplinkStats;
+}
+
+NuSBridgeStats_t NuSBridge::getDownlinkStats()
+{
+    ::std::lock_guard<::std::mutex> lock(statsMutex);
+    return downlinkStats;
+}
+
+//-----------------------------------------------------------------------------
+// Uplink: streams to BLE
+//-----------------------------------------------------------------------------
+
+void NuSBridge::uplinkLoop()
+{
+    // Note: streams were added to the wait set at begin()
+    ::std::vector<uint8_t> buffer(bufferSize);
+    size_t pending = 0;
+    auto oldestByteTime = nus_clock::now();
+    while (bRunning)
+    {
+        // Wait for incoming data, but do not hold pending bytes
+        // beyond the latency threshold
+        unsigned int timeoutMillis = STOP_CHECK_MILLIS;
+        if (pending > 0)
+        {
+            auto elapsed = ::std::chrono::duration_cast<::std::chrono::milliseconds>(
+                               nus_clock::now() - oldestByteTime)
+                               .count();
+            timeoutMillis = (elapsed < flushMillis) ? (flushMillis - elapsed) : 0;
+        }
+        if ((timeoutMillis > 0) && (pending < buffer.size()))
+            uplinkWaitSet.wait(timeoutMillis);
+
+        // Gather incoming data
+        for (size_t index = 0; (index < streamCount) && (pending < buffer.size()); index++)
+        {
+            int available = streams[index]->available();
+            if (available <= 0)
+                continue;
+            size_t count = buffer.size() - pending;
+            if ((size_t)available < count)
+                count = available;
+            count = streams[index]->readBytes(buffer.data() + pending, count);
+            if ((pending == 0) && (count > 0))
+                oldestByteTime = nus_clock::now();
+            pending = pending + count;
+        }
+        if (pending == 0)
+            continue;
+
+        // Send full batches, or everything when the oldest byte
+        // has waited for too long
+        size_t batchSize = getBatchSize();
+        bool timedOut = ((nus_clock::now() - oldestByteTime) >=
+                         ::std::chrono::milliseconds(flushMillis));
+        size_t count;
+        if (timedOut)
+            count = pending;
+        else if (pending >= batchSize)
+            count = pending - (pending % batchSize);
+        else
+            continue;
+
+        size_t sent = ble.write(buffer.data(), count);
+        {
+            ::std::lock_guard<::std::mutex> lock(statsMutex);
+            uplinkStats.bytes += sent;
+            uplinkStats.batches++;
+            if (timedOut)
+                uplinkStats.timedFlushes++;
+            else
+                uplinkStats.fullFlushes++;
+            if ((sent < count) && !ble.isConnected())
+            {
+                // Nobody is listening
+                uplinkStats.droppedBytes += (count - sent);
+                sent = count;
+            }
+        }
+        memmove(buffer.data(), buffer.data() + sent, pending - sent);
+        pending = pending - sent;
+        if (sent < count)
+            // Out of transmission buffers. Try again later.
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(2));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Downlink: BLE to streams
+//-----------------------------------------------------------------------------
+
+void NuSBridge::downlinkLoop()
+{
+    // Note: awakened by the BLE host task.
+    // The stream was added to the wait set at begin().
+    ::std::vector<uint8_t> buffer(bufferSize);
+    while (bRunning)
+    {
+        if (downlinkWaitSet.wait(STOP_CHECK_MILLIS) == 0)
+            continue;
+        // Note: does not block, since data is available
+        size_t count = ble.readSome(buffer.data(), buffer.size());
+        if (count == 0)
+            continue;
+        size_t dropped = 0;
+        for (size_t index = 0; index < streamCount; index++)
+            dropped += count - streams[index]->write(buffer.data(), count);
+
+        ::std::lock_guard<::std::mutex> lock(statsMutex);
+        downlinkStats.bytes += count;
+        downlinkStats.batches++;
+        downlinkStats.droppedBytes += dropped;
+    }
+}
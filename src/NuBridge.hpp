@@ -0,0 +1,200 @@
+/**
+ * @file NuBridge.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Bridge between Arduino streams (UARTs) and the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUBRIDGE_HPP__
+#define __NUBRIDGE_HPP__
+
+#include <Stream.h>
+#include <HardwareSerial.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include "NuStream.hpp"
+#include "NuWaitSet.hpp"
+
+/**
+ * @brief Maximum number of Arduino streams in a bridge
+ *
+ */
+#ifndef NUS_BRIDGE_MAX_STREAMS
+#define NUS_BRIDGE_MAX_STREAMS 4
+#endif
+
+/**
+ * @brief Transfer counters of a single direction
+ *
+ */
+typedef struct
+{
+    /** Count of bytes transferred */
+    uint32_t bytes;
+    /** Count of writes to the destination */
+    uint32_t batches;
+    /** Count of writes due to the size threshold */
+    uint32_t fullFlushes;
+    /** Count of writes due to the latency threshold */
+    uint32_t timedFlushes;
+    /** Count of bytes not accepted by the destination */
+    uint32_t droppedBytes;
+} NuSBridgeStats_t;
+
+/**
+ * @brief Transfer data between Arduino streams (for example, UARTs)
+ *        and a NordicUARTStream in both directions
+ *
+ * @note Each direction runs in its own background thread:
+ *       - Uplink (streams to BLE): incoming bytes from all streams are
+ *         gathered into a buffer and sent in batches of the MTU size,
+ *         or earlier when the oldest byte has waited for too long.
+ *         See setFlushThresholds(). The thread is awakened by
+ *         hardware UARTs as soon as data arrives. Other streams
+ *         are polled every millisecond.
+ *       - Downlink (BLE to streams): the thread is awakened by the
+ *         BLE host task as soon as data arrives. Data is written
+ *         to all streams. The receive buffer of the NordicUARTStream
+ *         absorbs bursts.
+ *
+ * @note Bytes are dropped when no peer is connected.
+ *       If two or more streams send data at the same time,
+ *       the peer does not know which one of them is the sender.
+ */
+class NuSBridge
+{
+public:
+    /**
+     * @brief Create a bridge
+     *
+     * @param ble Stream to bridge. Should not be used by other
+     *            tasks while the bridge is running.
+     */
+    NuSBridge(NordicUARTStream &ble) : ble(ble) {};
+    NuSBridge(const NuSBridge &) = delete;
+    NuSBridge(NuSBridge &&) = delete;
+    NuSBridge &operator=(const NuSBridge &) = delete;
+    NuSBridge &operator=(NuSBridge &&) = delete;
+    virtual ~NuSBridge() { end(); };
+
+public:
+    /**
+     * @brief Add an Arduino stream to bridge
+     *
+     * @note Must be called before begin().
+     *
+     * @param stream Stream to bridge, already initialized
+     * @return true On success
+     * @return false If there are NUS_BRIDGE_MAX_STREAMS already
+     *               or the bridge is running.
+     */
+    bool add(Stream &stream);
+
+    /**
+     * @brief Add a hardware UART to bridge
+     *
+     * @note Must be called before begin().
+     *       Incoming data awakes the bridge at once through
+     *       `HardwareSerial::onReceive()`, which is taken by the bridge
+     *       while running. Other streams are polled.
+     *
+     * @param serial UART to bridge, already initialized
+     * @return true On success
+     * @return false If there are NUS_BRIDGE_MAX_STREAMS already
+     *               or the bridge is running.
+     */
+    bool add(HardwareSerial &serial);
+
+    /**
+     * @brief Configure when to send gathered bytes to the peer
+     *
+     * @note Larger batches give higher throughput,
+     *       while shorter delays give lower latency.
+     *
+     * @param flushSize Size of a batch in bytes, or zero to
+     *                  use the maximum size of a notification (MTU-3).
+     * @param flushMillis Maximum time (in milliseconds) a byte is held
+     *                    while waiting for a batch to fill. Default is 5.
+     */
+    void setFlushThresholds(size_t flushSize = 0, unsigned int flushMillis = 5) noexcept;
+
+    /**
+     * @brief Set the size of the buffers of each direction
+     *
+     * @note Must be called before begin(). Default is 2048 bytes.
+     *
+     * @param size Size in bytes
+     * @return size_t Previous size
+     */
+    size_t setBufferSize(size_t size) noexcept;
+
+    /**
+     * @brief Start bridging
+     *
+     * @note Sets the receive buffer size of the NordicUARTStream.
+     *       See setBufferSize().
+     *
+     * @return true On success, or if already running
+     * @return false If the NordicUARTStream is already watched
+     *               by a wait set. See NuSWaitSet::add().
+     */
+    bool begin();
+
+    /**
+     * @brief Stop bridging
+     *
+     * @note Blocks until both threads are finished.
+     */
+    void end();
+
+    /**
+     * @brief Check if bridging
+     *
+     * @return true If started
+     * @return false If not started
+     */
+    bool isRunning() const noexcept { return bRunning; };
+
+    /**
+     * @brief Get the transfer counters from the streams to BLE
+     *
+     * @return NuSBridgeStats_t Counters since begin()
+     */
+    NuSBridgeStats_t getUplinkStats();
+
+    /**
+     * @brief Get the transfer counters from BLE to the streams
+     *
+     * @return NuSBridgeStats_t Counters since begin()
+     */
+    NuSBridgeStats_t getDownlinkStats();
+
+private:
+    NordicUARTStream &ble;
+    Stream *streams[NUS_BRIDGE_MAX_STREAMS];
+    // Same as streams, or nullptr if not a hardware UART
+    HardwareSerial *serials[NUS_BRIDGE_MAX_STREAMS];
+    size_t streamCount = 0;
+    ::std::atomic<size_t> flushSize{0};
+    ::std::atomic<unsigned int> flushMillis{5};
+    size_t bufferSize = 2048;
+    ::std::atomic<bool> bRunning{false};
+    ::std::thread uplinkThread;
+    ::std::thread downlinkThread;
+    NuSWaitSet uplinkWaitSet;
+    NuSWaitSet downlinkWaitSet;
+    ::std::mutex statsMutex;
+    NuSBridgeStats_t uplinkStats{};
+    NuSBridgeStats_t downlinkStats{};
+
+    size_t getBatchSize();
+    void uplinkLoop();
+    void downlinkLoop();
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <cctype>
 // #include <cwctype>
 #include "NuCLIParser.hpp"
+#include "NuTrace.hpp"
 
 //-----------------------------------------------------------------------------
 // Set callbacks
@@ -98,10 +99,22 @@ void NuCLIParser::onParsingSuccess(NuCommandLine_t &commandLine) noexcept
         if (test)
         {
             NuCLICommandCallback_t cb = vcbCommand.at(index);
+            NUS_TRACE_BEGIN_EVENT(NUS_TRACE_CLI_COMMAND, NuSTrace::tag(candidate.data(), candidate.size()));
+            bool bProfile = profiler.isEnabled();
+            auto startTime = bProfile ? NuSCommandProfiler::start() : ::std::chrono::steady_clock::time_point();
             cb(commandLine);
+            if (bProfile)
+                profiler.stop(candidate, startTime);
+            NUS_TRACE_END_EVENT(NUS_TRACE_CLI_COMMAND, NuSTrace::tag(candidate.data(), candidate.size()));
             return;
         }
     }
+    if (profiler.isEnabled() && caseInsCompare(givenCommandName, "perf"))
+    {
+        // Built-in command
+        onProfileRequest(commandLine);
+        return;
+    }
     if (cbUnknown)
         cbUnknown(commandLine);
 }
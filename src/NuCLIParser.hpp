@@ -15,6 +15,7 @@
 #include <string>
 #include <cstring> // Needed for strlen()
 #include <functional>
+#include "NuProfile.hpp"
 
 /**
  * @brief Parsing state of a received command
@@ -76,6 +77,33 @@ public:
      */
     bool caseSensitive(bool yesOrNo) noexcept;
 
+    /**
+     * @brief Measure the execution time of command callbacks, or not
+     *
+     * @note Disabled by default. While enabled, the built-in `perf`
+     *       command calls onProfileRequest(), unless there is a callback for it.
+     *
+     * @param yesOrNo True to enable, false to disable
+     * @return true Previously, enabled
+     * @return false Previously, disabled
+     */
+    bool profile(bool yesOrNo) noexcept { return profiler.enable(yesOrNo); };
+
+    /**
+     * @brief Get the execution counters of all commands
+     *
+     * @note See profile()
+     *
+     * @return NuSCommandProfile_t Counters by command name
+     */
+    NuSCommandProfile_t getProfile() { return profiler.get(); };
+
+    /**
+     * @brief Clear the execution counters of all commands
+     *
+     */
+    void resetProfile() { profiler.reset(); };
+
     /**
      * @brief Set a callback for a command name
      *
@@ -181,12 +209,24 @@ protected:
      */
     virtual void onParsingFailure(NuCLIParsingResult_t result, size_t index) noexcept;
 
+    /**
+     * @brief Notify the built-in `perf` command
+     *
+     * @note Called only while profiling is enabled.
+     *       Current implementation does nothing.
+     *       Override to print getProfile() somewhere.
+     *
+     * @param[in] commandLine Parsed command line
+     */
+    virtual void onProfileRequest(NuCommandLine_t &commandLine) noexcept {};
+
 private:
     bool bCaseSensitive = false;
     NuCLIParseErrorCallback_t cbParseError = nullptr;
     NuCLICommandCallback_t cbUnknown = nullptr;
     ::std::vector<::std::string> vsCommandName;
     ::std::vector<NuCLICommandCallback_t> vcbCommand;
+    NuSCommandProfiler profiler;
 };
 
 #endif
\ No newline at end of file
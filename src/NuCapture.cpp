@@ -0,0 +1,91 @@
+/**
+ * @file NuCapture.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Traffic capture of the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuCapture.hpp"
+
+//-----------------------------------------------------------------------------
+// Recorder
+//-----------------------------------------------------------------------------
+
+void NuSCaptureRecorder::begin(Print &out)
+{
+    ::std::lock_guard<::std::mutex> lock(recorderMutex);
+    const uint8_t header[NUS_CAPTURE_HEADER_SIZE] = {'N', 'U', 'S', 'C', NUS_CAPTURE_VERSION, 0, 0, 0};
+    out.write(header, sizeof(header));
+    startTime = ::std::chrono::steady_clock::now();
+    recordCount = 0;
+    pOut = &out;
+}
+
+void NuSCaptureRecorder::end()
+{
+    ::std::lock_guard<::std::mutex> lock(recorderMutex);
+    pOut = nullptr;
+}
+
+void NuSCaptureRecorder::record(NuSCaptureEvent_t event, uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    if (!pOut)
+        return;
+    if (size > 0xFFFF)
+        size = 0xFFFF;
+
+    ::std::lock_guard<::std::mutex> lock(recorderMutex);
+    Print *out = pOut;
+    if (!out)
+        return;
+    uint32_t timestamp = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                             ::std::chrono::steady_clock::now() - startTime)
+                             .count();
+    uint8_t header[NUS_CAPTURE_RECORD_HEADER_SIZE] = {
+        (uint8_t)event,
+        (uint8_t)(timestamp & 0xFF),
+        (uint8_t)((timestamp >> 8) & 0xFF),
+        (uint8_t)((timestamp >> 16) & 0xFF),
+        (uint8_t)(timestamp >> 24),
+        (uint8_t)(connHandle & 0xFF),
+        (uint8_t)(connHandle >> 8),
+        (uint8_t)(size & 0xFF),
+        (uint8_t)(size >> 8)};
+    out->write(header, sizeof(header));
+    if (data && (size > 0))
+        out->write(data, size);
+    recordCount++;
+}
+
+//-----------------------------------------------------------------------------
+// Reader
+//-----------------------------------------------------------------------------
+
+NuSCaptureReader::NuSCaptureReader(const uint8_t *data, size_t size) noexcept
+    : data(data), size(size)
+{
+    bValid = data && (size >= NUS_CAPTURE_HEADER_SIZE) &&
+             (data[0] == 'N') && (data[1] == 'U') && (data[2] == 'S') && (data[3] == 'C') &&
+             (data[4] == NUS_CAPTURE_VERSION);
+}
+
+bool NuSCaptureReader::next(NuSCaptureRecord_t &record) noexcept
+{
+    if (!bValid || (size - position < NUS_CAPTURE_RECORD_HEADER_SIZE))
+        return false;
+    const uint8_t *header = data + position;
+    uint16_t payloadSize = header[7] | (header[8] << 8);
+    if (size - position - NUS_CAPTURE_RECORD_HEADER_SIZE < payloadSize)
+        // Truncated
+        return false;
+    record.event = (NuSCaptureEvent_t)header[0];
+    record.timestamp = header[1] | (header[2] << 8) | (header[3] << 16) | ((uint32_t)header[4] << 24);
+    record.connHandle = header[5] | (header[6] << 8);
+    record.size = payloadSize;
+    record.data = header + NUS_CAPTURE_RECORD_HEADER_SIZE;
+    position = position + NUS_CAPTURE_RECORD_HEADER_SIZE + payloadSize;
+    return true;
+}
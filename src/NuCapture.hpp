@@ -0,0 +1,191 @@
+/**
+ * @file NuCapture.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Traffic capture of the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUCAPTURE_HPP__
+#define __NUCAPTURE_HPP__
+
+#include <Print.h>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Capture format version
+ *
+ * @note A capture starts with a header of 8 bytes:
+ *       "NUSC", the format version and three zero bytes.
+ *       Then, records follow. Each record is a header of 9 bytes
+ *       and a payload: record type (1 byte), timestamp in microseconds
+ *       since the start of the capture (4 bytes), connection handle (2 bytes),
+ *       payload size (2 bytes) and payload. Numbers are little-endian.
+ */
+#define NUS_CAPTURE_VERSION 1
+
+/**
+ * @brief Size of the capture header in bytes
+ *
+ */
+#define NUS_CAPTURE_HEADER_SIZE 8
+
+/**
+ * @brief Size of a record header in bytes
+ *
+ */
+#define NUS_CAPTURE_RECORD_HEADER_SIZE 9
+
+/**
+ * @brief Captured events
+ *
+ */
+typedef enum
+{
+    /** Data written by a peer to the RX characteristic. Payload: data. */
+    NUS_CAPTURE_WRITE = 1,
+    /** A peer subscribed to the TX characteristic. Payload: ATT MTU (2 bytes). */
+    NUS_CAPTURE_SUBSCRIBE = 2,
+    /** A peer unsubscribed from the TX characteristic. No payload. */
+    NUS_CAPTURE_UNSUBSCRIBE = 3,
+    /** Notification sent to a peer. Payload: data. */
+    NUS_CAPTURE_NOTIFY = 4
+} NuSCaptureEvent_t;
+
+/**
+ * @brief A captured event
+ *
+ */
+typedef struct
+{
+    /** Captured event */
+    NuSCaptureEvent_t event;
+    /** Microseconds since the start of the capture */
+    uint32_t timestamp;
+    /** Connection handle of the peer */
+    uint16_t connHandle;
+    /** Size of the payload in bytes */
+    uint16_t size;
+    /** Pointer to the payload */
+    const uint8_t *data;
+} NuSCaptureRecord_t;
+
+/**
+ * @brief Write captured events to any Print object
+ *
+ * @note Thread-safe. Events are written from the BLE host task,
+ *       so a fast destination is recommended (for example, a RAM buffer).
+ *
+ * @note See NordicUARTService::setRecorder()
+ */
+class NuSCaptureRecorder
+{
+public:
+    NuSCaptureRecorder() {};
+    NuSCaptureRecorder(const NuSCaptureRecorder &) = delete;
+    NuSCaptureRecorder(NuSCaptureRecorder &&) = delete;
+    NuSCaptureRecorder &operator=(const NuSCaptureRecorder &) = delete;
+    NuSCaptureRecorder &operator=(NuSCaptureRecorder &&) = delete;
+
+    /**
+     * @brief Start a capture
+     *
+     * @note The capture header is written at once
+     *
+     * @param out Destination of captured events. Must stay valid until end().
+     */
+    void begin(Print &out);
+
+    /**
+     * @brief Stop capturing
+     *
+     */
+    void end();
+
+    /**
+     * @brief Check if capturing
+     *
+     * @return true If begin() was called
+     * @return false Otherwise
+     */
+    bool isRecording() const noexcept { return (pOut != nullptr); };
+
+    /**
+     * @brief Write a captured event
+     *
+     * @note Ignored if not capturing. Payloads longer than 65535 bytes
+     *       are truncated.
+     *
+     * @param event Captured event
+     * @param connHandle Connection handle of the peer
+     * @param data Payload, or null
+     * @param size Size of the payload in bytes
+     */
+    void record(NuSCaptureEvent_t event, uint16_t connHandle, const uint8_t *data = nullptr, size_t size = 0);
+
+    /**
+     * @brief Get the count of events written since begin()
+     *
+     * @return uint32_t Count of records
+     */
+    uint32_t getRecordCount() const noexcept { return recordCount; };
+
+private:
+    ::std::mutex recorderMutex;
+    ::std::atomic<Print *> pOut{nullptr};
+    ::std::chrono::steady_clock::time_point startTime;
+    ::std::atomic<uint32_t> recordCount{0};
+};
+
+/**
+ * @brief Parse a capture held in memory
+ *
+ */
+class NuSCaptureReader
+{
+public:
+    /**
+     * @brief Parse a capture
+     *
+     * @param data Pointer to the capture. Must stay valid while reading.
+     * @param size Size of the capture in bytes
+     */
+    NuSCaptureReader(const uint8_t *data, size_t size) noexcept;
+
+    /**
+     * @brief Check the capture header
+     *
+     * @return true If this is a capture of a supported version
+     * @return false Otherwise. There are no records.
+     */
+    bool isValid() const noexcept { return bValid; };
+
+    /**
+     * @brief Get the next record
+     *
+     * @param[out] record Next record. The payload points into the capture.
+     * @return true On success
+     * @return false At the end of the capture or on a truncated record
+     */
+    bool next(NuSCaptureRecord_t &record) noexcept;
+
+    /**
+     * @brief Start reading again from the first record
+     *
+     */
+    void rewind() noexcept { position = NUS_CAPTURE_HEADER_SIZE; };
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t position = NUS_CAPTURE_HEADER_SIZE;
+    bool bValid;
+};
+
+#endif
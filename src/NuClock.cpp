@@ -0,0 +1,94 @@
+/**
+ * @file NuClock.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Clock of timeouts in the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuClock.hpp"
+
+#if defined(NUS_VIRTUAL_CLOCK)
+
+#include <atomic>
+
+//-----------------------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------------------
+
+static ::std::atomic<NuSVirtualClock::rep> virtualNanos{0};
+static size_t blockedCount = 0;
+
+//-----------------------------------------------------------------------------
+// Virtual time
+//-----------------------------------------------------------------------------
+
+NuSVirtualClock::time_point NuSVirtualClock::now() noexcept
+{
+    return time_point(duration(virtualNanos.load(::std::memory_order_acquire)));
+}
+
+void NuSVirtualClock::advance(duration step)
+{
+    if (step.count() <= 0)
+        return;
+    {
+        // Note: taking the lock prevents a lost wakeup
+        // between the waiter's check and its wait
+        ::std::lock_guard<::std::mutex> lock(getMutex());
+        virtualNanos.fetch_add(step.count(), ::std::memory_order_release);
+    }
+    getConditionVariable().notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Blocked tasks
+//-----------------------------------------------------------------------------
+
+size_t NuSVirtualClock::getBlockedCount() noexcept
+{
+    ::std::lock_guard<::std::mutex> lock(getMutex());
+    return blockedCount;
+}
+
+bool NuSVirtualClock::waitUntilBlocked(size_t count, unsigned int timeoutMillis)
+{
+    ::std::unique_lock<::std::mutex> lock(getMutex());
+    return getConditionVariable().wait_for(
+        lock,
+        ::std::chrono::milliseconds(timeoutMillis),
+        [count]()
+        { return (blockedCount >= count); });
+}
+
+void NuSVirtualClock::block(bool yesOrNo) noexcept
+{
+    if (yesOrNo)
+    {
+        blockedCount++;
+        // Awake tasks at waitUntilBlocked()
+        getConditionVariable().notify_all();
+    }
+    else if (blockedCount > 0)
+        blockedCount--;
+}
+
+//-----------------------------------------------------------------------------
+// Shared synchronization objects
+//-----------------------------------------------------------------------------
+
+::std::mutex &NuSVirtualClock::getMutex() noexcept
+{
+    static ::std::mutex mutex;
+    return mutex;
+}
+
+::std::condition_variable &NuSVirtualClock::getConditionVariable() noexcept
+{
+    static ::std::condition_variable cv;
+    return cv;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file NuClock.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Clock of timeouts in the Nordic UART Service
+ *
+ * @note Define NUS_VIRTUAL_CLOCK in a host test build to replace
+ *       the steady clock with a virtual one, so timeouts expire
+ *       when the test says so, not in real time.
+ *       Not intended for production builds.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_CLOCK_HPP__
+#define __NU_CLOCK_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+#if defined(NUS_VIRTUAL_CLOCK)
+
+/**
+ * @brief Clock that moves forward only when told to
+ *
+ * @note Meets the requirements of a C++ steady clock.
+ *       Time starts at zero.
+ *
+ * @note All semaphores share the mutex and condition variable
+ *       of this clock, so waiting tasks are awakened when time advances.
+ *       Waits with a deadline of ::std::chrono::steady_clock
+ *       still take place in real time.
+ */
+class NuSVirtualClock
+{
+public:
+    typedef ::std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef ::std::chrono::time_point<NuSVirtualClock> time_point;
+    static constexpr bool is_steady = true;
+
+    NuSVirtualClock() = delete;
+
+    /**
+     * @brief Get the current virtual time
+     *
+     * @return time_point Current time
+     */
+    static time_point now() noexcept;
+
+    /**
+     * @brief Move time forward and awake waiting tasks
+     *
+     * @note Expired waits return before this method does
+     *       only if their tasks are scheduled in time.
+     *       Use waitUntilBlocked() to synchronize.
+     *
+     * @param step Time to advance. Negative values are ignored.
+     */
+    static void advance(duration step);
+
+    /**
+     * @brief Get the count of tasks blocked in a semaphore
+     *
+     * @return size_t Count of blocked tasks
+     */
+    static size_t getBlockedCount() noexcept;
+
+    /**
+     * @brief Wait for tasks to block in a semaphore
+     *
+     * @note Useful to advance time after a task starts waiting,
+     *       not before.
+     *
+     * @param count Count of blocked tasks to wait for
+     * @param timeoutMillis Maximum time to wait, in real time
+     * @return true If at least @p count tasks are blocked
+     * @return false On timeout
+     */
+    static bool waitUntilBlocked(size_t count, unsigned int timeoutMillis = 1000);
+
+    /**
+     * @brief Mutex shared by all semaphores
+     *
+     * @note For internal use
+     */
+    static ::std::mutex &getMutex() noexcept;
+
+    /**
+     * @brief Condition variable shared by all semaphores
+     *
+     * @note For internal use
+     */
+    static ::std::condition_variable &getConditionVariable() noexcept;
+
+    /**
+     * @brief Account for a task blocking or unblocking
+     *
+     * @note For internal use. Must be called with getMutex() locked.
+     *
+     * @param yesOrNo True when blocking, false when unblocking.
+     */
+    static void block(bool yesOrNo) noexcept;
+};
+
+/** Clock of timeouts */
+typedef NuSVirtualClock nus_clock;
+
+#else
+
+/** Clock of timeouts */
+typedef ::std::chrono::steady_clock nus_clock;
+
+#endif
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file NuCompression.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Streaming compression for the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuCompression.hpp"
+#include <cstring> // For memcpy()
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+#define MIN_MATCH 3
+#define MAX_MATCH 34
+#define MAX_LITERALS 128
+#define HASH_BITS 9
+
+static inline uint32_t hash(const uint8_t *data)
+{
+    uint32_t value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+//-----------------------------------------------------------------------------
+// Compressor
+//-----------------------------------------------------------------------------
+
+void NuSCompressor::reset()
+{
+    history.resize(2 * NUS_COMPRESSION_WINDOW);
+    hashTable.assign(1 << HASH_BITS, 0);
+    historySize = 0;
+}
+
+void NuSCompressor::slide()
+{
+    // Keep the last window only
+    size_t delta = historySize - NUS_COMPRESSION_WINDOW;
+    memmove(history.data(), history.data() + delta, NUS_COMPRESSION_WINDOW);
+    for (auto &entry : hashTable)
+        entry = (entry > delta) ? (entry - delta) : 0;
+    historySize = NUS_COMPRESSION_WINDOW;
+}
+
+static size_t emitLiterals(const uint8_t *data, size_t size, uint8_t *output)
+{
+    size_t result = 0;
+    while (size > 0)
+    {
+        size_t count = (size > MAX_LITERALS) ? MAX_LITERALS : size;
+        output[result++] = count - 1;
+        memcpy(output + result, data, count);
+        result = result + count;
+        data = data + count;
+        size = size - count;
+    }
+    return result;
+}
+
+size_t NuSCompressor::compress(const uint8_t *data, size_t size, uint8_t *output)
+{
+    if (history.empty())
+        reset();
+
+    // Note: input is processed in pieces of one window at most,
+    // so there is always room for it in the history
+    size_t result = 0;
+    while (size > 0)
+    {
+        size_t count = (size > NUS_COMPRESSION_WINDOW) ? NUS_COMPRESSION_WINDOW : size;
+        if ((historySize + count) > history.size())
+            slide();
+        memcpy(history.data() + historySize, data, count);
+        size_t position = historySize;
+        size_t end = historySize + count;
+        size_t literalStart = position;
+
+        while (position < end)
+        {
+            size_t matchLength = 0;
+            size_t matchOffset = 0;
+            if ((end - position) >= MIN_MATCH)
+            {
+                uint32_t key = hash(history.data() + position);
+                size_t candidate = hashTable[key];
+                hashTable[key] = position + 1;
+                if ((candidate > 0) && ((position + 1 - candidate) <= NUS_COMPRESSION_WINDOW))
+                {
+                    candidate--;
+                    size_t limit = end - position;
+                    if (limit > MAX_MATCH)
+                        limit = MAX_MATCH;
+                    while ((matchLength < limit) &&
+                           (history[candidate + matchLength] == history[position + matchLength]))
+                        matchLength++;
+                    matchOffset = position - candidate;
+                }
+            }
+
+            if (matchLength >= MIN_MATCH)
+            {
+                result += emitLiterals(history.data() + literalStart, position - literalStart, output + result);
+                output[result++] = 0x80 | ((matchLength - MIN_MATCH) << 2) | ((matchOffset - 1) >> 8);
+                output[result++] = (matchOffset - 1) & 0xFF;
+                // Index the matched bytes, too
+                for (size_t index = position + 1;
+                     (index < (position + matchLength)) && ((index + MIN_MATCH) <= end);
+                     index++)
+                    hashTable[hash(history.data() + index)] = index + 1;
+                position = position + matchLength;
+                literalStart = position;
+            }
+            else
+                position++;
+        }
+        result += emitLiterals(history.data() + literalStart, end - literalStart, output + result);
+
+        historySize = end;
+        data = data + count;
+        size = size - count;
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Decompressor
+//-----------------------------------------------------------------------------
+
+void NuSDecompressor::reset()
+{
+    window.assign(NUS_COMPRESSION_WINDOW, 0);
+    windowPosition = 0;
+    pendingLiterals = 0;
+    pendingCopy = 0;
+    copyOffset = 0;
+    bMatchHeader = false;
+}
+
+size_t NuSDecompressor::decompress(const uint8_t *&data, size_t &size, uint8_t *output, size_t capacity)
+{
+    if (window.empty())
+        reset();
+
+    size_t result = 0;
+    while (result < capacity)
+    {
+        uint8_t byte;
+        if (pendingCopy > 0)
+        {
+            // Note: source and destination may overlap
+            byte = window[(windowPosition - copyOffset) & (NUS_COMPRESSION_WINDOW - 1)];
+            pendingCopy--;
+        }
+        else if (size == 0)
+            break;
+        else if (pendingLiterals > 0)
+        {
+            byte = *data++;
+            size--;
+            pendingLiterals--;
+        }
+        else
+        {
+            // Token
+            uint8_t token = *data++;
+            size--;
+            if (bMatchHeader)
+            {
+                bMatchHeader = false;
+                copyOffset = (((size_t)(matchHeader & 0x03) << 8) | token) + 1;
+                pendingCopy = ((matchHeader >> 2) & 0x1F) + MIN_MATCH;
+            }
+            else if (token & 0x80)
+            {
+                matchHeader = token;
+                bMatchHeader = true;
+            }
+            else
+                pendingLiterals = token + 1;
+            continue;
+        }
+        output[result++] = byte;
+        window[windowPosition] = byte;
+        windowPosition = (windowPosition + 1) & (NUS_COMPRESSION_WINDOW - 1);
+    }
+    return result;
+}
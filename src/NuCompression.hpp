@@ -0,0 +1,155 @@
+/**
+ * @file NuCompression.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Streaming compression for the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUCOMPRESSION_HPP__
+#define __NUCOMPRESSION_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Size in bytes of the sliding window
+ *
+ * @note Fixed by the encoding format (10-bit offsets).
+ *       The compressor takes twice this size plus a 1 KB hash table.
+ *       The decompressor takes this size.
+ */
+#define NUS_COMPRESSION_WINDOW 1024
+
+/**
+ * @brief Compression codecs
+ *
+ */
+typedef enum
+{
+    /** No compression */
+    NUS_COMPRESSION_NONE = 0,
+    /** LZ77 family, 1 KB window, byte-aligned tokens */
+    NUS_COMPRESSION_LZ = 1
+} NuSCompression_t;
+
+/**
+ * @brief Compression counters
+ *
+ */
+typedef struct
+{
+    /** Count of bytes written before compression */
+    uint32_t txBytes;
+    /** Count of bytes sent after compression */
+    uint32_t txCompressedBytes;
+    /** Count of bytes received before decompression */
+    uint32_t rxCompressedBytes;
+    /** Count of bytes received after decompression */
+    uint32_t rxBytes;
+    /** Compression ratio of outgoing data (txBytes/txCompressedBytes) */
+    float txRatio;
+    /** Compression ratio of incoming data (rxBytes/rxCompressedBytes) */
+    float rxRatio;
+} NuSCompressionStats_t;
+
+/**
+ * @brief Streaming compressor (LZ77 family)
+ *
+ * @note Encoding format: a sequence of byte-aligned tokens.
+ *       `0LLLLLLL`: L+1 literal bytes follow (1 to 128).
+ *       `1LLLLLOO OOOOOOOO`: copy L+3 bytes (3 to 34)
+ *       from O+1 bytes back (1 to 1024).
+ *
+ * @note Previous data is kept as a dictionary for the next call
+ *       to compress(), so repetitive data is compressed across calls.
+ *       Memory is allocated on first use and never grows.
+ */
+class NuSCompressor
+{
+public:
+    /**
+     * @brief Forget all previous data
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Compress and flush
+     *
+     * @note All the output can be decompressed as soon as it is received.
+     *
+     * @param[in] data Data to compress
+     * @param[in] size Size of @p data in bytes
+     * @param[out] output Compressed data.
+     *                    Capacity must be at least getMaxCompressedSize(@p size).
+     * @return size_t Size of the compressed data in bytes
+     */
+    size_t compress(const uint8_t *data, size_t size, uint8_t *output);
+
+    /**
+     * @brief Get the size of compressed data in the worst case
+     *
+     * @param size Size of data to compress in bytes
+     * @return size_t Maximum size of the compressed data in bytes
+     */
+    static size_t getMaxCompressedSize(size_t size) noexcept
+    {
+        return size + (size / 64) + 2;
+    };
+
+private:
+    ::std::vector<uint8_t> history;
+    size_t historySize = 0;
+    // Position plus one of the last occurrence of each hash, or zero
+    ::std::vector<uint16_t> hashTable;
+
+    void slide();
+};
+
+/**
+ * @brief Streaming decompressor
+ *
+ * @note See NuSCompressor for the encoding format.
+ *       Memory is allocated on first use and never grows.
+ */
+class NuSDecompressor
+{
+public:
+    /**
+     * @brief Forget all previous data
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Decompress
+     *
+     * @note Tokens may be split at any point. Incomplete tokens
+     *       are completed in the next call.
+     *
+     * @param[in,out] data Compressed data. On return, points to
+     *                     the first byte not consumed.
+     * @param[in,out] size Size of @p data in bytes. On return,
+     *                     count of bytes not consumed.
+     * @param[out] output Decompressed data
+     * @param[in] capacity Size of @p output in bytes
+     * @return size_t Size of the decompressed data in bytes.
+     *                Less than @p capacity if all the input was consumed.
+     */
+    size_t decompress(const uint8_t *&data, size_t &size, uint8_t *output, size_t capacity);
+
+private:
+    ::std::vector<uint8_t> window;
+    size_t windowPosition = 0;
+    size_t pendingLiterals = 0;
+    size_t pendingCopy = 0;
+    size_t copyOffset = 0;
+    uint8_t matchHeader = 0;
+    bool bMatchHeader = false;
+};
+
+#endif
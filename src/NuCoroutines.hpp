@@ -0,0 +1,505 @@
+/**
+ * @file NuCoroutines.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief C++20 coroutine support for the Nordic UART Service
+ *
+ * @note Many protocol conversations can be multiplexed in a single task
+ *       (and stack). Each conversation is a coroutine returning NuSTask.
+ *       Coroutines are run by a NuSExecutor. For example:
+ *
+ * @code {.cpp}
+ * NuSTask echo(NordicUARTSession &session)
+ * {
+ *     uint8_t buffer[64];
+ *     size_t size;
+ *     while ((size = co_await NuSAsync::read(session, buffer, sizeof(buffer))))
+ *         co_await NuSAsync::write(session, buffer, size);
+ * }
+ * @endcode
+ *
+ * @note Requires C++20
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_COROUTINES_HPP__
+#define __NU_COROUTINES_HPP__
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <chrono>
+#include <vector>
+#include "NuStream.hpp"
+#include "NuWaitSet.hpp"
+
+//-----------------------------------------------------------------------------
+// Awaitables
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Base class of all awaitable operations
+ *
+ * @note Awaitable operations never block.
+ *       The executor polls them again when their source notifies
+ *       something or their deadline expires. Operations with no source
+ *       are polled from time to time.
+ */
+class NuSAwaitable
+{
+public:
+    /**
+     * @brief Try to complete this operation without blocking
+     *
+     * @return true If complete
+     * @return false If not complete yet
+     */
+    virtual bool poll() = 0;
+
+    /**
+     * @brief Get the object notifying events of this operation
+     *
+     * @return NordicUARTSession* Source of notifications,
+     *                            or `nullptr` if there is none.
+     */
+    virtual NordicUARTSession *getSource() { return nullptr; };
+
+    /**
+     * @brief Get the time this operation expires at
+     *
+     * @return nus_clock::time_point Expiration time, or
+     *         `nus_clock::time_point::max()` if it never expires.
+     */
+    virtual nus_clock::time_point getDeadline() { return nus_clock::time_point::max(); };
+
+    /**
+     * @brief Try to complete this operation, keeping track of notifications
+     *
+     * @return true If complete
+     * @return false If not complete yet
+     */
+    bool tryComplete()
+    {
+        // Note: notifications from now on are not missed
+        NordicUARTSession *pSource = getSource();
+        if (pSource)
+            notificationCount = pSource->notificationCount.load(::std::memory_order_acquire);
+        return poll();
+    };
+
+    /**
+     * @brief Check if this operation may complete now
+     *
+     * @return true If notified since the last call to tryComplete(),
+     *              expired or with no source of notifications
+     * @return false If nothing happened
+     */
+    bool isNotified()
+    {
+        NordicUARTSession *pSource = getSource();
+        return !pSource ||
+               (pSource->notificationCount.load(::std::memory_order_acquire) != notificationCount) ||
+               expired(getDeadline());
+    };
+
+protected:
+    static nus_clock::time_point deadline(unsigned int timeoutMillis)
+    {
+        if (timeoutMillis == 0)
+            return nus_clock::time_point::max();
+        return nus_clock::now() + ::std::chrono::milliseconds(timeoutMillis);
+    };
+
+    static bool expired(nus_clock::time_point deadline)
+    {
+        return (deadline != nus_clock::time_point::max()) &&
+               (nus_clock::now() >= deadline);
+    };
+
+private:
+    uint32_t notificationCount = 0;
+};
+
+/**
+ * @brief Coroutine of a protocol conversation
+ *
+ * @note Coroutines start suspended. Call NuSExecutor::spawn() to run them.
+ *       Exceptions thrown inside a coroutine are ignored.
+ */
+class NuSTask
+{
+public:
+    struct promise_type
+    {
+        NuSAwaitable *pAwaiting = nullptr;
+
+        NuSTask get_return_object()
+        {
+            return NuSTask(::std::coroutine_handle<promise_type>::from_promise(*this));
+        };
+        ::std::suspend_always initial_suspend() noexcept { return {}; };
+        ::std::suspend_always final_suspend() noexcept { return {}; };
+        void return_void() noexcept {};
+        void unhandled_exception() noexcept {};
+    };
+
+    NuSTask(const NuSTask &) = delete;
+    NuSTask &operator=(const NuSTask &) = delete;
+    NuSTask(NuSTask &&other) noexcept : handle(other.handle) { other.handle = nullptr; };
+    NuSTask &operator=(NuSTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+                handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    };
+    ~NuSTask()
+    {
+        if (handle)
+            handle.destroy();
+    };
+
+    /**
+     * @brief Check if this coroutine has finished
+     *
+     * @return true If finished (or empty)
+     * @return false If not finished
+     */
+    bool done() const noexcept { return !handle || handle.done(); };
+
+private:
+    friend class NuSExecutor;
+    explicit NuSTask(::std::coroutine_handle<promise_type> handle) : handle(handle) {};
+    ::std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * @brief Common implementation of awaitable operations
+ *
+ * @tparam Result Type returned by `co_await`
+ */
+template <class Result>
+class NuSAwaitableResult : public NuSAwaitable
+{
+public:
+    bool await_ready() { return tryComplete(); };
+    void await_suspend(::std::coroutine_handle<NuSTask::promise_type> handle)
+    {
+        handle.promise().pAwaiting = this;
+    };
+    Result await_resume() { return result; };
+
+protected:
+    Result result{};
+};
+
+/**
+ * @brief Awaitable peer connection. See NuSAsync::connect().
+ *
+ */
+class NuSConnectAwaitable : public NuSAwaitableResult<bool>
+{
+public:
+    NuSConnectAwaitable(NordicUARTService &service, unsigned int timeoutMillis)
+        : service(service), timeout(deadline(timeoutMillis)) {};
+
+    NuSConnectAwaitable(NordicUARTStream &stream, unsigned int timeoutMillis)
+        : service(stream), pSource(&stream), timeout(deadline(timeoutMillis)) {};
+
+    virtual bool poll() override
+    {
+        result = service.peerConnected.try_acquire();
+        return result || expired(timeout);
+    };
+
+    virtual NordicUARTSession *getSource() override { return pSource; };
+    virtual nus_clock::time_point getDeadline() override { return timeout; };
+
+private:
+    NordicUARTService &service;
+    NordicUARTSession *pSource = nullptr;
+    nus_clock::time_point timeout;
+};
+
+/**
+ * @brief Awaitable read. See NuSAsync::read().
+ *
+ */
+class NuSReadAwaitable : public NuSAwaitableResult<size_t>
+{
+public:
+    NuSReadAwaitable(
+        NordicUARTSession &session,
+        uint8_t *buffer,
+        size_t size,
+        unsigned int timeoutMillis)
+        : session(session), buffer(buffer), size(size), timeout(deadline(timeoutMillis)) {};
+
+    virtual bool poll() override
+    {
+        if (size == 0)
+            return true;
+        result = session.take(buffer, size);
+        if (result > 0)
+            return true;
+        // Note: a disconnection is reported just once, as in readBytes()
+        return session.disconnected.exchange(false) || session.stopped || expired(timeout);
+    };
+
+    virtual NordicUARTSession *getSource() override { return &session; };
+    virtual nus_clock::time_point getDeadline() override { return timeout; };
+
+private:
+    NordicUARTSession &session;
+    uint8_t *buffer;
+    size_t size;
+    nus_clock::time_point timeout;
+};
+
+/**
+ * @brief Awaitable write. See NuSAsync::write().
+ *
+ */
+class NuSWriteAwaitable : public NuSAwaitableResult<size_t>
+{
+public:
+    NuSWriteAwaitable(NordicUARTSession &session, const uint8_t *data, size_t size)
+        : session(session), data(data), size(size) {};
+
+    // Note: no source of notifications, since there is no way to know
+    // when the BLE stack has transmission buffers again
+    virtual bool poll() override
+    {
+        while (result < size)
+        {
+            size_t count = session.write(data + result, size - result);
+            if (count == 0)
+                // The peer is gone or out of buffers
+                return !session.isPeerConnected();
+            result = result + count;
+        }
+        return true;
+    };
+
+private:
+    NordicUARTSession &session;
+    const uint8_t *data;
+    size_t size;
+};
+
+/**
+ * @brief Awaitable operations
+ *
+ */
+namespace NuSAsync
+{
+    /**
+     * @brief Wait for a peer connection or a timeout if set
+     *
+     * @note Same as NordicUARTService::connect(), but not blocking.
+     *
+     * @param service Nordic UART Service
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return NuSConnectAwaitable `co_await` returns true on peer connection,
+     *                             false on timeout.
+     */
+    inline NuSConnectAwaitable connect(NordicUARTService &service, unsigned int timeoutMillis = 0)
+    {
+        return NuSConnectAwaitable(service, timeoutMillis);
+    };
+
+    /**
+     * @brief Wait for a peer connection or a timeout if set
+     *
+     * @note Same as above, but the executor is awakened on peer connection
+     *       instead of polling.
+     *
+     * @param stream Stream
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return NuSConnectAwaitable `co_await` returns true on peer connection,
+     *                             false on timeout.
+     */
+    inline NuSConnectAwaitable connect(NordicUARTStream &stream, unsigned int timeoutMillis = 0)
+    {
+        return NuSConnectAwaitable(stream, timeoutMillis);
+    };
+
+    /**
+     * @brief Wait for and read incoming data
+     *
+     * @note Completes as soon as some data is available,
+     *       which may be less than @p size bytes.
+     *
+     * @param session Stream or session to read from
+     * @param buffer To store the bytes in
+     * @param size Maximum count of bytes to read
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return NuSReadAwaitable `co_await` returns the count of bytes placed
+     *                          in @p buffer, or zero on timeout or disconnection.
+     */
+    inline NuSReadAwaitable read(
+        NordicUARTSession &session,
+        uint8_t *buffer,
+        size_t size,
+        unsigned int timeoutMillis = 0)
+    {
+        return NuSReadAwaitable(session, buffer, size, timeoutMillis);
+    };
+
+    /**
+     * @brief Write data and wait for it to drain
+     *
+     * @note When the BLE stack runs out of transmission buffers,
+     *       the remaining bytes are written later,
+     *       without blocking other coroutines.
+     *
+     * @param session Stream or session to write to
+     * @param data Pointer to bytes to write
+     * @param size Count of bytes to write
+     * @return NuSWriteAwaitable `co_await` returns the count of bytes written,
+     *                           less than @p size on disconnection.
+     */
+    inline NuSWriteAwaitable write(NordicUARTSession &session, const uint8_t *data, size_t size)
+    {
+        return NuSWriteAwaitable(session, data, size);
+    };
+}
+
+//-----------------------------------------------------------------------------
+// Executor
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Run many coroutines in a single task
+ *
+ * @note Not thread-safe. Use the same task to spawn and run coroutines.
+ *
+ * @note Streams and sessions awaited by coroutines must not be watched
+ *       by other wait sets. Otherwise, they are polled from time to time.
+ */
+class NuSExecutor
+{
+public:
+    /**
+     * @brief Add a coroutine to this executor
+     *
+     * @param task Coroutine. Ownership is transferred to this executor.
+     */
+    void spawn(NuSTask &&task)
+    {
+        if (!task.done())
+            tasks.push_back(::std::move(task));
+    };
+
+    /**
+     * @brief Resume all coroutines able to progress (non-blocking)
+     *
+     * @note Just operations notified since the last poll are checked.
+     *
+     * @return true If some coroutine progressed
+     * @return false If no coroutine progressed
+     */
+    bool poll()
+    {
+        bool progress = false;
+        for (size_t index = 0; index < tasks.size(); index++)
+        {
+            // Note: tasks may grow while resuming a coroutine,
+            // so references to elements must not be kept.
+            auto handle = tasks[index].handle;
+            NuSAwaitable *pAwaiting = handle.promise().pAwaiting;
+            if (!pAwaiting || (pAwaiting->isNotified() && pAwaiting->tryComplete()))
+            {
+                handle.promise().pAwaiting = nullptr;
+                handle.resume();
+                progress = true;
+            }
+        }
+        // Remove finished coroutines
+        for (auto it = tasks.begin(); it != tasks.end();)
+            if (it->done())
+                it = tasks.erase(it);
+            else
+                ++it;
+        return progress;
+    };
+
+    /**
+     * @brief Run all coroutines until finished (blocking)
+     *
+     * @note When no coroutine is able to progress, the calling task
+     *       sleeps until awakened by the BLE host task or a deadline expires.
+     *
+     * @param pollingMillis Time between polls of operations
+     *                      with no source of notifications,
+     *                      for example, write() while the BLE stack is out
+     *                      of transmission buffers.
+     */
+    void run(unsigned int pollingMillis = 10)
+    {
+        while (!tasks.empty())
+            if (!poll())
+                wait(pollingMillis);
+    };
+
+    /**
+     * @brief Get the count of unfinished coroutines
+     *
+     * @return size_t Count of coroutines
+     */
+    size_t size() const noexcept { return tasks.size(); };
+
+private:
+    ::std::vector<NuSTask> tasks;
+    // Receives notifications from awaited streams and sessions
+    NuSWaitSet waitSet;
+
+    // Wait for something to happen to any coroutine
+    void wait(unsigned int pollingMillis)
+    {
+        auto wakeUp = nus_clock::time_point::max();
+        bool notified = false;
+        for (auto &task : tasks)
+        {
+            NuSAwaitable *pAwaiting = task.handle.promise().pAwaiting;
+            NordicUARTSession *pSource = pAwaiting ? pAwaiting->getSource() : nullptr;
+            // Note: the events to watch do not matter, since NuSWaitSet::wait()
+            // is not called. Just notifications are needed.
+            if (!pSource || (waitSet.add(*pSource, 0) < 0))
+            {
+                // Not able to awake this task
+                auto next = nus_clock::now() + ::std::chrono::milliseconds(pollingMillis);
+                if (next < wakeUp)
+                    wakeUp = next;
+            }
+            else if (pAwaiting->isNotified())
+                // Notified before add(), so the semaphore may not be released
+                notified = true;
+            if (pAwaiting && (pAwaiting->getDeadline() < wakeUp))
+                wakeUp = pAwaiting->getDeadline();
+        }
+        if (!notified)
+        {
+            if (wakeUp == nus_clock::time_point::max())
+                waitSet.signal.acquire();
+            else
+                waitSet.signal.try_acquire_until(wakeUp);
+        }
+        waitSet.clear();
+    };
+};
+
+#else
+#error NuCoroutines.hpp requires C++20 coroutines
+#endif
+
+#endif
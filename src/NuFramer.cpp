@@ -0,0 +1,648 @@
+/**
+ * @file NuFramer.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Message framing over the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuFramer.hpp"
+#include <NimBLEDevice.h>
+#include <chrono>
+#include <cstring> // For memcpy()
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+// Size of the header of each frame in the reassembly ring
+#define FRAME_HEADER_SIZE 4
+// Frame size at the header meaning "continue at the beginning of the ring"
+#define FRAME_WRAP_MARKER 0xFFFF
+
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+//-----------------------------------------------------------------------------
+// CRC lookup tables (computed at compile time)
+//-----------------------------------------------------------------------------
+
+struct NuSCRCTables
+{
+    uint16_t crc16[256];
+    uint32_t crc32[256];
+
+    constexpr NuSCRCTables() : crc16(), crc32()
+    {
+        for (uint32_t index = 0; index < 256; index++)
+        {
+            // CRC-16/CCITT-FALSE: polynomial 0x1021, not reflected
+            uint16_t crc = index << 8;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+            crc16[index] = crc;
+
+            // CRC-32/ISO-HDLC: polynomial 0x04C11DB7, reflected
+            uint32_t crc32Value = index;
+            for (int bit = 0; bit < 8; bit++)
+                crc32Value = (crc32Value & 1) ? ((crc32Value >> 1) ^ 0xEDB88320) : (crc32Value >> 1);
+            crc32[index] = crc32Value;
+        }
+    };
+};
+
+static constexpr NuSCRCTables crcTables{};
+
+uint16_t NordicUARTFramer::crc16(const uint8_t *data, size_t size, uint16_t crc) noexcept
+{
+    while (size--)
+        crc = (crc << 8) ^ crcTables.crc16[((crc >> 8) ^ *data++) & 0xFF];
+    return crc;
+}
+
+uint32_t NordicUARTFramer::crc32(const uint8_t *data, size_t size, uint32_t crc) noexcept
+{
+    crc = ~crc;
+    while (size--)
+        crc = crcTables.crc32[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static size_t getCheckSize(NuSFrameCheck_t check)
+{
+    switch (check)
+    {
+    case NUS_CHECK_CRC16:
+        return 2;
+    case NUS_CHECK_CRC32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Initialization
+//-----------------------------------------------------------------------------
+
+NordicUARTFramer::NordicUARTFramer(
+    NuSFraming_t framing,
+    NuSFrameCheck_t check,
+    size_t maxFrameSize,
+    size_t ringSize)
+    : NordicUARTService(), framing(framing), check(check)
+{
+    checkSize = getCheckSize(check);
+    // Note: frame sizes must fit in the header
+    if ((maxFrameSize + checkSize) >= FRAME_WRAP_MARKER)
+        maxFrameSize = FRAME_WRAP_MARKER - checkSize - 1;
+    this->maxFrameSize = maxFrameSize;
+    size_t minRingSize = FRAME_HEADER_SIZE + maxFrameSize + checkSize;
+    ring.resize((ringSize < minRingSize) ? minRingSize : ringSize);
+}
+
+//-----------------------------------------------------------------------------
+// GATT server events
+//-----------------------------------------------------------------------------
+
+void NordicUARTFramer::onUnsubscribe(size_t subscriberCount)
+{
+    if (subscriberCount == 0)
+    {
+        // Discard an unfinished frame, if any
+        resetDecoder();
+        // Awake task at readFrame()
+        disconnected = true;
+        frameAvailable.release();
+    }
+}
+
+void NordicUARTFramer::onPeerSubscribe(uint16_t connHandle)
+{
+    disconnected = false;
+}
+
+void NordicUARTFramer::onStop()
+{
+    onUnsubscribe(0);
+}
+
+void NordicUARTFramer::onWrite(
+    NimBLECharacteristic *pCharacteristic,
+    NimBLEConnInfo &connInfo)
+{
+    NimBLEAttValue value = pCharacteristic->getValue();
+    receive(value.data(), value.size(), connInfo.getConnHandle());
+}
+
+//-----------------------------------------------------------------------------
+// Decoding
+//-----------------------------------------------------------------------------
+
+void NordicUARTFramer::receive(const uint8_t *data, size_t size, uint16_t connHandle)
+{
+    if (bInFrame && (connHandle != frameConnHandle))
+        // Frames from different peers must not be interleaved
+        dropFrame(stats.encodingErrors);
+
+    for (size_t index = 0; index < size; index++)
+    {
+        uint8_t byte = data[index];
+        switch (framing)
+        {
+        case NUS_FRAMING_COBS:
+            if (byte == 0)
+            {
+                // Delimiter
+                if (bInFrame)
+                {
+                    if (bDiscarding)
+                        resetDecoder();
+                    else if (cobsCount > 0)
+                        dropFrame(stats.encodingErrors);
+                    else
+                        endFrame();
+                }
+                continue;
+            }
+            if (!bInFrame)
+                beginFrame(connHandle);
+            if (cobsCount == 0)
+            {
+                // Code byte. A zero is implied between blocks,
+                // unless the previous block was full.
+                if ((cobsCode != 0) && (cobsCode != 0xFF))
+                    append(0);
+                cobsCode = byte;
+                cobsCount = byte - 1;
+            }
+            else
+            {
+                append(byte);
+                cobsCount--;
+            }
+            break;
+
+        case NUS_FRAMING_SLIP:
+            if (byte == SLIP_END)
+            {
+                // Delimiter
+                if (bInFrame)
+                {
+                    if (bDiscarding)
+                        resetDecoder();
+                    else
+                        endFrame();
+                }
+                continue;
+            }
+            if (!bInFrame)
+                beginFrame(connHandle);
+            if (slipEscape)
+            {
+                slipEscape = false;
+                if (byte == SLIP_ESC_END)
+                    append(SLIP_END);
+                else if (byte == SLIP_ESC_ESC)
+                    append(SLIP_ESC);
+                else if (!bDiscarding)
+                {
+                    // Discard until the next delimiter
+                    ::std::lock_guard<::std::mutex> lock(ringMutex);
+                    stats.encodingErrors++;
+                    bDiscarding = true;
+                }
+            }
+            else if (byte == SLIP_ESC)
+                slipEscape = true;
+            else
+                append(byte);
+            break;
+
+        case NUS_FRAMING_LENGTH:
+            if (lengthHeader)
+            {
+                lengthValue = lengthValue | ((uint32_t)(byte & 0x7F) << lengthShift);
+                lengthShift = lengthShift + 7;
+                if (byte & 0x80)
+                {
+                    if (lengthShift >= 28)
+                        dropFrame(stats.encodingErrors);
+                    continue;
+                }
+                lengthHeader = false;
+                if (lengthValue == 0)
+                    // Empty frame
+                    resetDecoder();
+                else if (lengthValue > (maxFrameSize + checkSize))
+                {
+                    {
+                        ::std::lock_guard<::std::mutex> lock(ringMutex);
+                        stats.oversizedFrames++;
+                    }
+                    bInFrame = true;
+                    bDiscarding = true;
+                    frameConnHandle = connHandle;
+                }
+                else
+                    beginFrame(connHandle);
+                continue;
+            }
+            else
+            {
+                // Copy as many bytes as possible in a single step
+                size_t count = size - index;
+                if (count > lengthValue)
+                    count = lengthValue;
+                if (!bDiscarding)
+                {
+                    memcpy(ring.data() + tail + FRAME_HEADER_SIZE + frameLength, data + index, count);
+                    frameLength = frameLength + count;
+                }
+                lengthValue = lengthValue - count;
+                index = index + count - 1;
+                if (lengthValue == 0)
+                {
+                    if (bDiscarding)
+                        resetDecoder();
+                    else
+                        endFrame();
+                }
+            }
+            break;
+        }
+    }
+}
+
+void NordicUARTFramer::beginFrame(uint16_t connHandle)
+{
+    // Reserve room for the longest frame, contiguous
+    size_t needed = FRAME_HEADER_SIZE + maxFrameSize + checkSize;
+    size_t capacity = ring.size();
+    ::std::unique_lock<::std::mutex> lock(ringMutex);
+    while (true)
+    {
+        if (used == 0)
+            head = tail = 0;
+        if ((tail > head) || (used == 0))
+        {
+            // Free space at [tail, capacity) and [0, head)
+            if ((capacity - tail) >= needed)
+                break;
+            if (head >= needed)
+            {
+                // Continue at the beginning of the ring
+                if ((capacity - tail) >= FRAME_HEADER_SIZE)
+                {
+                    uint16_t marker = FRAME_WRAP_MARKER;
+                    memcpy(ring.data() + tail, &marker, sizeof(marker));
+                }
+                used = used + capacity - tail;
+                tail = 0;
+                break;
+            }
+        }
+        else if ((head - tail) >= needed)
+            // Free space at [tail, head)
+            break;
+
+        // Wait for frames to get consumed
+        lock.unlock();
+        roomAvailable.acquire();
+        lock.lock();
+    }
+    bInFrame = true;
+    frameConnHandle = connHandle;
+}
+
+void NordicUARTFramer::append(uint8_t byte)
+{
+    if (bDiscarding)
+        return;
+    if (frameLength >= (maxFrameSize + checkSize))
+    {
+        // Discard until the next delimiter
+        ::std::lock_guard<::std::mutex> lock(ringMutex);
+        stats.oversizedFrames++;
+        bDiscarding = true;
+        return;
+    }
+    ring[tail + FRAME_HEADER_SIZE + frameLength] = byte;
+    frameLength++;
+}
+
+void NordicUARTFramer::endFrame()
+{
+    uint8_t *frame = ring.data() + tail + FRAME_HEADER_SIZE;
+    if (frameLength < checkSize)
+    {
+        dropFrame(stats.encodingErrors);
+        return;
+    }
+    size_t size = frameLength - checkSize;
+    bool valid = true;
+    if (check == NUS_CHECK_CRC16)
+    {
+        uint16_t crc = crc16(frame, size);
+        valid = (frame[size] == (crc & 0xFF)) && (frame[size + 1] == (crc >> 8));
+    }
+    else if (check == NUS_CHECK_CRC32)
+    {
+        uint32_t crc = crc32(frame, size);
+        for (size_t index = 0; index < 4; index++)
+            valid = valid && (frame[size + index] == ((crc >> (8 * index)) & 0xFF));
+    }
+    if (!valid)
+    {
+        dropFrame(stats.checkErrors);
+        return;
+    }
+    if (size == 0)
+    {
+        // Empty frames are ignored
+        resetDecoder();
+        return;
+    }
+
+    // Commit
+    uint16_t header[2] = {(uint16_t)size, frameConnHandle};
+    memcpy(frame - FRAME_HEADER_SIZE, header, FRAME_HEADER_SIZE);
+    {
+        ::std::lock_guard<::std::mutex> lock(ringMutex);
+        tail = tail + FRAME_HEADER_SIZE + size;
+        used = used + FRAME_HEADER_SIZE + size;
+        frameCount++;
+        stats.receivedFrames++;
+    }
+    resetDecoder();
+
+    if (frameCallback)
+    {
+        // Deliver straight from here
+        uint16_t connHandle;
+        const uint8_t *data = popFrame(size, connHandle);
+        try
+        {
+            frameCallback(data, size, connHandle);
+        }
+        catch (...)
+        {
+        };
+        releaseFrame();
+    }
+    else
+        // signal available frame
+        frameAvailable.release();
+}
+
+void NordicUARTFramer::dropFrame(uint32_t &counter)
+{
+    {
+        ::std::lock_guard<::std::mutex> lock(ringMutex);
+        counter++;
+    }
+    resetDecoder();
+}
+
+void NordicUARTFramer::resetDecoder()
+{
+    // Note: room reserved for the frame is not committed, so nothing to release
+    bInFrame = false;
+    bDiscarding = false;
+    frameLength = 0;
+    cobsCode = 0;
+    cobsCount = 0;
+    slipEscape = false;
+    lengthHeader = true;
+    lengthValue = 0;
+    lengthShift = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Reading
+//-----------------------------------------------------------------------------
+
+const uint8_t *NordicUARTFramer::popFrame(size_t &size, uint16_t &connHandle)
+{
+    ::std::lock_guard<::std::mutex> lock(ringMutex);
+    if (frameCount == 0)
+        return nullptr;
+    size_t capacity = ring.size();
+    uint16_t header[2];
+    if ((capacity - head) >= FRAME_HEADER_SIZE)
+        memcpy(header, ring.data() + head, FRAME_HEADER_SIZE);
+    if (((capacity - head) < FRAME_HEADER_SIZE) || (header[0] == FRAME_WRAP_MARKER))
+    {
+        // Continue at the beginning of the ring
+        used = used - (capacity - head);
+        head = 0;
+        memcpy(header, ring.data(), FRAME_HEADER_SIZE);
+    }
+    size = header[0];
+    connHandle = header[1];
+    heldSpan = FRAME_HEADER_SIZE + size;
+    frameCount--;
+    return ring.data() + head + FRAME_HEADER_SIZE;
+}
+
+void NordicUARTFramer::releaseFrame()
+{
+    {
+        ::std::lock_guard<::std::mutex> lock(ringMutex);
+        if (heldSpan == 0)
+            return;
+        head = head + heldSpan;
+        used = used - heldSpan;
+        heldSpan = 0;
+    }
+    // signal room in the ring
+    roomAvailable.release();
+}
+
+const uint8_t *NordicUARTFramer::readFrame(size_t &size, uint16_t &connHandle, unsigned int timeoutMillis)
+{
+    // The previous frame is no longer needed
+    releaseFrame();
+
+    auto deadline = nus_clock::now() + ::std::chrono::milliseconds(timeoutMillis);
+    while (true)
+    {
+        const uint8_t *data = popFrame(size, connHandle);
+        if (data)
+            return data;
+        if (disconnected)
+            break;
+        if (timeoutMillis == 0)
+            frameAvailable.acquire();
+        else if (!frameAvailable.try_acquire_until(deadline))
+        {
+            data = popFrame(size, connHandle);
+            if (data)
+                return data;
+            break;
+        }
+    }
+    size = 0;
+    connHandle = BLE_HS_CONN_HANDLE_NONE;
+    return nullptr;
+}
+
+NuSFrameStats_t NordicUARTFramer::getFrameStats()
+{
+    ::std::lock_guard<::std::mutex> lock(ringMutex);
+    return stats;
+}
+
+//-----------------------------------------------------------------------------
+// Encoding
+//-----------------------------------------------------------------------------
+
+size_t NordicUARTFramer::getEncodedSize(NuSFraming_t framing, NuSFrameCheck_t check, size_t size) noexcept
+{
+    size = size + getCheckSize(check);
+    switch (framing)
+    {
+    case NUS_FRAMING_COBS:
+        // A code byte every 254 bytes, plus the first one and the delimiter
+        return size + (size / 254) + 2;
+    case NUS_FRAMING_SLIP:
+        // Every byte escaped in the worst case, plus leading and trailing delimiters
+        return (2 * size) + 2;
+    default:
+        // Varint of up to 5 bytes
+        return size + 5;
+    }
+}
+
+size_t NordicUARTFramer::encode(
+    NuSFraming_t framing,
+    NuSFrameCheck_t check,
+    uint8_t *buffer,
+    size_t size,
+    size_t capacity) noexcept
+{
+    if (capacity < getEncodedSize(framing, check, size))
+        return 0;
+
+    // Append the integrity check (little-endian)
+    if (check == NUS_CHECK_CRC16)
+    {
+        uint16_t crc = crc16(buffer, size);
+        buffer[size++] = crc & 0xFF;
+        buffer[size++] = crc >> 8;
+    }
+    else if (check == NUS_CHECK_CRC32)
+    {
+        uint32_t crc = crc32(buffer, size);
+        for (size_t index = 0; index < 4; index++)
+            buffer[size++] = (crc >> (8 * index)) & 0xFF;
+    }
+
+    switch (framing)
+    {
+    case NUS_FRAMING_COBS:
+    {
+        // Note: the output never overtakes the input
+        // since the input is shifted by the maximum overhead
+        size_t shift = (size / 254) + 1;
+        uint8_t *input = buffer + shift;
+        memmove(input, buffer, size);
+        size_t output = 1;
+        size_t codeIndex = 0;
+        uint8_t code = 1;
+        for (size_t index = 0; index < size; index++)
+        {
+            uint8_t byte = input[index];
+            if (byte == 0)
+            {
+                buffer[codeIndex] = code;
+                codeIndex = output++;
+                code = 1;
+            }
+            else
+            {
+                buffer[output++] = byte;
+                if (++code == 0xFF)
+                {
+                    buffer[codeIndex] = code;
+                    codeIndex = output++;
+                    code = 1;
+                }
+            }
+        }
+        buffer[codeIndex] = code;
+        buffer[output++] = 0;
+        return output;
+    }
+    case NUS_FRAMING_SLIP:
+    {
+        // Note: encoded backwards, so the output never overtakes the input
+        size_t escapeCount = 0;
+        for (size_t index = 0; index < size; index++)
+            if ((buffer[index] == SLIP_END) || (buffer[index] == SLIP_ESC))
+                escapeCount++;
+        size_t result = size + escapeCount + 2;
+        size_t output = result;
+        buffer[--output] = SLIP_END;
+        for (size_t index = size; index-- > 0;)
+        {
+            uint8_t byte = buffer[index];
+            if (byte == SLIP_END)
+            {
+                buffer[--output] = SLIP_ESC_END;
+                buffer[--output] = SLIP_ESC;
+            }
+            else if (byte == SLIP_ESC)
+            {
+                buffer[--output] = SLIP_ESC_ESC;
+                buffer[--output] = SLIP_ESC;
+            }
+            else
+                buffer[--output] = byte;
+        }
+        buffer[--output] = SLIP_END;
+        return result;
+    }
+    default:
+    {
+        uint8_t header[5];
+        size_t headerSize = 0;
+        size_t value = size;
+        do
+        {
+            header[headerSize] = value & 0x7F;
+            value = value >> 7;
+            if (value)
+                header[headerSize] |= 0x80;
+            headerSize++;
+        } while (value);
+        memmove(buffer + headerSize, buffer, size);
+        memcpy(buffer, header, headerSize);
+        return headerSize + size;
+    }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Writing
+//-----------------------------------------------------------------------------
+
+bool NordicUARTFramer::writeFrame(uint8_t *buffer, size_t size, size_t capacity)
+{
+    size_t encodedSize = encode(framing, check, buffer, size, capacity);
+    return (encodedSize > 0) && (write(buffer, encodedSize) == encodedSize);
+}
+
+bool NordicUARTFramer::sendFrame(const uint8_t *data, size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(txMutex);
+    size_t capacity = getEncodedSize(size);
+    if (txBuffer.size() < capacity)
+        txBuffer.resize(capacity);
+    memcpy(txBuffer.data(), data, size);
+    return writeFrame(txBuffer.data(), size, capacity);
+}
@@ -0,0 +1,319 @@
+/**
+ * @file NuFramer.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Message framing over the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUFRAMER_HPP__
+#define __NUFRAMER_HPP__
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "NuS.hpp"
+
+/**
+ * @brief Encoding of message boundaries
+ *
+ */
+typedef enum
+{
+    /** Consistent Overhead Byte Stuffing. Frames are delimited by a zero byte. */
+    NUS_FRAMING_COBS = 0,
+    /** Serial Line Internet Protocol (RFC 1055). Frames are delimited by 0xC0. */
+    NUS_FRAMING_SLIP,
+    /** Frames are preceded by their length (unsigned LEB128 varint) */
+    NUS_FRAMING_LENGTH
+} NuSFraming_t;
+
+/**
+ * @brief Integrity check appended to each frame (little-endian)
+ *
+ */
+typedef enum
+{
+    /** No check */
+    NUS_CHECK_NONE = 0,
+    /** CRC-16/CCITT-FALSE (2 bytes) */
+    NUS_CHECK_CRC16,
+    /** CRC-32/ISO-HDLC, as in Ethernet and ZIP (4 bytes) */
+    NUS_CHECK_CRC32
+} NuSFrameCheck_t;
+
+/**
+ * @brief Statistics of incoming frames
+ *
+ */
+typedef struct
+{
+    /** Count of valid frames */
+    uint32_t receivedFrames;
+    /** Count of frames discarded due to a failed integrity check */
+    uint32_t checkErrors;
+    /** Count of frames discarded due to ill-formed encoding */
+    uint32_t encodingErrors;
+    /** Count of frames discarded for being too long */
+    uint32_t oversizedFrames;
+} NuSFrameStats_t;
+
+/**
+ * @brief Callback to execute for incoming frames
+ *
+ * @param data Pointer to the frame, not including the integrity check.
+ *             Valid only while the callback runs.
+ * @param size Size of the frame in bytes
+ * @param connHandle Connection handle of the sender
+ */
+typedef ::std::function<void(const uint8_t *data, size_t size, uint16_t connHandle)> NuSFrameCallback_t;
+
+/**
+ * @brief Message-oriented communications through BLE and Nordic UART Service
+ *
+ * @note BLE writes may split or merge application messages.
+ *       This class restores message boundaries (frames), no matter
+ *       the MTU. Each incoming frame is delivered as a contiguous
+ *       block of memory with no extra copies.
+ *
+ * @note Frames from different peers must not be interleaved.
+ *       An unfinished frame is discarded when another peer sends data.
+ */
+class NordicUARTFramer : public NordicUARTService
+{
+public:
+    /**
+     * @brief Create a framer
+     *
+     * @param framing Encoding of message boundaries
+     * @param check Integrity check
+     * @param maxFrameSize Maximum size of a frame in bytes, not including the
+     *                     integrity check nor the encoding overhead.
+     *                     Longer incoming frames are discarded.
+     * @param ringSize Size in bytes of the buffer holding incoming frames until read.
+     *                 The peer gets blocked while there is no room.
+     *                 Never less than @p maxFrameSize plus a few bytes.
+     */
+    NordicUARTFramer(
+        NuSFraming_t framing = NUS_FRAMING_COBS,
+        NuSFrameCheck_t check = NUS_CHECK_CRC16,
+        size_t maxFrameSize = 512,
+        size_t ringSize = 2048);
+    NordicUARTFramer(const NordicUARTFramer &) = delete;
+    NordicUARTFramer(NordicUARTFramer &&) = delete;
+    NordicUARTFramer &operator=(const NordicUARTFramer &) = delete;
+    NordicUARTFramer &operator=(NordicUARTFramer &&) = delete;
+    virtual ~NordicUARTFramer() {};
+
+protected:
+    // Overriden Methods
+    virtual void onUnsubscribe(size_t subscriberCount) override;
+    virtual void onPeerSubscribe(uint16_t connHandle) override;
+    virtual void onStop() override;
+    void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override;
+
+    /**
+     * @brief Decode incoming data
+     *
+     * @note Blocks the calling task while there is no room
+     *       for another frame.
+     *
+     * @param data Incoming data
+     * @param size Size of incoming data in bytes
+     * @param connHandle Connection handle of the sender
+     */
+    void receive(const uint8_t *data, size_t size, uint16_t connHandle);
+
+public:
+    /**
+     * @brief Wait for and get an incoming frame (blocking)
+     *
+     * @note The frame is held until the next call to readFrame().
+     *       Just one task should read frames.
+     *
+     * @param[out] size Size of the frame in bytes, or zero on
+     *                  disconnection or timeout.
+     * @param[out] connHandle Connection handle of the sender
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return const uint8_t* Pointer to the frame, not including the
+     *                        integrity check, or `nullptr`
+     *                        on disconnection or timeout.
+     */
+    const uint8_t *readFrame(size_t &size, uint16_t &connHandle, unsigned int timeoutMillis = 0);
+
+    /**
+     * @brief Wait for and get an incoming frame (blocking)
+     *
+     * @note Same as readFrame(size_t&,uint16_t&,unsigned int),
+     *       but the sender is not informed.
+     *
+     * @param[out] size Size of the frame in bytes, or zero on
+     *                  disconnection or timeout.
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return const uint8_t* Pointer to the frame or `nullptr`
+     *                        on disconnection or timeout.
+     */
+    const uint8_t *readFrame(size_t &size, unsigned int timeoutMillis = 0)
+    {
+        uint16_t connHandle;
+        return readFrame(size, connHandle, timeoutMillis);
+    };
+
+    /**
+     * @brief Set a callback for incoming frames
+     *
+     * @note When set, frames are delivered from the BLE host task
+     *       as soon as they are complete, and readFrame() must not be called.
+     *       Do not perform time-consuming tasks there.
+     *
+     * @param callback Function to execute, or `nullptr` to disable.
+     */
+    void onFrame(NuSFrameCallback_t callback) { frameCallback = callback; };
+
+    /**
+     * @brief Encode and send a frame with no extra copies
+     *
+     * @note The frame is encoded in place, so @p buffer is overwritten.
+     *
+     * @param buffer Frame to send, at the beginning of the buffer
+     * @param size Size of the frame in bytes
+     * @param capacity Size of @p buffer in bytes.
+     *                 Must be at least getEncodedSize(@p size).
+     * @return true On success
+     * @return false If @p capacity is not enough or the frame was not
+     *               completely sent.
+     */
+    bool writeFrame(uint8_t *buffer, size_t size, size_t capacity);
+
+    /**
+     * @brief Encode and send a frame
+     *
+     * @note Same as writeFrame(), but @p data is copied
+     *       to an internal buffer in advance.
+     *
+     * @param data Frame to send
+     * @param size Size of the frame in bytes
+     * @return true On success
+     * @return false If the frame was not completely sent.
+     */
+    bool sendFrame(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Get the buffer capacity required to encode a frame
+     *
+     * @param size Size of the frame in bytes
+     * @return size_t Required capacity in bytes (worst case)
+     */
+    size_t getEncodedSize(size_t size) const noexcept
+    {
+        return getEncodedSize(framing, check, size);
+    };
+
+    /**
+     * @brief Get statistics of incoming frames
+     *
+     * @return NuSFrameStats_t Statistics
+     */
+    NuSFrameStats_t getFrameStats();
+
+public:
+    /**
+     * @brief Get the buffer capacity required to encode a frame
+     *
+     * @param framing Encoding of message boundaries
+     * @param check Integrity check
+     * @param size Size of the frame in bytes
+     * @return size_t Required capacity in bytes (worst case)
+     */
+    static size_t getEncodedSize(NuSFraming_t framing, NuSFrameCheck_t check, size_t size) noexcept;
+
+    /**
+     * @brief Encode a frame in place
+     *
+     * @param framing Encoding of message boundaries
+     * @param check Integrity check
+     * @param buffer Frame to encode, at the beginning of the buffer.
+     *               Overwritten with the encoded frame.
+     * @param size Size of the frame in bytes
+     * @param capacity Size of @p buffer in bytes
+     * @return size_t Size of the encoded frame in bytes, or zero
+     *                if @p capacity is less than getEncodedSize().
+     */
+    static size_t encode(
+        NuSFraming_t framing,
+        NuSFrameCheck_t check,
+        uint8_t *buffer,
+        size_t size,
+        size_t capacity) noexcept;
+
+    /**
+     * @brief Compute a CRC-16/CCITT-FALSE
+     *
+     * @param data Data to check
+     * @param size Size of @p data in bytes
+     * @param crc Previous CRC to continue with, or the initial value
+     * @return uint16_t CRC
+     */
+    static uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc = 0xFFFF) noexcept;
+
+    /**
+     * @brief Compute a CRC-32/ISO-HDLC
+     *
+     * @param data Data to check
+     * @param size Size of @p data in bytes
+     * @param crc Previous CRC to continue with, or zero
+     * @return uint32_t CRC
+     */
+    static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) noexcept;
+
+private:
+    NuSFraming_t framing;
+    NuSFrameCheck_t check;
+    size_t maxFrameSize;
+    size_t checkSize;
+
+    // Reassembly ring. Each frame is preceded by a header: size and connection handle.
+    ::std::vector<uint8_t> ring;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t used = 0;
+    size_t frameCount = 0;
+    size_t heldSpan = 0;
+    ::std::mutex ringMutex;
+    nus_semaphore frameAvailable{0};
+    nus_semaphore roomAvailable{0};
+    ::std::atomic<bool> disconnected{false};
+    NuSFrameStats_t stats{};
+
+    // Decoder state
+    bool bInFrame = false;
+    bool bDiscarding = false;
+    size_t frameLength = 0;
+    uint16_t frameConnHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint8_t cobsCode = 0;
+    uint8_t cobsCount = 0;
+    bool slipEscape = false;
+    bool lengthHeader = true;
+    uint32_t lengthValue = 0;
+    uint8_t lengthShift = 0;
+
+    NuSFrameCallback_t frameCallback;
+    ::std::vector<uint8_t> txBuffer;
+    ::std::mutex txMutex;
+
+    void beginFrame(uint16_t connHandle);
+    void append(uint8_t byte);
+    void endFrame();
+    void dropFrame(uint32_t &counter);
+    void resetDecoder();
+    const uint8_t *popFrame(size_t &size, uint16_t &connHandle);
+    void releaseFrame();
+};
+
+#endif
@@ -11,7 +11,10 @@
 
 #include <exception>
 #include <stdexcept>
+#include <chrono>
 #include "NuPacket.hpp"
+#include "NuWaitSet.hpp"
+#include "NuTrace.hpp"
 
 //-----------------------------------------------------------------------------
 // Globals
@@ -28,12 +31,38 @@ void NordicUARTPacket::onUnsubscribe(size_t subscriberCount)
     if (subscriberCount == 0)
     {
         // Awake task at read()
-        availableByteCount = 0;
-        incomingBuffer = nullptr;
+        // Note: incomingPacket is left untouched, since it may be in use
+        incomingBuffer.store(nullptr, ::std::memory_order_release);
+        availableByteCount.store(0, ::std::memory_order_relaxed);
+        incomingConnHandle.store(BLE_HS_CONN_HANDLE_NONE, ::std::memory_order_relaxed);
+        bReadable.store(true, ::std::memory_order_release);
         dataAvailable.release();
+        notifyWaitSet();
     }
 };
 
+void NordicUARTPacket::onStop()
+{
+    // Awake task at read() as if all peers were disconnected
+    onUnsubscribe(0);
+}
+
+void NordicUARTPacket::onPeerSubscribe(uint16_t connHandle)
+{
+    // Writable now
+    notifyWaitSet();
+}
+
+void NordicUARTPacket::notifyWaitSet()
+{
+    // Note: NuSWaitSet::clear() waits for this count to drop to zero
+    waitSetNotifiers++;
+    NuSWaitSet *pSet = pWaitSet;
+    if (pSet)
+        pSet->notify();
+    waitSetNotifiers--;
+}
+
 //-----------------------------------------------------------------------------
 // NordicUARTService implementation
 //-----------------------------------------------------------------------------
@@ -43,15 +72,44 @@ void NordicUARTPacket::onWrite(
     NimBLEConnInfo &connInfo)
 {
     // Wait for previous data to get consumed
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
     dataConsumed.acquire();
+    NUS_TRACE_END_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
 
     // Hold data until next read
     incomingPacket = pCharacteristic->getValue();
-    incomingBuffer = incomingPacket.data();
-    availableByteCount = incomingPacket.size();
+    const uint8_t *data = incomingPacket.data();
+    size_t size = incomingPacket.size();
+    uint16_t connHandle = connInfo.getConnHandle();
+
+    if (dataCallback && !bDispatch)
+    {
+        // Deliver data straight from here
+        size_t consumed = 0;
+        try
+        {
+            consumed = dataCallback(data, size, connHandle);
+        }
+        catch (...)
+        {
+        };
+        if (consumed >= size)
+        {
+            dataConsumed.release();
+            return;
+        }
+        // Hold bytes not consumed
+        data = data + consumed;
+        size = size - consumed;
+    }
 
     // signal available data
+    incomingConnHandle.store(connHandle, ::std::memory_order_relaxed);
+    availableByteCount.store(size, ::std::memory_order_relaxed);
+    incomingBuffer.store(data, ::std::memory_order_release);
+    bReadable.store(true, ::std::memory_order_release);
     dataAvailable.release();
+    notifyWaitSet();
 }
 
 //-----------------------------------------------------------------------------
@@ -60,8 +118,101 @@ void NordicUARTPacket::onWrite(
 
 const uint8_t *NordicUARTPacket::read(size_t &size) const noexcept
 {
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_PACKET_READ, 0);
+    dataConsumed.release();
+    dataAvailable.acquire();
+    bReadable.store(false, ::std::memory_order_relaxed);
+    const uint8_t *data = incomingBuffer.load(::std::memory_order_acquire);
+    size = (data) ? availableByteCount.load(::std::memory_order_relaxed) : 0;
+    NUS_TRACE_END_EVENT(NUS_TRACE_PACKET_READ, size);
+    return data;
+}
+
+const uint8_t *NordicUARTPacket::read(size_t &size, uint16_t &connHandle) const noexcept
+{
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_PACKET_READ, 0);
     dataConsumed.release();
     dataAvailable.acquire();
-    size = availableByteCount;
-    return incomingBuffer;
+    bReadable.store(false, ::std::memory_order_relaxed);
+    const uint8_t *data = incomingBuffer.load(::std::memory_order_acquire);
+    size = (data) ? availableByteCount.load(::std::memory_order_relaxed) : 0;
+    connHandle = incomingConnHandle.load(::std::memory_order_relaxed);
+    NUS_TRACE_END_EVENT(NUS_TRACE_PACKET_READ, size);
+    return data;
+}
+
+//-----------------------------------------------------------------------------
+// Data callback
+//-----------------------------------------------------------------------------
+
+void NordicUARTPacket::onData(NuSDataCallback_t callback, bool useDispatcher)
+{
+    // Stop the dispatcher thread, if any
+    bDispatch = false;
+    if (dispatcherThread.joinable())
+    {
+        // Awake the dispatcher thread
+        dataAvailable.release();
+        dispatcherThread.join();
+    }
+
+    // Drop the last packet returned by read(), if any.
+    // Otherwise, it would block the peer forever, since nobody
+    // is going to call read() again.
+    dataConsumed.release();
+    dataCallback = callback;
+    if (callback && useDispatcher)
+    {
+        bDispatch = true;
+        dispatcherThread = ::std::thread(&NordicUARTPacket::dispatchLoop, this);
+    }
+}
+
+void NordicUARTPacket::resumeData()
+{
+    // Note: a released semaphore would be a stale packet for read()
+    if (bDispatch)
+        dataAvailable.release();
+}
+
+void NordicUARTPacket::dispatchLoop()
+{
+    while (bDispatch)
+    {
+        // Wait for incoming data, disconnection or onData()
+        dataAvailable.acquire();
+        if (!bDispatch)
+            break;
+        if (!bReadable.exchange(false, ::std::memory_order_acquire))
+            // Nothing new: resumeData() was called while no data was held
+            continue;
+        const uint8_t *data = incomingBuffer.load(::std::memory_order_acquire);
+        size_t size = (data) ? availableByteCount.load(::std::memory_order_relaxed) : 0;
+        uint16_t connHandle = incomingConnHandle.load(::std::memory_order_relaxed);
+        while (bDispatch && (size > 0))
+        {
+            size_t consumed = 0;
+            try
+            {
+                consumed = dataCallback(data, size, connHandle);
+            }
+            catch (...)
+            {
+            };
+            if (consumed > size)
+                consumed = size;
+            data = data + consumed;
+            size = size - consumed;
+            if (size > 0)
+            {
+                // Deliver again at resumeData(),
+                // unless the connection is lost or onData() is called meanwhile.
+                // Note: the peer is blocked, so no more data arrives meanwhile.
+                dataAvailable.acquire();
+                if (!incomingBuffer.load(::std::memory_order_acquire))
+                    break;
+            }
+        }
+        dataConsumed.release();
+    }
 }
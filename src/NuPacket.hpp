@@ -12,8 +12,12 @@
 #ifndef __NUPACKET_HPP__
 #define __NUPACKET_HPP__
 
+#include <thread>
+#include <atomic>
 #include "NuS.hpp"
 
+class NuSWaitSet;
+
 /**
  * @brief Blocking serial communications through BLE and Nordic UART Service
  *
@@ -26,6 +30,8 @@
  */
 class NordicUARTPacket : public NordicUARTService
 {
+    friend class NuSWaitSet;
+
 public:
     // Singleton pattern and Rule of Five
 
@@ -50,6 +56,8 @@ public:
 protected:
     // Overriden Methods
     virtual void onUnsubscribe(size_t subscriberCount) override;
+    virtual void onPeerSubscribe(uint16_t connHandle) override;
+    virtual void onStop() override;
     void onWrite(
         NimBLECharacteristic *pCharacteristic,
         NimBLEConnInfo &connInfo) override;
@@ -76,16 +84,78 @@ public:
      */
     const uint8_t *read(size_t &size) const noexcept;
 
+    /**
+     * @brief Wait for and get incoming data in packets (blocking)
+     *        and the connection handle of the sender
+     *
+     * @note Same as read(size_t&), but also informs which peer
+     *       sent the packet, so an answer can be sent
+     *       to that peer only (see NordicUARTService::write(uint16_t,const uint8_t*,size_t)).
+     *       Packets from different peers are never mixed.
+     *
+     * @param[out] size Count of incoming bytes,
+     *                  or zero if the connection was lost.
+     * @param[out] connHandle Connection handle of the sender,
+     *                        or `BLE_HS_CONN_HANDLE_NONE` if the connection was lost.
+     * @return uint8_t* Pointer to incoming data, or `nullptr` if the connection
+     *                  was lost.
+     */
+    const uint8_t *read(size_t &size, uint16_t &connHandle) const noexcept;
+
+    /**
+     * @brief Set a callback for incoming packets
+     *
+     * @note Incoming packets are delivered as soon as they arrive,
+     *       with no need to block in read().
+     *       By default, the callback is executed from the BLE host task,
+     *       which gives the lowest possible latency.
+     *       Do not perform time-consuming tasks there.
+     *       Otherwise, use a dispatcher thread.
+     *
+     * @note Bytes not consumed by the callback are held until read().
+     *       The peer gets blocked meanwhile. When using a dispatcher thread,
+     *       bytes not consumed are delivered again at resumeData()
+     *       and read() must not be called.
+     *
+     * @note Should be called while no peer is connected.
+     *
+     * @param callback Function to execute, or `nullptr` to disable.
+     * @param useDispatcher True to execute the callback from a dispatcher thread.
+     */
+    void onData(NuSDataCallback_t callback, bool useDispatcher = false);
+
+    /**
+     * @brief Deliver bytes not consumed to the callback again
+     *
+     * @note Call when ready to consume them.
+     *       Ignored unless using a dispatcher thread.
+     */
+    void resumeData();
+
 private:
     mutable nus_semaphore dataConsumed{1};
     mutable nus_semaphore dataAvailable{0};
     NimBLEAttValue incomingPacket;
-    size_t availableByteCount = 0;
-    const uint8_t *incomingBuffer = nullptr;
+    // Written by the BLE host task, read by the reading task.
+    // incomingBuffer is stored last, with release semantics,
+    // to publish the other fields. Null if the connection was lost.
+    ::std::atomic<size_t> availableByteCount{0};
+    ::std::atomic<const uint8_t *> incomingBuffer{nullptr};
+    ::std::atomic<uint16_t> incomingConnHandle{BLE_HS_CONN_HANDLE_NONE};
+    NuSDataCallback_t dataCallback;
+    ::std::atomic<bool> bDispatch{false};
+    ::std::thread dispatcherThread;
+    ::std::atomic<NuSWaitSet *> pWaitSet{nullptr};
+    // Count of tasks inside notifyWaitSet()
+    ::std::atomic<uint32_t> waitSetNotifiers{0};
+    mutable ::std::atomic<bool> bReadable{false};
+
+    void dispatchLoop();
+    void notifyWaitSet();
 
     // Singleton pattern
     NordicUARTPacket() {};
-    ~NordicUARTPacket() {};
+    ~NordicUARTPacket() { onData(nullptr); };
 };
 
 /**
@@ -0,0 +1,90 @@
+/**
+ * @file NuProfile.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Execution time profiling of AT and shell commands
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuProfile.hpp"
+#include <cstdio> // For snprintf()
+
+//-----------------------------------------------------------------------------
+// Recording
+//-----------------------------------------------------------------------------
+
+void NuSCommandProfiler::stop(const ::std::string &name, ::std::chrono::steady_clock::time_point startTime)
+{
+    auto elapsed = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+                       ::std::chrono::steady_clock::now() - startTime)
+                       .count();
+    uint32_t micros = (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+
+    // Bucket index is log2(micros)
+    size_t bucket = 0;
+    while ((bucket < (NUS_PROFILE_BUCKETS - 1)) && ((micros >> (bucket + 1)) > 0))
+        bucket++;
+
+    ::std::lock_guard<::std::mutex> lock(profileMutex);
+    NuSCommandStats_t &stats = profile[name];
+    stats.count++;
+    stats.totalMicros += micros;
+    if (micros > stats.maxMicros)
+        stats.maxMicros = micros;
+    stats.histogram[bucket]++;
+}
+
+NuSCommandProfile_t NuSCommandProfiler::get()
+{
+    ::std::lock_guard<::std::mutex> lock(profileMutex);
+    return profile;
+}
+
+void NuSCommandProfiler::reset()
+{
+    ::std::lock_guard<::std::mutex> lock(profileMutex);
+    profile.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Reporting
+//-----------------------------------------------------------------------------
+
+uint32_t NuSCommandProfiler::getPercentile(const NuSCommandStats_t &stats, unsigned int percent) noexcept
+{
+    if (stats.count == 0)
+        return 0;
+    if (percent > 100)
+        percent = 100;
+    // Note: rounded up, so the 100th percentile is the slowest execution
+    uint64_t target = (((uint64_t)stats.count * percent) + 99) / 100;
+    uint64_t accumulated = 0;
+    for (size_t bucket = 0; bucket < NUS_PROFILE_BUCKETS; bucket++)
+    {
+        accumulated += stats.histogram[bucket];
+        if ((accumulated >= target) && (accumulated > 0))
+        {
+            // Upper bound of this bucket, but never above the maximum
+            uint64_t bound = (bucket < (NUS_PROFILE_BUCKETS - 1)) ? ((2ULL << bucket) - 1) : UINT32_MAX;
+            return (bound < stats.maxMicros) ? (uint32_t)bound : stats.maxMicros;
+        }
+    }
+    return stats.maxMicros;
+}
+
+::std::string NuSCommandProfiler::format(const ::std::string &name, const NuSCommandStats_t &stats)
+{
+    char numbers[64];
+    snprintf(
+        numbers,
+        sizeof(numbers),
+        ",%u,%u,%u,%u,%u",
+        (unsigned int)stats.count,
+        (unsigned int)((stats.count > 0) ? (stats.totalMicros / stats.count) : 0),
+        (unsigned int)stats.maxMicros,
+        (unsigned int)getPercentile(stats, 50),
+        (unsigned int)getPercentile(stats, 99));
+    return name + numbers;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file NuProfile.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Execution time profiling of AT and shell commands
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUPROFILE_HPP__
+#define __NUPROFILE_HPP__
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @brief Count of buckets in a latency histogram
+ *
+ * @note Bucket 0 counts executions shorter than 2 microseconds.
+ *       Bucket N counts executions from 2^N to 2^(N+1)-1 microseconds.
+ *       The last bucket also counts longer executions.
+ */
+#ifndef NUS_PROFILE_BUCKETS
+#define NUS_PROFILE_BUCKETS 24
+#endif
+
+/**
+ * @brief Execution counters of a single command
+ *
+ */
+typedef struct
+{
+    /** Count of executions */
+    uint32_t count;
+    /** Longest execution time in microseconds */
+    uint32_t maxMicros;
+    /** Total execution time in microseconds */
+    uint64_t totalMicros;
+    /** Count of executions by execution time (log2 of microseconds) */
+    uint32_t histogram[NUS_PROFILE_BUCKETS];
+} NuSCommandStats_t;
+
+/**
+ * @brief Execution counters of all commands, by command name
+ *
+ */
+typedef ::std::map<::std::string, NuSCommandStats_t> NuSCommandProfile_t;
+
+/**
+ * @brief Thread-safe execution counters of commands
+ *
+ * @note Disabled by default. Nothing is measured while disabled.
+ */
+class NuSCommandProfiler
+{
+public:
+    /**
+     * @brief Enable or disable profiling
+     *
+     * @param yesOrNo True to enable, false to disable
+     * @return true Previously, enabled
+     * @return false Previously, disabled
+     */
+    bool enable(bool yesOrNo) noexcept { return bEnabled.exchange(yesOrNo); };
+
+    /**
+     * @brief Check if profiling is enabled
+     *
+     * @return true If enabled
+     * @return false If disabled
+     */
+    bool isEnabled() const noexcept { return bEnabled; };
+
+    /**
+     * @brief Get the current time to measure an execution
+     *
+     * @return ::std::chrono::steady_clock::time_point Start time
+     */
+    static ::std::chrono::steady_clock::time_point start() noexcept
+    {
+        return ::std::chrono::steady_clock::now();
+    };
+
+    /**
+     * @brief Account for an execution
+     *
+     * @param name Command name
+     * @param startTime Start time of the execution, as given by start()
+     */
+    void stop(const ::std::string &name, ::std::chrono::steady_clock::time_point startTime);
+
+    /**
+     * @brief Get the counters of all commands executed since the last reset()
+     *
+     * @return NuSCommandProfile_t Copy of the counters
+     */
+    NuSCommandProfile_t get();
+
+    /**
+     * @brief Clear all counters
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Get an approximate percentile of execution time
+     *
+     * @param stats Counters of a command
+     * @param percent Percentile (from 0 to 100)
+     * @return uint32_t Upper bound of the execution time (in microseconds)
+     *                  of @p percent of the executions.
+     *                  Zero if there are no executions.
+     */
+    static uint32_t getPercentile(const NuSCommandStats_t &stats, unsigned int percent) noexcept;
+
+    /**
+     * @brief Format the counters of a command as a single text line
+     *
+     * @note Format: name, count, average, maximum, 50th and 99th percentiles
+     *       (times in microseconds), separated by commas.
+     *
+     * @param name Command name
+     * @param stats Counters of @p name
+     * @return ::std::string Text line, with no line terminator
+     */
+    static ::std::string format(const ::std::string &name, const NuSCommandStats_t &stats);
+
+private:
+    ::std::atomic<bool> bEnabled{false};
+    ::std::mutex profileMutex;
+    NuSCommandProfile_t profile;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file NuResume.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Session resumption for the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuResume.hpp"
+#include <cstring> // For memcpy()
+
+// Note: offsets wrap around, so they are compared by distance
+
+void NuSRetentionBuffer::setCapacity(size_t capacity)
+{
+    ring.resize(capacity);
+    ring.shrink_to_fit();
+    reset(endOffset);
+}
+
+void NuSRetentionBuffer::reset(uint32_t offset) noexcept
+{
+    head = 0;
+    startOffset = offset;
+    sentOffset = offset;
+    endOffset = offset;
+}
+
+size_t NuSRetentionBuffer::append(const uint8_t *data, size_t size) noexcept
+{
+    size_t capacity = ring.size();
+    size_t room = capacity - getRetainedSize();
+    if (size > room)
+        size = room;
+    if (size == 0)
+        return 0;
+    size_t tail = (head + getRetainedSize()) % capacity;
+    size_t firstCount = (size > (capacity - tail)) ? (capacity - tail) : size;
+    memcpy(ring.data() + tail, data, firstCount);
+    memcpy(ring.data(), data + firstCount, size - firstCount);
+    endOffset = endOffset + size;
+    return size;
+}
+
+void NuSRetentionBuffer::discard(uint32_t offset) noexcept
+{
+    uint32_t count = offset - startOffset;
+    if (count > 0)
+    {
+        head = (head + count) % ring.size();
+        startOffset = offset;
+    }
+}
+
+bool NuSRetentionBuffer::acknowledge(uint32_t offset) noexcept
+{
+    if ((uint32_t)(offset - startOffset) > (uint32_t)(sentOffset - startOffset))
+        return false;
+    discard(offset);
+    return true;
+}
+
+bool NuSRetentionBuffer::rewind(uint32_t offset) noexcept
+{
+    if ((uint32_t)(offset - startOffset) > (uint32_t)(endOffset - startOffset))
+        return false;
+    discard(offset);
+    sentOffset = offset;
+    return true;
+}
+
+size_t NuSRetentionBuffer::peek(const uint8_t *&data) const noexcept
+{
+    size_t count = getUnsentSize();
+    if (count == 0)
+        return 0;
+    size_t capacity = ring.size();
+    size_t index = (head + (uint32_t)(sentOffset - startOffset)) % capacity;
+    data = ring.data() + index;
+    return (count > (capacity - index)) ? (capacity - index) : count;
+}
+
+void NuSRetentionBuffer::markSent(size_t count) noexcept
+{
+    sentOffset = sentOffset + count;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file NuResume.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Session resumption for the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NURESUME_HPP__
+#define __NURESUME_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Resume request, written by the peer to the resume characteristic
+ *
+ * @note Nine bytes: this code, the session token (4 bytes, little-endian)
+ *       and the count of bytes received in that session
+ *       (4 bytes, little-endian, modulo 2^32).
+ *       A token of zero (or an unknown one) starts a new session.
+ */
+#define NUS_RESUME_HELLO 0x01
+
+/**
+ * @brief Acknowledgement, written by the peer to the resume characteristic
+ *
+ * @note Five bytes: this code and the count of bytes received
+ *       in the current session (4 bytes, little-endian, modulo 2^32).
+ *       Acknowledged bytes are no longer retained.
+ */
+#define NUS_RESUME_ACK 0x02
+
+/**
+ * @brief Session resumption counters
+ *
+ */
+typedef struct
+{
+    /** Count of new sessions */
+    uint32_t newSessions;
+    /** Count of resumed sessions */
+    uint32_t resumedSessions;
+    /** Count of sessions not resumed in time */
+    uint32_t expiredSessions;
+    /** Count of bytes sent again on resumption */
+    uint32_t replayedBytes;
+} NuSResumeStats_t;
+
+/**
+ * @brief Bounded buffer of outgoing bytes, numbered in sequence
+ *
+ * @note Each byte is numbered by its offset in the outgoing stream
+ *       (modulo 2^32). Bytes are retained until acknowledged,
+ *       so they can be sent again.
+ *
+ * @note Not thread-safe.
+ */
+class NuSRetentionBuffer
+{
+public:
+    /**
+     * @brief Set the maximum count of retained bytes
+     *
+     * @note All retained bytes are discarded
+     *
+     * @param capacity Size of the buffer in bytes
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * @brief Get the maximum count of retained bytes
+     *
+     * @return size_t Size of the buffer in bytes
+     */
+    size_t getCapacity() const noexcept { return ring.size(); };
+
+    /**
+     * @brief Discard all retained bytes and start a new sequence
+     *
+     * @param offset Offset of the next byte
+     */
+    void reset(uint32_t offset = 0) noexcept;
+
+    /**
+     * @brief Retain bytes to send
+     *
+     * @param data Pointer to bytes
+     * @param size Count of bytes
+     * @return size_t Count of bytes retained. Less than @p size
+     *                if there is not enough room.
+     */
+    size_t append(const uint8_t *data, size_t size) noexcept;
+
+    /**
+     * @brief Discard bytes received by the peer
+     *
+     * @param offset Offset of the first byte not received
+     * @return true On success
+     * @return false If @p offset is not in the range of sent bytes.
+     *               Nothing is discarded.
+     */
+    bool acknowledge(uint32_t offset) noexcept;
+
+    /**
+     * @brief Send bytes again, starting at a given offset
+     *
+     * @note Bytes before @p offset are acknowledged.
+     *
+     * @param offset Offset of the first byte not received by the peer
+     * @return true On success
+     * @return false If @p offset is not in the range of retained bytes.
+     *               Nothing is changed.
+     */
+    bool rewind(uint32_t offset) noexcept;
+
+    /**
+     * @brief Get a contiguous view of bytes not sent yet
+     *
+     * @param[out] data Pointer to the first byte not sent
+     * @return size_t Count of contiguous bytes not sent
+     */
+    size_t peek(const uint8_t *&data) const noexcept;
+
+    /**
+     * @brief Mark bytes as sent
+     *
+     * @param count Count of bytes, as given by peek() at most
+     */
+    void markSent(size_t count) noexcept;
+
+    /**
+     * @brief Get the offset of the first retained byte
+     *
+     */
+    uint32_t getStartOffset() const noexcept { return startOffset; };
+
+    /**
+     * @brief Get the offset of the first byte not sent
+     *
+     */
+    uint32_t getSentOffset() const noexcept { return sentOffset; };
+
+    /**
+     * @brief Get the offset of the next byte to append
+     *
+     */
+    uint32_t getEndOffset() const noexcept { return endOffset; };
+
+    /**
+     * @brief Get the count of bytes not sent yet
+     *
+     */
+    size_t getUnsentSize() const noexcept { return (uint32_t)(endOffset - sentOffset); };
+
+    /**
+     * @brief Get the count of retained bytes (sent or not)
+     *
+     */
+    size_t getRetainedSize() const noexcept { return (uint32_t)(endOffset - startOffset); };
+
+private:
+    ::std::vector<uint8_t> ring;
+    // Index of the first retained byte in the ring
+    size_t head = 0;
+    uint32_t startOffset = 0;
+    uint32_t sentOffset = 0;
+    uint32_t endOffset = 0;
+
+    void discard(uint32_t offset) noexcept;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include <cstdarg> // for variadric arguments
 #include <chrono>
 #include "NuS.hpp"
+#include "NuTrace.hpp"
 
 //-----------------------------------------------------------------------------
 // Globals
@@ -34,6 +35,11 @@
 
 bool NordicUARTService::allowMultipleInstances = false;
 
+// Reply target of the command being executed by the calling task, if any.
+// See replyTo().
+static thread_local const NordicUARTService *replyService = nullptr;
+static thread_local uint16_t replyConnHandle = BLE_HS_CONN_HANDLE_NONE;
+
 void NordicUARTService::init(bool advertise)
 {
    // Get the server instance or create one
@@ -62,12 +68,60 @@ void NordicUARTService::init(bool advertise)
                pTxCharacteristic->setCallbacks(this); // uses onSubscribe
 
                // Create the receive characteristic
+               uint32_t rxProperties = NIMBLE_PROPERTY::WRITE;
+               if (bWriteWithoutResponse)
+                  rxProperties |= NIMBLE_PROPERTY::WRITE_NR;
                NimBLECharacteristic *pRxCharacteristic =
-                   pNus->createCharacteristic(RX_CHARACTERISTIC_UUID, NIMBLE_PROPERTY::WRITE);
+                   pNus->createCharacteristic(RX_CHARACTERISTIC_UUID, rxProperties);
                if (pRxCharacteristic)
                {
-                  pRxCharacteristic->setCallbacks(this); // uses onWrite
-                  return;
+                  pRxCharacteristic->setCallbacks(&rxCallbacks); // uses onWrite
+                  bool ok = true;
+                  if (l2capPSM != 0)
+                  {
+                     // Create the L2CAP PSM characteristic
+                     NimBLECharacteristic *pPSMCharacteristic =
+                         pNus->createCharacteristic(NORDIC_UART_L2CAP_PSM_UUID, NIMBLE_PROPERTY::READ);
+                     if (pPSMCharacteristic)
+                     {
+                        uint8_t value[2] = {(uint8_t)(l2capPSM & 0xFF), (uint8_t)(l2capPSM >> 8)};
+                        pPSMCharacteristic->setValue(value, 2);
+                     }
+                     else
+                        ok = false;
+                  }
+                  if (ok && !compressionCodecs.empty())
+                  {
+                     // Create the compression characteristic
+                     NimBLECharacteristic *pCompressionCharacteristic =
+                         pNus->createCharacteristic(
+                             NORDIC_UART_COMPRESSION_UUID,
+                             NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
+                     if (pCompressionCharacteristic)
+                     {
+                        pCompressionCharacteristic->setValue(compressionCodecs.data(), compressionCodecs.size());
+                        pCompressionCharacteristic->setCallbacks(&compressionCallbacks);
+                     }
+                     else
+                        ok = false;
+                  }
+                  if (ok && bResumable)
+                  {
+                     // Create the session resumption characteristic
+                     pResumeCharacteristic =
+                         pNus->createCharacteristic(
+                             NORDIC_UART_RESUME_UUID,
+                             NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
+                     if (pResumeCharacteristic)
+                     {
+                        setResumeState(0, 0);
+                        pResumeCharacteristic->setCallbacks(&resumeCallbacks);
+                     }
+                     else
+                        ok = false;
+                  }
+                  if (ok)
+                     return;
                }
             }
          }
@@ -85,7 +139,13 @@ void NordicUARTService::deinit()
    // At this point, the pNus pointer is invalid
    pNus = nullptr;
    pTxCharacteristic = nullptr;
-   _subscriberCount = 0;
+   pResumeCharacteristic = nullptr;
+   {
+      ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+      for (auto &connHandle : subscribers)
+         connHandle = BLE_HS_CONN_HANDLE_NONE;
+      _subscriberCount = 0;
+   }
    if (wasAdvertising)
       pServer->startAdvertising();
 }
@@ -114,6 +174,7 @@ void NordicUARTService::stop()
    {
       disconnect();
       deinit();
+      onStop();
    }
 }
 
@@ -122,6 +183,13 @@ bool NordicUARTService::isStarted()
    return (pNus != nullptr);
 }
 
+bool NordicUARTService::allowWriteWithoutResponse(bool yesOrNo) noexcept
+{
+   bool result = bWriteWithoutResponse;
+   bWriteWithoutResponse = yesOrNo;
+   return result;
+}
+
 //-----------------------------------------------------------------------------
 // Connection
 //-----------------------------------------------------------------------------
@@ -131,6 +199,35 @@ bool NordicUARTService::isConnected()
    return (_subscriberCount > 0);
 }
 
+bool NordicUARTService::isConnected(uint16_t connHandle)
+{
+   if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+      return false;
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (uint16_t subscriber : subscribers)
+      if (subscriber == connHandle)
+         return true;
+   return false;
+}
+
+::std::vector<uint16_t> NordicUARTService::getSubscribers()
+{
+   ::std::vector<uint16_t> result;
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (uint16_t subscriber : subscribers)
+      if (subscriber != BLE_HS_CONN_HANDLE_NONE)
+         result.push_back(subscriber);
+   return result;
+}
+
+uint16_t NordicUARTService::getMTU(uint16_t connHandle)
+{
+   NimBLEServer *pServer = NimBLEDevice::getServer();
+   if (pServer && (connHandle != BLE_HS_CONN_HANDLE_NONE))
+      return pServer->getPeerMTU(connHandle);
+   return 0;
+}
+
 bool NordicUARTService::connect(const unsigned int timeoutMillis)
 {
    if (timeoutMillis == 0)
@@ -155,6 +252,361 @@ void NordicUARTService::disconnect(void)
    }
 }
 
+void NordicUARTService::disconnect(uint16_t connHandle)
+{
+   NimBLEServer *pServer = NimBLEDevice::getServer();
+   if (pServer && (connHandle != BLE_HS_CONN_HANDLE_NONE))
+      pServer->disconnect(connHandle);
+}
+
+bool NordicUARTService::addSubscriber(uint16_t connHandle)
+{
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (uint16_t subscriber : subscribers)
+      if (subscriber == connHandle)
+         // Already subscribed (for example, notifications and indications)
+         return false;
+   for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+      if (subscribers[index] == BLE_HS_CONN_HANDLE_NONE)
+      {
+         subscribers[index] = connHandle;
+         peerStats[index] = {};
+         linkState[index] = {0, 0, 0, linkProfile};
+         _subscriberCount++;
+         return true;
+      }
+   // More subscribers than NUS_MAX_PEERS
+   return false;
+}
+
+bool NordicUARTService::removeSubscriber(uint16_t connHandle)
+{
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (auto &subscriber : subscribers)
+      if (subscriber == connHandle)
+      {
+         subscriber = BLE_HS_CONN_HANDLE_NONE;
+         _subscriberCount--;
+         return true;
+      }
+   return false;
+}
+
+bool NordicUARTService::getPeerStats(uint16_t connHandle, NuSPeerStats_t &stats)
+{
+   if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+      return false;
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+      if (subscribers[index] == connHandle)
+      {
+         stats = peerStats[index];
+         return true;
+      }
+   return false;
+}
+
+bool NordicUARTService::updatePeerStats(uint16_t connHandle, size_t sent, size_t size)
+{
+   // Returns true if the peer should be evicted
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+      if (subscribers[index] == connHandle)
+      {
+         NuSPeerStats_t &stats = peerStats[index];
+         stats.sentBytes += sent;
+         if (sent < size)
+         {
+            stats.droppedBytes += (size - sent);
+            stats.failedNotifications++;
+            stats.lag++;
+         }
+         else
+            stats.lag = 0;
+         return (uMaxBroadcastLag > 0) && (stats.lag >= uMaxBroadcastLag);
+      }
+   return false;
+}
+
+uint32_t NordicUARTService::maxBroadcastLag(uint32_t value)
+{
+   uint32_t result = uMaxBroadcastLag;
+   uMaxBroadcastLag = value;
+   return result;
+}
+
+//-----------------------------------------------------------------------------
+// Link parameters
+//-----------------------------------------------------------------------------
+
+NuSLinkProfile_t NordicUARTService::setLinkProfile(NuSLinkProfile_t profile)
+{
+   NuSLinkProfile_t result = linkProfile;
+   linkProfile = profile;
+   if (profile == NUS_LINK_THROUGHPUT)
+      // Note: the MTU is negotiated by the central device.
+      // 517 bytes is enough for the largest attribute value (512 bytes).
+      NimBLEDevice::setMTU(517);
+   return result;
+}
+
+void NordicUARTService::configureLinkProfile(
+    NuSLinkProfile_t profile,
+    uint16_t minInterval,
+    uint16_t maxInterval,
+    uint16_t latency,
+    uint16_t timeout)
+{
+   if ((profile == NUS_LINK_THROUGHPUT) || (profile == NUS_LINK_LOW_POWER))
+   {
+      linkConfig[profile].minInterval = minInterval;
+      linkConfig[profile].maxInterval = maxInterval;
+      linkConfig[profile].latency = latency;
+      linkConfig[profile].timeout = timeout;
+   }
+}
+
+bool NordicUARTService::requestLinkProfile(uint16_t connHandle, NuSLinkProfile_t profile)
+{
+   NimBLEServer *pServer = NimBLEDevice::getServer();
+   if (!pServer || (connHandle == BLE_HS_CONN_HANDLE_NONE))
+      return false;
+   if ((profile != NUS_LINK_THROUGHPUT) && (profile != NUS_LINK_LOW_POWER))
+      return true;
+
+   bool result = true;
+   uint8_t phyMask = BLE_GAP_LE_PHY_1M_MASK;
+   if (profile == NUS_LINK_THROUGHPUT)
+   {
+      // Data length extension: 251 bytes is the largest link layer payload
+      result = pServer->setDataLen(connHandle, 251) && result;
+      phyMask = BLE_GAP_LE_PHY_2M_MASK;
+   }
+   // Note: the central device may not support the 2M PHY
+   result = pServer->updatePhy(connHandle, phyMask, phyMask, 0) && result;
+   pServer->updateConnParams(
+       connHandle,
+       linkConfig[profile].minInterval,
+       linkConfig[profile].maxInterval,
+       linkConfig[profile].latency,
+       linkConfig[profile].timeout);
+   return result;
+}
+
+bool NordicUARTService::getLinkParams(uint16_t connHandle, NuSLinkParams_t &params)
+{
+   NimBLEServer *pServer = NimBLEDevice::getServer();
+   if (!pServer || !isConnected(connHandle))
+      return false;
+   NimBLEConnInfo connInfo = pServer->getPeerInfoByHandle(connHandle);
+   params.mtu = connInfo.getMTU();
+   params.connInterval = connInfo.getConnInterval();
+   params.connLatency = connInfo.getConnLatency();
+   params.supervisionTimeout = connInfo.getConnTimeout();
+   if (!pServer->getPhy(connHandle, &params.txPhy, &params.rxPhy))
+   {
+      params.txPhy = BLE_GAP_LE_PHY_1M;
+      params.rxPhy = BLE_GAP_LE_PHY_1M;
+   }
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+// Adaptive link controller
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::enableAdaptiveLink(
+    uint32_t burstRate,
+    uint32_t idleRate,
+    uint32_t idleMillis,
+    uint32_t holdMillis)
+{
+   disableAdaptiveLink();
+   {
+      ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+      this->burstRate = burstRate;
+      this->idleRate = idleRate;
+      this->idleMillis = idleMillis;
+      this->holdMillis = holdMillis;
+      linkControlStats = {};
+      for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+      {
+         linkState[index].lastByteCount = peerStats[index].receivedBytes + peerStats[index].sentBytes;
+         linkState[index].idleMillis = 0;
+         linkState[index].holdMillis = 0;
+      }
+   }
+   bAdaptiveLink = true;
+   linkControlThread = ::std::thread(&NordicUARTService::linkControlLoop, this);
+}
+
+void NordicUARTService::disableAdaptiveLink()
+{
+   {
+      ::std::lock_guard<::std::mutex> lock(linkControlMutex);
+      bAdaptiveLink = false;
+   }
+   linkControlCV.notify_all();
+   if (linkControlThread.joinable())
+      linkControlThread.join();
+}
+
+NuSLinkControlStats_t NordicUARTService::getLinkControlStats()
+{
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   return linkControlStats;
+}
+
+void NordicUARTService::onLinkProfileChange(NuSLinkProfileCallback_t callback) noexcept
+{
+   ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+   linkProfileCallback = callback;
+}
+
+void NordicUARTService::linkControlLoop()
+{
+   ::std::unique_lock<::std::mutex> lock(linkControlMutex);
+   while (bAdaptiveLink)
+   {
+      linkControlCV.wait_for(lock, ::std::chrono::milliseconds(LINK_CONTROL_PERIOD_MS));
+      if (bAdaptiveLink)
+      {
+         lock.unlock();
+         updateLinkControl();
+         lock.lock();
+      }
+   }
+}
+
+void NordicUARTService::updateLinkControl()
+{
+   uint16_t connHandle[NUS_MAX_PEERS];
+   NuSLinkProfile_t profile[NUS_MAX_PEERS];
+   size_t switchCount = 0;
+   NuSLinkProfileCallback_t callback;
+   {
+      ::std::lock_guard<::std::mutex> lock(subscribersMutex);
+      callback = linkProfileCallback;
+      for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+      {
+         if (subscribers[index] == BLE_HS_CONN_HANDLE_NONE)
+            continue;
+         auto &state = linkState[index];
+         uint32_t byteCount = peerStats[index].receivedBytes + peerStats[index].sentBytes;
+         uint32_t rate = (byteCount - state.lastByteCount) * 1000 / LINK_CONTROL_PERIOD_MS;
+         state.lastByteCount = byteCount;
+         state.holdMillis += LINK_CONTROL_PERIOD_MS;
+
+         NuSLinkProfile_t target = state.profile;
+         if ((rate >= burstRate) || (peerStats[index].lag > 0))
+         {
+            state.idleMillis = 0;
+            target = NUS_LINK_THROUGHPUT;
+         }
+         else if (rate <= idleRate)
+         {
+            state.idleMillis += LINK_CONTROL_PERIOD_MS;
+            if (state.idleMillis >= idleMillis)
+               target = NUS_LINK_LOW_POWER;
+         }
+         else
+            // Between both thresholds: keep the current profile
+            state.idleMillis = 0;
+
+         if (target == state.profile)
+            continue;
+         if (state.holdMillis < holdMillis)
+         {
+            // Hysteresis: too soon since the last switch
+            linkControlStats.holdCount++;
+            continue;
+         }
+         if (target == NUS_LINK_THROUGHPUT)
+            linkControlStats.speedUpCount++;
+         else
+            linkControlStats.slowDownCount++;
+         state.profile = target;
+         state.holdMillis = 0;
+         connHandle[switchCount] = subscribers[index];
+         profile[switchCount++] = target;
+      }
+   }
+   for (size_t i = 0; i < switchCount; i++)
+   {
+      requestLinkProfile(connHandle[i], profile[i]);
+      if (callback)
+      {
+         try
+         {
+            callback(connHandle[i], profile[i]);
+         }
+         catch (...)
+         {
+         };
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// RX events
+//-----------------------------------------------------------------------------
+
+void NordicUARTService::RxCallbacks::onWrite(
+    NimBLECharacteristic *pCharacteristic,
+    NimBLEConnInfo &connInfo)
+{
+   {
+      ::std::lock_guard<::std::mutex> lock(pOwner->subscribersMutex);
+      for (size_t index = 0; index < NUS_MAX_PEERS; index++)
+         if (pOwner->subscribers[index] == connInfo.getConnHandle())
+         {
+            pOwner->peerStats[index].receivedBytes += pCharacteristic->getLength();
+            break;
+         }
+   }
+   NuSCaptureRecorder *recorder = pOwner->pRecorder;
+   if (recorder)
+   {
+      NimBLEAttValue value = pCharacteristic->getValue();
+      recorder->record(NUS_CAPTURE_WRITE, connInfo.getConnHandle(), value.data(), value.size());
+   }
+   NUS_TRACE_BEGIN_EVENT(NUS_TRACE_RX, ((uint32_t)connInfo.getConnHandle() << 16) | pCharacteristic->getLength());
+   pOwner->onWrite(pCharacteristic, connInfo);
+   NUS_TRACE_END_EVENT(NUS_TRACE_RX, ((uint32_t)connInfo.getConnHandle() << 16) | pCharacteristic->getLength());
+}
+
+void NordicUARTService::CompressionCallbacks::onWrite(
+    NimBLECharacteristic *pCharacteristic,
+    NimBLEConnInfo &connInfo)
+{
+   NimBLEAttValue value = pCharacteristic->getValue();
+   if (value.size() == 1)
+      pOwner->onCompressionRequest(connInfo.getConnHandle(), value.data()[0]);
+   // else: ill-formed request, ignore
+}
+
+void NordicUARTService::ResumeCallbacks::onWrite(
+    NimBLECharacteristic *pCharacteristic,
+    NimBLEConnInfo &connInfo)
+{
+   NimBLEAttValue value = pCharacteristic->getValue();
+   pOwner->onResumeRequest(connInfo.getConnHandle(), value.data(), value.size());
+}
+
+void NordicUARTService::setResumeState(uint32_t token, uint32_t offset)
+{
+   if (pResumeCharacteristic)
+   {
+      uint8_t value[8];
+      for (size_t index = 0; index < 4; index++)
+      {
+         value[index] = (token >> (8 * index)) & 0xFF;
+         value[index + 4] = (offset >> (8 * index)) & 0xFF;
+      }
+      pResumeCharacteristic->setValue(value, sizeof(value));
+   }
+}
+
 //-----------------------------------------------------------------------------
 // TX events
 //-----------------------------------------------------------------------------
@@ -167,21 +619,45 @@ void NordicUARTService::onSubscribe(
    // Note: for robustness, we assume this callback could be called
    // even if no subscription event exists.
 
+   uint16_t connHandle = connInfo.getConnHandle();
+   NuSCaptureRecorder *recorder = pRecorder;
+   if (recorder && (subValue == 0))
+      recorder->record(NUS_CAPTURE_UNSUBSCRIBE, connHandle);
+   else if (recorder && (subValue < 4))
+   {
+      uint16_t mtu = connInfo.getMTU();
+      uint8_t payload[2] = {(uint8_t)(mtu & 0xFF), (uint8_t)(mtu >> 8)};
+      recorder->record(NUS_CAPTURE_SUBSCRIBE, connHandle, payload, sizeof(payload));
+   }
    if (subValue == 0)
    {
       // unsubscribe
-      if (_subscriberCount > 0)
+      if (removeSubscriber(connHandle))
       {
-         _subscriberCount--;
+         NUS_TRACE_INSTANT_EVENT(NUS_TRACE_UNSUBSCRIBE, connHandle);
+         onPeerUnsubscribe(connHandle);
          onUnsubscribe(_subscriberCount);
       }
    }
    else if (subValue < 4)
    {
       // subscribe
-      _subscriberCount++;
-      onSubscribe(_subscriberCount);
-      peerConnected.release();
+      if (addSubscriber(connHandle))
+      {
+         NUS_TRACE_INSTANT_EVENT(NUS_TRACE_SUBSCRIBE, connHandle);
+         if (linkProfile != NUS_LINK_DEFAULT)
+            requestLinkProfile(connHandle, linkProfile);
+         onPeerSubscribe(connHandle);
+         onSubscribe(_subscriberCount);
+         peerConnected.release();
+      }
+      else if (!isConnected(connHandle))
+      {
+         // More subscribers than NUS_MAX_PEERS.
+         // Refuse this one, so it is not left connected but never served.
+         onPeerRejected(connHandle);
+         disconnect(connHandle);
+      }
    }
    // else: Invalid subscription value, ignore
 }
@@ -190,35 +666,99 @@ void NordicUARTService::onSubscribe(
 // Data transmission
 //-----------------------------------------------------------------------------
 
+size_t NordicUARTService::getChunkSize(uint16_t connHandle)
+{
+   // Note: 23 bytes is the minimum ATT MTU.
+   // 3 bytes are taken by the ATT header of each notification.
+   uint16_t mtu = getMTU(connHandle);
+   if (mtu < 23)
+      mtu = 23;
+   return mtu - 3;
+}
+
+void NordicUARTService::replyTo(uint16_t connHandle)
+{
+   replyService = (connHandle != BLE_HS_CONN_HANDLE_NONE) ? this : nullptr;
+   replyConnHandle = connHandle;
+}
+
 size_t NordicUARTService::write(const uint8_t *data, size_t size)
 {
-   if (pTxCharacteristic)
+   // Note: the reply target applies to this service only
+   if (replyService == this)
+      return write(replyConnHandle, data, size);
+   return write(BLE_HS_CONN_HANDLE_NONE, data, size);
+}
+
+size_t NordicUARTService::write(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+   if (!pTxCharacteristic)
+      return 0;
+
+   if (connHandle != BLE_HS_CONN_HANDLE_NONE)
+   {
+      size_t sent = writeToPeer(connHandle, data, size);
+      updatePeerStats(connHandle, sent, size);
+      return sent;
+   }
+
+   // Broadcast:
+   // each subscriber is served separately, so a slow peer
+   // (out of transmission buffers) does not stall the others.
+   size_t result = 0;
+   ::std::vector<uint16_t> evicted;
+   for (uint16_t subscriber : getSubscribers())
    {
-      // Data is sent in chunks of MTU size to avoid data loss
-      // as each chunk is notified separately
-      size_t chunkSize = NimBLEDevice::getMTU();
-      size_t remainingByteCount = size;
-      size_t totalSent = 0;
+      size_t sent = writeToPeer(subscriber, data, size);
+      if (updatePeerStats(subscriber, sent, size))
+         evicted.push_back(subscriber);
+      if (sent > result)
+         result = sent;
+   }
+   for (uint16_t subscriber : evicted)
+      disconnect(subscriber);
+   return result;
+}
+
+size_t NordicUARTService::writeToPeer(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+   // Data is sent in chunks of MTU size to avoid data loss
+   // as each chunk is notified separately
+   size_t chunkSize = getChunkSize(connHandle);
+   size_t remainingByteCount = size;
+   size_t totalSent = 0;
+   NuSCaptureRecorder *recorder = pRecorder;
 
-      while (remainingByteCount >= chunkSize)
+   while (remainingByteCount >= chunkSize)
+   {
+      if (!pTxCharacteristic->notify(data, chunkSize, connHandle))
       {
-         if (!pTxCharacteristic->notify(data, chunkSize))
-         {
-            // Notify failed - return how much we've sent so far
-            return totalSent;
-         }
-         data += chunkSize;
-         remainingByteCount -= chunkSize;
-         totalSent += chunkSize;
+         // Notify failed - return how much we've sent so far
+         NUS_TRACE_INSTANT_EVENT(NUS_TRACE_NOTIFY_FAILED, ((uint32_t)connHandle << 16) | chunkSize);
+         return totalSent;
       }
-      // Note: remainingByteCount < chunkSize at this point
-      if ((remainingByteCount > 0) && pTxCharacteristic->notify(data, remainingByteCount))
+      NUS_TRACE_INSTANT_EVENT(NUS_TRACE_NOTIFY, ((uint32_t)connHandle << 16) | chunkSize);
+      if (recorder)
+         recorder->record(NUS_CAPTURE_NOTIFY, connHandle, data, chunkSize);
+      data += chunkSize;
+      remainingByteCount -= chunkSize;
+      totalSent += chunkSize;
+   }
+   // Note: remainingByteCount < chunkSize at this point
+   if (remainingByteCount > 0)
+   {
+      if (pTxCharacteristic->notify(data, remainingByteCount, connHandle))
+      {
+         NUS_TRACE_INSTANT_EVENT(NUS_TRACE_NOTIFY, ((uint32_t)connHandle << 16) | remainingByteCount);
+         if (recorder)
+            recorder->record(NUS_CAPTURE_NOTIFY, connHandle, data, remainingByteCount);
          totalSent += remainingByteCount;
-
-      return totalSent;
+      }
+      else
+         NUS_TRACE_INSTANT_EVENT(NUS_TRACE_NOTIFY_FAILED, ((uint32_t)connHandle << 16) | remainingByteCount);
    }
-   else
-      return 0;
+
+   return totalSent;
 }
 
 size_t NordicUARTService::send(const char *str, bool includeNullTerminatingChar)
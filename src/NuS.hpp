@@ -17,17 +17,118 @@
 #include <NimBLEService.h>
 #include <NimBLECharacteristic.h>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include "NuSemaphore.hpp"
+#include "NuCapture.hpp"
 
-#if __cplusplus < 202002L
-// NOTE: ::std::binary_semaphore is not available in c++17.
-// This is a workaround
-#include "cyan_semaphore.h"
-typedef ::cyan::binary_semaphore nus_semaphore;
+/**
+ * @brief Maximum number of peers subscribed at the same time
+ *
+ * @note Defaults to the maximum number of connections
+ *       allowed by the NimBLE stack.
+ *       Further peers are disconnected on subscription.
+ *       See NordicUARTService::onPeerRejected().
+ */
+#ifndef NUS_MAX_PEERS
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define NUS_MAX_PEERS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
 #else
-#include <semaphore>
-typedef ::std::binary_semaphore nus_semaphore;
+#define NUS_MAX_PEERS 3
+#endif
 #endif
 
+/**
+ * @brief Transmission counters of a single subscribed peer
+ *
+ */
+typedef struct
+{
+  /** Count of bytes received from the peer */
+  uint32_t receivedBytes;
+  /** Count of bytes notified to the peer */
+  uint32_t sentBytes;
+  /** Count of bytes not notified due to lack of transmission buffers */
+  uint32_t droppedBytes;
+  /** Count of failed notifications */
+  uint32_t failedNotifications;
+  /** Count of consecutive writes in which the peer lagged behind */
+  uint32_t lag;
+} NuSPeerStats_t;
+
+/**
+ * @brief Link parameters to request on peer subscription
+ *
+ */
+typedef enum
+{
+  /** Do not request anything. Keep the choice of the central device. */
+  NUS_LINK_DEFAULT = 0,
+  /** Large MTU, data length extension, 2M PHY and short connection interval */
+  NUS_LINK_THROUGHPUT,
+  /** Long connection interval and peripheral latency */
+  NUS_LINK_LOW_POWER
+} NuSLinkProfile_t;
+
+/**
+ * @brief Link parameters of a peer connection
+ *
+ */
+typedef struct
+{
+  /** ATT MTU in bytes */
+  uint16_t mtu;
+  /** Connection interval in 1.25 ms units */
+  uint16_t connInterval;
+  /** Peripheral latency in connection events */
+  uint16_t connLatency;
+  /** Supervision timeout in 10 ms units */
+  uint16_t supervisionTimeout;
+  /** Transmitter PHY: 1 (1M), 2 (2M) or 3 (coded) */
+  uint8_t txPhy;
+  /** Receiver PHY: 1 (1M), 2 (2M) or 3 (coded) */
+  uint8_t rxPhy;
+} NuSLinkParams_t;
+
+/**
+ * @brief Counters of the adaptive link controller
+ *
+ */
+typedef struct
+{
+  /** Count of switches to the throughput profile */
+  uint32_t speedUpCount;
+  /** Count of switches to the low power profile */
+  uint32_t slowDownCount;
+  /** Count of switches not requested due to hysteresis */
+  uint32_t holdCount;
+} NuSLinkControlStats_t;
+
+/**
+ * @brief Callback to execute when the adaptive link controller
+ *        requests another link profile
+ *
+ * @param[in] connHandle Connection handle of the peer
+ * @param[in] profile Requested link profile
+ */
+typedef ::std::function<void(uint16_t connHandle, NuSLinkProfile_t profile)> NuSLinkProfileCallback_t;
+
+/**
+ * @brief Callback to execute for incoming data
+ *
+ * @param[in] data Pointer to incoming data. Valid only during the call.
+ * @param[in] size Count of incoming bytes
+ * @param[in] connHandle Connection handle of the sender, if known.
+ *                       Otherwise, `BLE_HS_CONN_HANDLE_NONE`.
+ * @return size_t Count of consumed bytes. Bytes not consumed are held
+ *                and the peer gets blocked meanwhile (backpressure).
+ */
+typedef ::std::function<size_t(const uint8_t *data, size_t size, uint16_t connHandle)> NuSDataCallback_t;
+
 /**
  * @brief UUID for the Nordic UART Service
  *
@@ -35,6 +136,36 @@ typedef ::std::binary_semaphore nus_semaphore;
  */
 #define NORDIC_UART_SERVICE_UUID "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
 
+/**
+ * @brief UUID for the (optional) L2CAP PSM characteristic
+ *
+ * @note Not part of the Nordic UART Service specification.
+ *       Readable. Contains the PSM of the L2CAP connection-oriented channel
+ *       (two bytes, little-endian) when such a transport is available.
+ */
+#define NORDIC_UART_L2CAP_PSM_UUID "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"
+
+/**
+ * @brief UUID for the (optional) compression characteristic
+ *
+ * @note Not part of the Nordic UART Service specification.
+ *       Readable: one byte for each supported compression codec.
+ *       Writable: the peer writes a single byte to choose a codec
+ *       (or zero to disable compression) for its own connection.
+ *       Both directions are compressed from then on.
+ */
+#define NORDIC_UART_COMPRESSION_UUID "6E400005-B5A3-F393-E0A9-E50E24DCCA9E"
+
+/**
+ * @brief UUID for the (optional) session resumption characteristic
+ *
+ * @note Not part of the Nordic UART Service specification.
+ *       Writable: see NUS_RESUME_HELLO and NUS_RESUME_ACK.
+ *       Readable: the current session token and the offset of the next
+ *       notification in the outgoing stream (4 bytes each, little-endian).
+ */
+#define NORDIC_UART_RESUME_UUID "6E400006-B5A3-F393-E0A9-E50E24DCCA9E"
+
 /**
  * @brief Nordic UART Service (NuS) implementation using the NimBLE stack
  *
@@ -44,6 +175,8 @@ typedef ::std::binary_semaphore nus_semaphore;
  */
 class NordicUARTService : protected NimBLECharacteristicCallbacks
 {
+  friend class NuSConnectAwaitable;
+
 public:
   /**
    * @brief When true, allow multiple instances of the Nordic UART Service
@@ -66,6 +199,15 @@ public:
    */
   bool isConnected();
 
+  /**
+   * @brief Check if a specific peer is connected and subscribed to this service
+   *
+   * @param connHandle Connection handle of the peer
+   * @return true When @p connHandle is subscribed to the Nordic UART TX characteristic
+   * @return false Otherwise
+   */
+  bool isConnected(uint16_t connHandle);
+
   /**
    * @brief Get the count of clients subscribed
    *
@@ -73,6 +215,23 @@ public:
    */
   size_t subscriberCount() { return _subscriberCount; };
 
+  /**
+   * @brief Get the connection handles of all subscribed peers
+   *
+   * @return ::std::vector<uint16_t> Connection handles
+   */
+  ::std::vector<uint16_t> getSubscribers();
+
+  /**
+   * @brief Get the negotiated ATT MTU of a peer connection
+   *
+   * @note The maximum size of a single notification is the MTU minus 3 bytes.
+   *
+   * @param connHandle Connection handle of the peer
+   * @return uint16_t ATT MTU in bytes or zero if @p connHandle is not connected
+   */
+  uint16_t getMTU(uint16_t connHandle);
+
   /**
    * @brief Wait for a peer connection or a timeout if set (blocking)
    *
@@ -97,14 +256,69 @@ public:
   void disconnect(void);
 
   /**
-   * @brief Send bytes
+   * @brief Terminate a single peer connection
+   *
+   * @param connHandle Connection handle of the peer
+   */
+  void disconnect(uint16_t connHandle);
+
+  /**
+   * @brief Send bytes to all subscribed peers
+   *
+   * @note While a command is being executed by a command processor,
+   *       bytes are sent only to the peer that sent such a command.
    *
    * @param[in] data Pointer to bytes to be sent.
    * @param[in] size Count of bytes to be sent.
-   * @return size_t @p size .
+   * @return size_t Count of bytes sent. See write(uint16_t,const uint8_t*,size_t).
    */
   size_t write(const uint8_t *data, size_t size);
 
+  /**
+   * @brief Send bytes to a single peer or to all subscribed peers
+   *
+   * @note Data is sent in chunks of the peer's MTU size.
+   *
+   * @note When sending to all subscribed peers, each one is served
+   *       separately. A peer running out of transmission buffers
+   *       does not prevent other peers from receiving data.
+   *       Such a peer is said to lag behind. See maxBroadcastLag().
+   *
+   * @param[in] connHandle Connection handle of the peer, or
+   *                       `BLE_HS_CONN_HANDLE_NONE` to send to all subscribed peers.
+   * @param[in] data Pointer to bytes to be sent.
+   * @param[in] size Count of bytes to be sent.
+   * @return size_t Count of bytes sent. When sending to all subscribed peers,
+   *                the largest count of bytes sent to a single peer.
+   */
+  size_t write(uint16_t connHandle, const uint8_t *data, size_t size);
+
+  /**
+   * @brief Set a maximum lag to evict slow subscribers
+   *
+   * @note A peer lags behind when it is not able to receive all the bytes
+   *       sent to all subscribed peers. If a peer lags behind
+   *       in this count of consecutive writes, it will be disconnected,
+   *       so it does not slow down other peers.
+   *
+   * @param value Zero to disable this feature (default).
+   *              Otherwise, a maximum count of consecutive lagged writes.
+   * @return uint32_t previous limit or zero if disabled.
+   */
+  uint32_t maxBroadcastLag(uint32_t value = 0);
+
+  /**
+   * @brief Get the transmission counters of a subscribed peer
+   *
+   * @note Counters are reset on subscription.
+   *
+   * @param[in] connHandle Connection handle of the peer
+   * @param[out] stats Transmission counters
+   * @return true If @p connHandle is subscribed
+   * @return false Otherwise. @p stats is not modified.
+   */
+  bool getPeerStats(uint16_t connHandle, NuSPeerStats_t &stats);
+
   /**
    * @brief Send a null-terminated string (ANSI encoded)
    *
@@ -141,6 +355,146 @@ public:
    */
   size_t printf(const char *format, ...);
 
+  /**
+   * @brief Set the link parameters to request on peer subscription
+   *
+   * @note The central device has the last word, so link parameters
+   *       may not be the requested ones. See getLinkParams().
+   *
+   * @note The throughput profile also sets the preferred ATT MTU
+   *       to the maximum (see `NimBLEDevice::setMTU()`). Since the MTU is
+   *       negotiated on connection, this profile should be set before start().
+   *
+   * @param profile Link profile
+   * @return NuSLinkProfile_t Previous link profile
+   */
+  NuSLinkProfile_t setLinkProfile(NuSLinkProfile_t profile);
+
+  /**
+   * @brief Configure the connection parameters of a link profile
+   *
+   * @note Defaults are 7.5-15 ms (throughput) and 100-200 ms
+   *       with a latency of 4 events (low power).
+   *
+   * @param profile Link profile. NUS_LINK_DEFAULT is ignored.
+   * @param minInterval Minimum connection interval in 1.25 ms units (6 to 3200)
+   * @param maxInterval Maximum connection interval in 1.25 ms units (6 to 3200)
+   * @param latency Peripheral latency in connection events (0 to 499)
+   * @param timeout Supervision timeout in 10 ms units (10 to 3200)
+   */
+  void configureLinkProfile(
+      NuSLinkProfile_t profile,
+      uint16_t minInterval,
+      uint16_t maxInterval,
+      uint16_t latency,
+      uint16_t timeout);
+
+  /**
+   * @brief Request the link parameters of a profile to a single peer
+   *
+   * @note For example, call this method with NUS_LINK_LOW_POWER
+   *       when the link is idle and with NUS_LINK_THROUGHPUT
+   *       before a bulk transfer.
+   *
+   * @param connHandle Connection handle of the peer
+   * @param profile Link profile
+   * @return true If all requests were sent to the central device
+   * @return false Otherwise
+   */
+  bool requestLinkProfile(uint16_t connHandle, NuSLinkProfile_t profile);
+
+  /**
+   * @brief Get the current link parameters of a peer connection
+   *
+   * @note Link parameters are negotiated in the background,
+   *       so they may change shortly after subscription.
+   *
+   * @param[in] connHandle Connection handle of the peer
+   * @param[out] params Link parameters
+   * @return true On success
+   * @return false If @p connHandle is not subscribed
+   */
+  bool getLinkParams(uint16_t connHandle, NuSLinkParams_t &params);
+
+  /**
+   * @brief Switch link profiles automatically depending on traffic load
+   *
+   * @note Traffic load is measured in bytes per second (both directions)
+   *       for each peer. When it reaches @p burstRate or the peer lags behind,
+   *       the throughput profile is requested. When it stays below
+   *       @p idleRate for @p idleMillis, the low power profile is requested.
+   *       A profile is held for @p holdMillis at least,
+   *       to avoid renegotiation storms.
+   *
+   * @note A background thread is used. See configureLinkProfile().
+   *
+   * @param burstRate Traffic load to speed up, in bytes per second.
+   * @param idleRate Traffic load to slow down, in bytes per second.
+   *                 Should be lower than @p burstRate.
+   * @param idleMillis Time to slow down, in milliseconds.
+   * @param holdMillis Minimum time between link profile switches, in milliseconds.
+   */
+  void enableAdaptiveLink(
+      uint32_t burstRate = 2048,
+      uint32_t idleRate = 64,
+      uint32_t idleMillis = 5000,
+      uint32_t holdMillis = 2000);
+
+  /**
+   * @brief Stop switching link profiles automatically
+   *
+   * @note Current link parameters are kept.
+   */
+  void disableAdaptiveLink();
+
+  /**
+   * @brief Get the counters of the adaptive link controller
+   *
+   * @return NuSLinkControlStats_t Counters since the controller was enabled
+   */
+  NuSLinkControlStats_t getLinkControlStats();
+
+  /**
+   * @brief Set a callback for link profile switches
+   *        requested by the adaptive link controller
+   *
+   * @note Called from a background thread.
+   *
+   * @param callback Function to execute
+   */
+  void onLinkProfileChange(NuSLinkProfileCallback_t callback) noexcept;
+
+  /**
+   * @brief Allow write without response in the RX characteristic, or not
+   *
+   * @note When allowed, the peer may send many packets in a single
+   *       connection event, without waiting for a response.
+   *       This increases throughput from the peer, but a receive buffer
+   *       is advisable to absorb bursts of incoming packets
+   *       (see NordicUARTSession::setRxBufferSize()).
+   *
+   * @note Must be called before start(). Not allowed by default.
+   *
+   * @param yesOrNo True to allow, false to disallow.
+   * @return true Previously, allowed.
+   * @return false Previously, not allowed.
+   */
+  bool allowWriteWithoutResponse(bool yesOrNo) noexcept;
+
+  /**
+   * @brief Capture incoming and outgoing traffic
+   *
+   * @note Records every write to the RX characteristic,
+   *       every subscription and unsubscription and every notification
+   *       (after compression, if any). Recording takes place in the
+   *       BLE host task, so the recorder should be fast.
+   *       See NuSCaptureRecorder.
+   *
+   * @param recorder Capture recorder, or null to stop capturing.
+   *                 Must stay valid while set.
+   */
+  void setRecorder(NuSCaptureRecorder *recorder) noexcept { pRecorder = recorder; };
+
   /**
    * @brief Start the Nordic UART Service
    *
@@ -203,19 +557,241 @@ protected:
    */
   virtual void onUnsubscribe(size_t subscriberCount) {};
 
+  /**
+   * @brief Event callback for a single peer subscription to the TX characteristic
+   *
+   * @note Called before onSubscribe(size_t)
+   *
+   * @param connHandle Connection handle of the subscribed peer
+   */
+  virtual void onPeerSubscribe(uint16_t connHandle) {};
+
+  /**
+   * @brief Event callback for a single peer unsubscription to the TX characteristic
+   *
+   * @note Called before onUnsubscribe(size_t)
+   *
+   * @param connHandle Connection handle of the unsubscribed peer
+   */
+  virtual void onPeerUnsubscribe(uint16_t connHandle) {};
+
+  /**
+   * @brief Event callback for a peer refused on subscription
+   *        to the TX characteristic
+   *
+   * @note Called when NUS_MAX_PEERS peers are already subscribed.
+   *       The peer is disconnected afterwards.
+   *
+   * @param connHandle Connection handle of the refused peer
+   */
+  virtual void onPeerRejected(uint16_t connHandle) {};
+
+  /**
+   * @brief Event callback for service stop
+   *
+   * @note Called after the service is removed. See stop().
+   */
+  virtual void onStop() {};
+
+protected:
+  /**
+   * @brief Send data to a single peer by default, in the calling task only
+   *
+   * @note Intended for command processors, so replies
+   *       go to the peer that sent a command.
+   *       write(const uint8_t*,size_t) and related methods,
+   *       when called from the calling task, will send data
+   *       to @p connHandle only, until this method is called again.
+   *       Other tasks still send data to all subscribed peers.
+   *
+   * @param connHandle Connection handle of the peer or
+   *                   `BLE_HS_CONN_HANDLE_NONE` to send to all subscribed peers.
+   */
+  void replyTo(uint16_t connHandle);
+
+  /**
+   * @brief Let peers know that an L2CAP connection-oriented channel is available
+   *
+   * @note Must be called before start().
+   *       See NORDIC_UART_L2CAP_PSM_UUID.
+   *
+   * @param psm PSM of the L2CAP channel, or zero if not available.
+   */
+  void setL2CAPPSM(uint16_t psm) { l2capPSM = psm; };
+
+  /**
+   * @brief Wake a task waiting in connect()
+   *
+   * @note For transports other than the TX characteristic,
+   *       so connect() does not hang when a peer uses them only.
+   */
+  void signalPeerConnected() { peerConnected.release(); };
+
+  /**
+   * @brief Let peers know that compression is available
+   *
+   * @note Must be called before start().
+   *       See NORDIC_UART_COMPRESSION_UUID.
+   *
+   * @param codecs Supported compression codecs, or empty if not available.
+   */
+  void setCompressionCodecs(const ::std::vector<uint8_t> &codecs) { compressionCodecs = codecs; };
+
+  /**
+   * @brief Event callback for a peer choosing a compression codec
+   *
+   * @note Called from the BLE host task. See setCompressionCodecs().
+   *
+   * @param connHandle Connection handle of the peer
+   * @param codec Chosen codec, or zero to disable compression
+   */
+  virtual void onCompressionRequest(uint16_t connHandle, uint8_t codec) {};
+
+  /**
+   * @brief Let peers resume their sessions
+   *
+   * @note Must be called before start().
+   *       See NORDIC_UART_RESUME_UUID.
+   *
+   * @param yesOrNo True to create the resume characteristic, false otherwise.
+   */
+  void setResumable(bool yesOrNo) { bResumable = yesOrNo; };
+
+  /**
+   * @brief Event callback for a write to the resume characteristic
+   *
+   * @note Called from the BLE host task. See setResumable().
+   *
+   * @param connHandle Connection handle of the peer
+   * @param data Written bytes
+   * @param size Count of written bytes
+   */
+  virtual void onResumeRequest(uint16_t connHandle, const uint8_t *data, size_t size) {};
+
+  /**
+   * @brief Set the value of the resume characteristic
+   *
+   * @param token Session token
+   * @param offset Offset of the next notification in the outgoing stream
+   */
+  void setResumeState(uint32_t token, uint32_t offset);
+
+  /**
+   * @brief Send bytes to a single peer in chunks of its MTU size
+   *
+   * @note Override to transform outgoing data.
+   *
+   * @param connHandle Connection handle of the peer
+   * @param data Pointer to bytes to be sent.
+   * @param size Count of bytes to be sent.
+   * @return size_t Count of bytes sent.
+   */
+  virtual size_t writeToPeer(uint16_t connHandle, const uint8_t *data, size_t size);
+
 protected:
-  NordicUARTService() {};
+  NordicUARTService()
+  {
+    for (auto &connHandle : subscribers)
+      connHandle = BLE_HS_CONN_HANDLE_NONE;
+    rxCallbacks.pOwner = this;
+    compressionCallbacks.pOwner = this;
+    resumeCallbacks.pOwner = this;
+  };
   NordicUARTService(const NordicUARTService &) = delete;
   NordicUARTService(NordicUARTService &&) = delete;
   NordicUARTService &operator=(const NordicUARTService &) = delete;
   NordicUARTService &operator=(NordicUARTService &&) = delete;
-  virtual ~NordicUARTService() {};
+  virtual ~NordicUARTService() { disableAdaptiveLink(); };
 
 private:
+  // Forwards incoming data to onWrite(), counting received bytes
+  class RxCallbacks : public NimBLECharacteristicCallbacks
+  {
+  public:
+    NordicUARTService *pOwner = nullptr;
+    void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override;
+  } rxCallbacks;
+
+  // Forwards the choice of a compression codec to onCompressionRequest()
+  class CompressionCallbacks : public NimBLECharacteristicCallbacks
+  {
+  public:
+    NordicUARTService *pOwner = nullptr;
+    void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override;
+  } compressionCallbacks;
+
+  // Forwards resume requests to onResumeRequest()
+  class ResumeCallbacks : public NimBLECharacteristicCallbacks
+  {
+  public:
+    NordicUARTService *pOwner = nullptr;
+    void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override;
+  } resumeCallbacks;
+
   NimBLEService *pNus = nullptr;
   NimBLECharacteristic *pTxCharacteristic = nullptr;
   mutable nus_semaphore peerConnected{0};
-  uint32_t _subscriberCount = 0;
+  // Written under subscribersMutex. Read with no lock by isConnected().
+  ::std::atomic<uint32_t> _subscriberCount{0};
+  // Connection handles of subscribed peers (BLE_HS_CONN_HANDLE_NONE if unused)
+  uint16_t subscribers[NUS_MAX_PEERS];
+  // Transmission counters of subscribed peers (same index as subscribers)
+  NuSPeerStats_t peerStats[NUS_MAX_PEERS];
+  // Adaptive link controller state of subscribed peers (same index as subscribers)
+  struct
+  {
+    uint32_t lastByteCount;
+    uint32_t idleMillis;
+    uint32_t holdMillis;
+    NuSLinkProfile_t profile;
+  } linkState[NUS_MAX_PEERS];
+  ::std::mutex subscribersMutex;
+  uint32_t uMaxBroadcastLag = 0;
+  bool bWriteWithoutResponse = false;
+  uint16_t l2capPSM = 0;
+  ::std::vector<uint8_t> compressionCodecs;
+  bool bResumable = false;
+  NimBLECharacteristic *pResumeCharacteristic = nullptr;
+  ::std::atomic<NuSCaptureRecorder *> pRecorder{nullptr};
+  NuSLinkProfile_t linkProfile = NUS_LINK_DEFAULT;
+  // Connection parameters of each link profile
+  struct
+  {
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency;
+    uint16_t timeout;
+  } linkConfig[3] = {
+      {0, 0, 0, 0},
+      {6, 12, 0, 400},
+      {80, 160, 4, 600}};
+
+  // Adaptive link controller
+  static constexpr uint32_t LINK_CONTROL_PERIOD_MS = 250;
+  bool bAdaptiveLink = false;
+  uint32_t burstRate;
+  uint32_t idleRate;
+  uint32_t idleMillis;
+  uint32_t holdMillis;
+  NuSLinkControlStats_t linkControlStats = {};
+  NuSLinkProfileCallback_t linkProfileCallback;
+  ::std::thread linkControlThread;
+  ::std::mutex linkControlMutex;
+  ::std::condition_variable linkControlCV;
+
+  void linkControlLoop();
+  void updateLinkControl();
+
+  bool addSubscriber(uint16_t connHandle);
+  bool removeSubscriber(uint16_t connHandle);
+  size_t getChunkSize(uint16_t connHandle);
+  bool updatePeerStats(uint16_t connHandle, size_t sent, size_t size);
 
   /**
    * @brief Create the NuS service in a new or existing GATT server
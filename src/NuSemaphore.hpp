@@ -0,0 +1,318 @@
+/**
+ * @file NuSemaphore.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Binary semaphore backends for the Nordic UART Service
+ *
+ * @note Define NUS_SEMAPHORE_BACKEND to one of the
+ *       NUS_SEMAPHORE_* constants below to choose a backend at compile time.
+ *       Otherwise, a native FreeRTOS semaphore is used in ESP32 boards
+ *       and an atomic semaphore is used in other boards.
+ *
+ * @note Timeouts follow nus_clock (see NuClock.hpp).
+ *       A virtual clock requires the atomic backend.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NU_SEMAPHORE_HPP__
+#define __NU_SEMAPHORE_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include "NuClock.hpp"
+
+/** Mutex and condition variable (cyanhill/semaphore) */
+#define NUS_SEMAPHORE_CYAN 1
+/** ::std::binary_semaphore (requires C++20) */
+#define NUS_SEMAPHORE_STD 2
+/** Lock-free fast path, mutex and condition variable when contended */
+#define NUS_SEMAPHORE_ATOMIC 3
+/** Native FreeRTOS binary semaphore (ESP32 only) */
+#define NUS_SEMAPHORE_FREERTOS 4
+
+#ifndef NUS_SEMAPHORE_BACKEND
+#if defined(ESP_PLATFORM) && !defined(NUS_VIRTUAL_CLOCK)
+#define NUS_SEMAPHORE_BACKEND NUS_SEMAPHORE_FREERTOS
+#else
+#define NUS_SEMAPHORE_BACKEND NUS_SEMAPHORE_ATOMIC
+#endif
+#endif
+
+#if defined(NUS_VIRTUAL_CLOCK) && (NUS_SEMAPHORE_BACKEND != NUS_SEMAPHORE_ATOMIC)
+#error NUS_VIRTUAL_CLOCK requires NUS_SEMAPHORE_ATOMIC
+#endif
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_FREERTOS)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#endif
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_CYAN)
+#include "cyan_semaphore.h"
+#endif
+
+/**
+ * @brief Binary semaphore with a lock-free fast path
+ *
+ * @note When uncontended, acquire() and release() are a single
+ *       atomic operation. A mutex and a condition variable are used
+ *       only when a task has to wait.
+ *
+ * @note Releasing an already released semaphore has no effect.
+ */
+class NuSAtomicBinarySemaphore
+{
+public:
+    explicit NuSAtomicBinarySemaphore(::std::ptrdiff_t desired)
+        : counter((desired > 0) ? 1 : 0) {};
+    NuSAtomicBinarySemaphore(const NuSAtomicBinarySemaphore &) = delete;
+    NuSAtomicBinarySemaphore &operator=(const NuSAtomicBinarySemaphore &) = delete;
+
+    void release()
+    {
+        counter.store(1, ::std::memory_order_seq_cst);
+        if (waiting.load(::std::memory_order_seq_cst) > 0)
+        {
+            // Slow path: taking the lock prevents a lost wakeup
+            // between the waiter's check and its wait.
+            // Notify after unlocking to avoid "hurry up and wait".
+            {
+                ::std::lock_guard<::std::mutex> lock{mutex};
+            }
+#if defined(NUS_VIRTUAL_CLOCK)
+            // Note: the condition variable is shared with other semaphores
+            cv.notify_all();
+#else
+            cv.notify_one();
+#endif
+        }
+    }
+
+    bool try_acquire() noexcept
+    {
+        int expected = 1;
+        return counter.compare_exchange_strong(
+            expected,
+            0,
+            ::std::memory_order_acquire,
+            ::std::memory_order_relaxed);
+    }
+
+    void acquire()
+    {
+        if (try_acquire())
+            return;
+        waiting.fetch_add(1, ::std::memory_order_seq_cst);
+        {
+            ::std::unique_lock<::std::mutex> lock{mutex};
+            block(true);
+            cv.wait(lock, [&]()
+                    { return try_acquire(); });
+            block(false);
+        }
+        waiting.fetch_sub(1, ::std::memory_order_relaxed);
+    }
+
+    template <class Rep, class Period>
+    bool try_acquire_for(const ::std::chrono::duration<Rep, Period> &rel_time)
+    {
+        return try_acquire_until(nus_clock::now() + rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_acquire_until(const ::std::chrono::time_point<Clock, Duration> &abs_time)
+    {
+        if (try_acquire())
+            return true;
+        waiting.fetch_add(1, ::std::memory_order_seq_cst);
+        bool result;
+        {
+            ::std::unique_lock<::std::mutex> lock{mutex};
+            block(true);
+            result = cv.wait_until(lock, abs_time, [&]()
+                                   { return try_acquire(); });
+            block(false);
+        }
+        waiting.fetch_sub(1, ::std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    ::std::atomic<int> counter;
+    ::std::atomic<int> waiting{0};
+#if defined(NUS_VIRTUAL_CLOCK)
+    ::std::mutex &mutex{NuSVirtualClock::getMutex()};
+    ::std::condition_variable &cv{NuSVirtualClock::getConditionVariable()};
+
+    static void block(bool yesOrNo) noexcept { NuSVirtualClock::block(yesOrNo); }
+#else
+    ::std::mutex mutex;
+    ::std::condition_variable cv;
+
+    static void block(bool) noexcept {}
+#endif
+};
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_FREERTOS)
+/**
+ * @brief Native FreeRTOS binary semaphore
+ *
+ * @note Statically allocated. No heap is used.
+ *
+ * @note Releasing an already released semaphore has no effect.
+ */
+class NuSFreeRTOSBinarySemaphore
+{
+public:
+    explicit NuSFreeRTOSBinarySemaphore(::std::ptrdiff_t desired)
+    {
+        handle = xSemaphoreCreateBinaryStatic(&buffer);
+        if (desired > 0)
+            xSemaphoreGive(handle);
+    };
+    NuSFreeRTOSBinarySemaphore(const NuSFreeRTOSBinarySemaphore &) = delete;
+    NuSFreeRTOSBinarySemaphore &operator=(const NuSFreeRTOSBinarySemaphore &) = delete;
+    ~NuSFreeRTOSBinarySemaphore() { vSemaphoreDelete(handle); };
+
+    void release() { xSemaphoreGive(handle); }
+
+    bool try_acquire() noexcept { return (xSemaphoreTake(handle, 0) == pdTRUE); }
+
+    void acquire() { xSemaphoreTake(handle, portMAX_DELAY); }
+
+    template <class Rep, class Period>
+    bool try_acquire_for(const ::std::chrono::duration<Rep, Period> &rel_time)
+    {
+        auto millis = ::std::chrono::duration_cast<::std::chrono::milliseconds>(rel_time).count();
+        if (millis <= 0)
+            return try_acquire();
+        TickType_t ticks = pdMS_TO_TICKS(millis);
+        if ((ticks == 0) || (ticks >= portMAX_DELAY))
+            // Round up or avoid waiting forever
+            ticks = (ticks == 0) ? 1 : (portMAX_DELAY - 1);
+        return (xSemaphoreTake(handle, ticks) == pdTRUE);
+    }
+
+    template <class Clock, class Duration>
+    bool try_acquire_until(const ::std::chrono::time_point<Clock, Duration> &abs_time)
+    {
+        return try_acquire_for(abs_time - Clock::now());
+    }
+
+private:
+    StaticSemaphore_t buffer;
+    SemaphoreHandle_t handle;
+};
+#endif
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_CYAN)
+/**
+ * @brief cyanhill/semaphore binary semaphore
+ *
+ * @note cyan_semaphore.h is third-party code and is kept as is.
+ *       This wrapper provides the missing members.
+ *
+ * @note Releasing an already released semaphore has no effect.
+ */
+class NuSCyanBinarySemaphore
+{
+public:
+    explicit NuSCyanBinarySemaphore(::std::ptrdiff_t desired)
+        : semaphore((desired > 0) ? 1 : 0) {};
+    NuSCyanBinarySemaphore(const NuSCyanBinarySemaphore &) = delete;
+    NuSCyanBinarySemaphore &operator=(const NuSCyanBinarySemaphore &) = delete;
+
+    void release() { semaphore.release(); }
+
+    bool try_acquire() noexcept { return semaphore.try_acquire_for(::std::chrono::seconds(0)); }
+
+    void acquire() { semaphore.acquire(); }
+
+    template <class Rep, class Period>
+    bool try_acquire_for(const ::std::chrono::duration<Rep, Period> &rel_time)
+    {
+        return semaphore.try_acquire_for(rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_acquire_until(const ::std::chrono::time_point<Clock, Duration> &abs_time)
+    {
+        return semaphore.try_acquire_for(abs_time - Clock::now());
+    }
+
+private:
+    ::cyan::binary_semaphore semaphore;
+};
+#endif
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_STD)
+#include <semaphore>
+
+/**
+ * @brief ::std::binary_semaphore that saturates
+ *
+ * @note Releasing an already released semaphore has no effect.
+ *       ::std::binary_semaphore::release() would be undefined behavior
+ *       in such a case.
+ */
+class NuSStdBinarySemaphore
+{
+public:
+    explicit NuSStdBinarySemaphore(::std::ptrdiff_t desired)
+        : semaphore((desired > 0) ? 1 : 0) {};
+    NuSStdBinarySemaphore(const NuSStdBinarySemaphore &) = delete;
+    NuSStdBinarySemaphore &operator=(const NuSStdBinarySemaphore &) = delete;
+
+    void release()
+    {
+        // Note: releasing tasks are serialized, so the counter
+        // is never greater than one. Acquiring tasks can only decrease it.
+        ::std::lock_guard<::std::mutex> lock{releaseMutex};
+        semaphore.try_acquire();
+        semaphore.release();
+    }
+
+    bool try_acquire() noexcept { return semaphore.try_acquire(); }
+
+    void acquire() { semaphore.acquire(); }
+
+    template <class Rep, class Period>
+    bool try_acquire_for(const ::std::chrono::duration<Rep, Period> &rel_time)
+    {
+        return semaphore.try_acquire_for(rel_time);
+    }
+
+    template <class Clock, class Duration>
+    bool try_acquire_until(const ::std::chrono::time_point<Clock, Duration> &abs_time)
+    {
+        return semaphore.try_acquire_until(abs_time);
+    }
+
+private:
+    ::std::binary_semaphore semaphore;
+    ::std::mutex releaseMutex;
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// Backend selection
+//-----------------------------------------------------------------------------
+
+#if (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_FREERTOS)
+typedef NuSFreeRTOSBinarySemaphore nus_semaphore;
+#elif (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_ATOMIC)
+typedef NuSAtomicBinarySemaphore nus_semaphore;
+#elif (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_STD)
+typedef NuSStdBinarySemaphore nus_semaphore;
+#elif (NUS_SEMAPHORE_BACKEND == NUS_SEMAPHORE_CYAN)
+typedef NuSCyanBinarySemaphore nus_semaphore;
+#else
+#error Unknown NUS_SEMAPHORE_BACKEND
+#endif
+
+#endif
@@ -27,6 +27,29 @@ void NuShellCommandProcessor::onWrite(
     // Incoming data
     NimBLEAttValue incomingPacket = pCharacteristic->getValue();
 
-    // Parse and execute
+    // Parse and execute.
+    // Responses go to the requesting peer only.
+    replyTo(connInfo.getConnHandle());
     execute((const uint8_t *)incomingPacket.data(), incomingPacket.size());
+    replyTo(BLE_HS_CONN_HANDLE_NONE);
+}
+
+//-----------------------------------------------------------------------------
+// NuCLIParser implementation
+//-----------------------------------------------------------------------------
+
+void NuShellCommandProcessor::onProfileRequest(NuCommandLine_t &commandLine) noexcept
+{
+    // Built-in "perf" and "perf reset" commands
+    if ((commandLine.size() > 1) && (commandLine[1] == "reset"))
+    {
+        resetProfile();
+        return;
+    }
+    print("name,count,average,max,p50,p99\n");
+    for (auto &entry : getProfile())
+    {
+        print(NuSCommandProfiler::format(entry.first, entry.second).c_str());
+        print("\n");
+    }
 }
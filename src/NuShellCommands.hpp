@@ -43,6 +43,7 @@ protected:
     virtual void onWrite(
         NimBLECharacteristic *pCharacteristic,
         NimBLEConnInfo &connInfo) override;
+    virtual void onProfileRequest(NuCommandLine_t &commandLine) noexcept override;
 
 private:
     NuShellCommandProcessor(){};
@@ -9,114 +9,1113 @@
  */
 
 #include "NuStream.hpp"
+#include "NuWaitSet.hpp"
+#include "NuTrace.hpp"
+#include <NimBLEDevice.h>
 #include <chrono>
+#include <cstring> // For memcpy()
 
 //-----------------------------------------------------------------------------
-// GATT server events
+// Session: peer
 //-----------------------------------------------------------------------------
 
-void NordicUARTStream::onUnsubscribe(size_t subscriberCount)
+// Note: a session not bound to a single peer (connHandle is BLE_HS_CONN_HANDLE_NONE)
+// serves all peers if bAllPeers is set. Otherwise, it is not in use.
+
+bool NordicUARTSession::isPeerConnected()
+{
+    if (bAllPeers)
+        return pOwner->isConnected();
+    return pOwner && pOwner->isConnected(getConnHandle());
+}
+
+bool NordicUARTSession::isConnected()
+{
+    if (bAllPeers)
+        return pOwner->isConnected();
+    // Note: unread data from a gone peer is still readable
+    if (isPeerConnected() || (unreadByteCount.load(::std::memory_order_acquire) > 0))
+        return true;
+    // The application is aware of the disconnection,
+    // so this session may be reused for another peer
+    held.store(false, ::std::memory_order_release);
+    return false;
+}
+
+void NordicUARTSession::disconnect()
+{
+    if (bAllPeers)
+        pOwner->disconnect();
+    else if (pOwner)
+        pOwner->disconnect(getConnHandle());
+}
+
+uint16_t NordicUARTSession::getMTU()
+{
+    return (pOwner) ? pOwner->getMTU(getConnHandle()) : 0;
+}
+
+size_t NordicUARTSession::write(const uint8_t *buffer, size_t size)
+{
+    // Note: the session may be bound to another peer meanwhile
+    uint16_t peer = getConnHandle();
+    if (pOwner && (bAllPeers || (peer != BLE_HS_CONN_HANDLE_NONE)))
+        return pOwner->write(peer, buffer, size);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Session: incoming data
+//-----------------------------------------------------------------------------
+
+size_t NordicUARTSession::setRxBufferSize(size_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(rxMutex);
+    size_t result = rxBuffer.size();
+    if (size != result)
+    {
+        rxBuffer.resize(size);
+        rxBuffer.shrink_to_fit();
+        rxHead = 0;
+        unreadByteCount = 0;
+        dataConsumed.release();
+    }
+    return result;
+}
+
+void NordicUARTSession::receive(const NimBLEAttValue &value)
 {
-    if (subscriberCount == 0)
+    // Note: a session must not block the BLE host task,
+    // since other peers would get blocked, too.
+    if (rxBuffer.empty())
     {
-        // Awake task at readBytes()
-        disconnected = true;
+        if (!bDropWhenFull)
+        {
+            // Wait for previous data to get consumed
+            NUS_TRACE_BEGIN_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
+            dataConsumed.acquire();
+            NUS_TRACE_END_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
+        }
+        else if (!dataConsumed.try_acquire())
+        {
+            // Previous data is not consumed yet
+            overrun(value.size());
+            return;
+        }
+
+        // Hold data until next read
+        incomingPacket = value;
+        disconnected.store(false, ::std::memory_order_relaxed);
+        stopped.store(false, ::std::memory_order_relaxed);
+        unreadByteCount.store(incomingPacket.size(), ::std::memory_order_release);
+
+        // signal available data
         dataAvailable.release();
+        notifyWaitSet();
+        return;
+    }
+
+    // Copy incoming data to the receive buffer,
+    // waiting for room if there is not enough (dropping data in sessions)
+    const uint8_t *data = value.data();
+    size_t size = value.size();
+    disconnected.store(false, ::std::memory_order_relaxed);
+    stopped.store(false, ::std::memory_order_relaxed);
+    while (size > 0)
+    {
+        size_t count;
+        {
+            ::std::lock_guard<::std::mutex> lock(rxMutex);
+            size_t capacity = rxBuffer.size();
+            size_t unread = unreadByteCount.load(::std::memory_order_relaxed);
+            count = capacity - unread;
+            if (count > size)
+                count = size;
+            size_t tail = (rxHead + unread) % capacity;
+            size_t firstCount = (count > (capacity - tail)) ? (capacity - tail) : count;
+            memcpy(rxBuffer.data() + tail, data, firstCount);
+            memcpy(rxBuffer.data(), data + firstCount, count - firstCount);
+            unreadByteCount.store(unread + count, ::std::memory_order_release);
+        }
+        data = data + count;
+        size = size - count;
+        if (count > 0)
+        {
+            // signal available data
+            dataAvailable.release();
+            notifyWaitSet();
+        }
+        if ((size > 0) && bDropWhenFull)
+        {
+            overrun(size);
+            break;
+        }
+        if (size > 0)
+        {
+            // Wait for data to get consumed
+            NUS_TRACE_BEGIN_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
+            dataConsumed.acquire();
+            NUS_TRACE_END_EVENT(NUS_TRACE_CONSUME_WAIT, 0);
+        }
     }
+}
+
+void NordicUARTSession::overrun(size_t size)
+{
+    // Note: the peer is not aware of the loss, since its writes were acknowledged.
+    // Disconnect it, so it does not go on with a corrupted stream.
+    droppedByteCount.fetch_add(size, ::std::memory_order_relaxed);
+    disconnect();
+}
+
+void NordicUARTSession::discard()
+{
+    ::std::lock_guard<::std::mutex> lock(rxMutex);
+    if (unreadByteCount.exchange(0, ::std::memory_order_acq_rel) > 0)
+    {
+        rxHead = 0;
+        dataConsumed.release();
+    }
+}
+
+void NordicUARTSession::hangUp()
+{
+    // Awake task at readBytes()
+    disconnected.store(true, ::std::memory_order_release);
+    dataAvailable.release();
+    notifyWaitSet();
+}
+
+void NordicUARTSession::halt()
+{
+    // Awake task at readBytes()
+    stopped.store(true, ::std::memory_order_release);
+    dataAvailable.release();
+    notifyWaitSet();
+}
+
+void NordicUARTSession::notifyWaitSet()
+{
+    notificationCount++;
+    // Note: NuSWaitSet::clear() waits for this count to drop to zero
+    waitSetNotifiers++;
+    NuSWaitSet *pSet = pWaitSet;
+    if (pSet)
+        pSet->notify();
+    waitSetNotifiers--;
+}
+
+size_t NordicUARTSession::view(const uint8_t *&data)
+{
+    // Get a contiguous view of unread data
+    if (rxBuffer.empty())
+    {
+        // Lock-free: incomingPacket does not change until all of it is consumed
+        size_t count = unreadByteCount.load(::std::memory_order_acquire);
+        if (count > 0)
+            data = incomingPacket.data() + incomingPacket.size() - count;
+        return count;
+    }
+    ::std::lock_guard<::std::mutex> lock(rxMutex);
+    size_t capacity = rxBuffer.size();
+    size_t unread = unreadByteCount.load(::std::memory_order_relaxed);
+    data = rxBuffer.data() + rxHead;
+    return (unread > (capacity - rxHead)) ? (capacity - rxHead) : unread;
+}
+
+void NordicUARTSession::skip(size_t count)
+{
+    // Mark unread data as consumed
+    if (rxBuffer.empty())
+    {
+        // Note: discard() may clear unread data meanwhile
+        size_t unread = unreadByteCount.load(::std::memory_order_relaxed);
+        size_t remaining;
+        do
+            remaining = (unread > count) ? (unread - count) : 0;
+        while (!unreadByteCount.compare_exchange_weak(
+            unread,
+            remaining,
+            ::std::memory_order_release,
+            ::std::memory_order_relaxed));
+        // Note: release only when this call consumed the last byte.
+        // Otherwise, receive() could overwrite incomingPacket
+        // while the next one is being read.
+        if ((unread > 0) && (remaining == 0))
+            dataConsumed.release();
+        return;
+    }
+    {
+        ::std::lock_guard<::std::mutex> lock(rxMutex);
+        // Note: discard() may clear unread data meanwhile
+        size_t unread = unreadByteCount.load(::std::memory_order_relaxed);
+        if (count > unread)
+            count = unread;
+        rxHead = (rxHead + count) % rxBuffer.size();
+        unreadByteCount.store(unread - count, ::std::memory_order_release);
+    }
+    if (count > 0)
+        // signal room in the receive buffer
+        dataConsumed.release();
+}
+
+size_t NordicUARTSession::take(uint8_t *buffer, size_t size)
+{
+    // Note: up to two iterations, since the receive buffer is a ring
+    size_t totalCount = 0;
+    do
+    {
+        const uint8_t *data;
+        size_t count = view(data);
+        if (count > (size - totalCount))
+            count = size - totalCount;
+        if (count > 0)
+            memcpy(buffer + totalCount, data, count);
+        skip(count);
+        totalCount = totalCount + count;
+        if (count == 0)
+            break;
+    } while (totalCount < size);
+    return totalCount;
+}
+
+//-----------------------------------------------------------------------------
+// Session: reading with no active wait
+//-----------------------------------------------------------------------------
+
+nus_clock::time_point NordicUARTSession::getDeadline() const
+{
+    if (_timeout == ULONG_MAX)
+        return nus_clock::time_point::max();
+    return nus_clock::now() + ::std::chrono::milliseconds(_timeout);
+}
+
+bool NordicUARTSession::waitForData(nus_clock::time_point deadline)
+{
+    // Note: disconnection and stop are sticky flags, checked before waiting,
+    // so they are not lost when signaled along with incoming data.
+    // A disconnection is reported just once. Otherwise, sketches reading
+    // in a loop would never wait while no peer is connected.
+    while (unreadByteCount.load(::std::memory_order_acquire) == 0)
+    {
+        if (disconnected.exchange(false, ::std::memory_order_acq_rel) || stopped.load(::std::memory_order_acquire))
+            return false;
+        if (deadline == nus_clock::time_point::max())
+            dataAvailable.acquire();
+        else if (!dataAvailable.try_acquire_until(deadline))
+            return (unreadByteCount.load(::std::memory_order_acquire) > 0);
+        // Note: at this point, incoming data was updated thanks to receive()
+    }
+    return true;
+}
+
+size_t NordicUARTSession::readBytes(uint8_t *buffer, size_t size)
+{
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_READ, size);
+    auto deadline = getDeadline();
+    size_t totalReadCount = 0;
+    while (size > 0)
+    {
+        // copy previously available data, if any
+        size_t readBytesCount = take(buffer, size);
+        buffer = buffer + readBytesCount;
+        totalReadCount = totalReadCount + readBytesCount;
+        size = size - readBytesCount;
+        // wait for more data or timeout or disconnection
+        if ((size > 0) && !waitForData(deadline))
+            break;
+    }
+    NUS_TRACE_END_EVENT(NUS_TRACE_READ, totalReadCount);
+    return totalReadCount;
+}
+
+size_t NordicUARTSession::readSome(uint8_t *buffer, size_t size)
+{
+    NUS_TRACE_BEGIN_EVENT(NUS_TRACE_READ, size);
+    size_t result = 0;
+    if ((size > 0) && waitForData(getDeadline()))
+        result = take(buffer, size);
+    NUS_TRACE_END_EVENT(NUS_TRACE_READ, result);
+    return result;
+}
+
+size_t NordicUARTSession::takeUntil(
+    char terminator,
+    uint8_t *buffer,
+    size_t size,
+    nus_clock::time_point deadline,
+    bool &terminated)
+{
+    size_t totalReadCount = 0;
+    terminated = false;
+    while (totalReadCount < size)
+    {
+        // search for the terminator in previously available data, if any
+        const uint8_t *data;
+        size_t count = view(data);
+        if (count > 0)
+        {
+            if (count > (size - totalReadCount))
+                count = size - totalReadCount;
+            const uint8_t *found = (const uint8_t *)memchr(data, terminator, count);
+            if (found)
+                count = found - data;
+            memcpy(buffer + totalReadCount, data, count);
+            totalReadCount = totalReadCount + count;
+            if (found)
+            {
+                // the terminator is consumed, too
+                skip(count + 1);
+                terminated = true;
+                break;
+            }
+            skip(count);
+            continue;
+        }
+
+        // wait for more data or timeout or disconnection
+        if (!waitForData(deadline))
+            break;
+    }
+    return totalReadCount;
+}
+
+size_t NordicUARTSession::readBytesUntil(char terminator, uint8_t *buffer, size_t size)
+{
+    bool terminated;
+    return takeUntil(terminator, buffer, size, getDeadline(), terminated);
+}
+
+String NordicUARTSession::readStringUntil(char terminator)
+{
+    String result;
+    uint8_t chunk[64];
+    bool terminated;
+    auto deadline = getDeadline();
+    do
+    {
+        size_t count = takeUntil(terminator, chunk, sizeof(chunk), deadline, terminated);
+        result.concat((const char *)chunk, count);
+        if (count < sizeof(chunk))
+            break;
+    } while (!terminated);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Session: Stream implementation
+//-----------------------------------------------------------------------------
+
+int NordicUARTSession::available()
+{
+    return unreadByteCount.load(::std::memory_order_acquire);
+}
+
+int NordicUARTSession::peek()
+{
+    const uint8_t *data;
+    if (view(data) > 0)
+        return data[0];
+    return -1;
+}
+
+int NordicUARTSession::read()
+{
+    uint8_t result;
+    if (take(&result, 1) > 0)
+        return result;
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+// Stream: initialization
+//-----------------------------------------------------------------------------
+
+NordicUARTStream::NordicUARTStream() : NordicUARTService(), NordicUARTSession()
+{
+    pOwner = this;
+    bAllPeers = true;
+    for (auto &session : sessions)
+    {
+        session.pOwner = this;
+        session.bDropWhenFull = true;
+    }
+#ifdef NUS_L2CAP_AVAILABLE
+    l2capCallbacks.pOwner = this;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Stream: GATT server events
+//-----------------------------------------------------------------------------
+
+void NordicUARTStream::onSubscribe(
+    NimBLECharacteristic *pCharacteristic,
+    NimBLEConnInfo &connInfo,
+    uint16_t subValue)
+{
+    NordicUARTService::onSubscribe(pCharacteristic, connInfo, subValue);
+    // Note: onPeerSubscribe() is called before connect() is able to return.
+    // Notify again, so coroutines at NuSAsync::connect() do not miss it.
+    notifyWaitSet();
+}
+
+void NordicUARTStream::onUnsubscribe(size_t subscriberCount)
+{
+    if ((subscriberCount == 0) && !l2capConnected)
+        hangUp();
 };
 
+void NordicUARTStream::onPeerSubscribe(uint16_t connHandle)
+{
+    if (bUseSessions)
+    {
+        bool found = false;
+        {
+            ::std::lock_guard<::std::mutex> lock(sessionsMutex);
+            // Note: a session held by the application is not reused,
+            // so it never gets data from another peer
+            for (auto &session : sessions)
+                if ((session.connHandle == BLE_HS_CONN_HANDLE_NONE) &&
+                    !session.held.load(::std::memory_order_acquire))
+                {
+                    // Discard unread data from a previous peer, if any
+                    session.discard();
+                    session.droppedByteCount = 0;
+                    session.connHandle = connHandle;
+                    session.accepted = false;
+                    session.disconnected = false;
+                    session.stopped = false;
+                    found = true;
+                    break;
+                }
+        }
+        if (found)
+            sessionStarted.release();
+    }
+    else
+    {
+        // Forget about a previous disconnection
+        disconnected = false;
+        stopped = false;
+    }
+    // The stream (or a session) is writable now
+    notifyWaitSet();
+    for (auto &session : sessions)
+        session.notifyWaitSet();
+}
+
+void NordicUARTStream::onStop()
+{
+    halt();
+    for (auto &session : sessions)
+        session.halt();
+    for (auto &peer : compression)
+        releaseCompression(peer.connHandle);
+    ::std::lock_guard<::std::mutex> lock(resumeMutex);
+    resumeToken = 0;
+    resumeConnHandle = BLE_HS_CONN_HANDLE_NONE;
+    retention.reset();
+}
+
+void NordicUARTStream::onPeerUnsubscribe(uint16_t connHandle)
+{
+    releaseCompression(connHandle);
+    {
+        ::std::lock_guard<::std::mutex> lock(resumeMutex);
+        if (connHandle == resumeConnHandle)
+        {
+            // Keep the session for a while
+            resumeConnHandle = BLE_HS_CONN_HANDLE_NONE;
+            detachTime = nus_clock::now();
+        }
+    }
+    NordicUARTSession *session = nullptr;
+    {
+        ::std::lock_guard<::std::mutex> lock(sessionsMutex);
+        for (auto &candidate : sessions)
+            if (candidate.connHandle == connHandle)
+            {
+                candidate.connHandle = BLE_HS_CONN_HANDLE_NONE;
+                session = &candidate;
+                break;
+            }
+    }
+    if (session)
+        session->hangUp();
+}
+
 //-----------------------------------------------------------------------------
-// NordicUARTService implementation
+// Stream: NordicUARTService implementation
 //-----------------------------------------------------------------------------
 
 void NordicUARTStream::onWrite(
     NimBLECharacteristic *pCharacteristic,
     NimBLEConnInfo &connInfo)
 {
-    // Wait for previous data to get consumed
-    dataConsumed.acquire();
+    uint16_t connHandle = connInfo.getConnHandle();
+    NordicUARTSession *session = this;
+    if (bUseSessions)
+    {
+        session = getSession(connHandle);
+        if (!session)
+            // The peer is not subscribed, so it can not get an answer. Ignore.
+            return;
+    }
 
-    // Hold data until next read
-    incomingPacket = pCharacteristic->getValue();
-    unreadByteCount = incomingPacket.size();
-    disconnected = false;
+    int index = getCompressionIndex(connHandle);
+    if (index < 0)
+    {
+        deliver(*session, connHandle, pCharacteristic->getValue());
+        return;
+    }
 
-    // signal available data
-    dataAvailable.release();
+    // Decompress.
+    // Note: the decompressor is used by the BLE host task only,
+    // so there is no need for a lock.
+    NimBLEAttValue value = pCharacteristic->getValue();
+    const uint8_t *data = value.data();
+    size_t size = value.size();
+    auto &peer = compression[index];
+    size_t totalCount = 0;
+    size_t count;
+    do
+    {
+        count = peer.decompressor.decompress(data, size, peer.rxBuffer.data(), peer.rxBuffer.size());
+        if (count > 0)
+            deliver(*session, connHandle, NimBLEAttValue(peer.rxBuffer.data(), count));
+        totalCount = totalCount + count;
+    } while (count == peer.rxBuffer.size());
+
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    compressionStats.rxCompressedBytes += value.size();
+    compressionStats.rxBytes += totalCount;
 }
 
 //-----------------------------------------------------------------------------
-// Reading with no active wait
+// Stream: data callback
 //-----------------------------------------------------------------------------
 
-size_t NordicUARTStream::readBytes(uint8_t *buffer, size_t size)
+void NordicUARTStream::onData(NuSDataCallback_t callback, bool useDispatcher)
 {
-    size_t totalReadCount = 0;
-    while (size > 0)
+    // Stop the dispatcher thread, if any
+    bDispatch = false;
+    if (dispatcherThread.joinable())
     {
-        // copy previously available data, if any
-        if (unreadByteCount > 0)
-        {
-            const uint8_t *incomingData = incomingPacket.data() + incomingPacket.size() - unreadByteCount;
-            size_t readBytesCount = (unreadByteCount > size) ? size : unreadByteCount;
-            memcpy(buffer, incomingData, readBytesCount);
-            buffer = buffer + readBytesCount;
-            unreadByteCount = unreadByteCount - readBytesCount;
-            totalReadCount = totalReadCount + readBytesCount;
-            size = size - readBytesCount;
-        } // note: at this point (unreadByteCount == 0) || (size == 0)
-        if (unreadByteCount == 0)
+        // Awake the dispatcher thread.
+        // Note: readers ignore this signal if there is no data.
+        dataAvailable.release();
+        dispatcherThread.join();
+    }
+
+    dataCallback = callback;
+    if (callback && useDispatcher)
+    {
+        bDispatch = true;
+        dispatcherThread = ::std::thread(&NordicUARTStream::dispatchLoop, this);
+    }
+}
+
+void NordicUARTStream::deliver(
+    NordicUARTSession &session,
+    uint16_t connHandle,
+    const NimBLEAttValue &value)
+{
+    // Note: held data must be read first to keep the order of incoming data
+    if (dataCallback && (!bDispatch || (&session != this)) && (session.available() == 0))
+    {
+        size_t consumed = 0;
+        try
         {
-            dataConsumed.release();
-            // xSemaphoreGive(dataConsumed);
+            consumed = dataCallback(value.data(), value.size(), connHandle);
         }
-        if (size > 0)
+        catch (...)
+        {
+        };
+        if (consumed >= value.size())
+            return;
+        // Hold bytes not consumed
+        NimBLEAttValue remainder(value.data() + consumed, value.size() - consumed);
+        session.receive(remainder);
+    }
+    else
+        session.receive(value);
+}
+
+void NordicUARTStream::resumeData()
+{
+    if (bDispatch)
+        dataAvailable.release();
+}
+
+void NordicUARTStream::dispatchLoop()
+{
+    while (bDispatch)
+    {
+        const uint8_t *data;
+        size_t size = view(data);
+        if (size == 0)
         {
-            // wait for more data or timeout or disconnection
-            bool waitResult = true;
-            if (_timeout == ULONG_MAX)
-                dataAvailable.acquire();
-            else
-                waitResult = dataAvailable.try_acquire_for(::std::chrono::milliseconds(_timeout));
-            if (!waitResult || disconnected)
-                size = 0; // break;
-            // Note: at this point, readBuffer and unreadByteCount were updated thanks to onWrite()
+            // Wait for incoming data, disconnection, stop or onData()
+            dataAvailable.acquire();
+            continue;
         }
+        size_t consumed = 0;
+        try
+        {
+            consumed = dataCallback(data, size, BLE_HS_CONN_HANDLE_NONE);
+        }
+        catch (...)
+        {
+        };
+        if (consumed > size)
+            consumed = size;
+        skip(consumed);
+        if (consumed < size)
+            // Deliver again as soon as more data arrives or at resumeData().
+            // Note: the peer may be blocked, so more data may never arrive.
+            dataAvailable.acquire();
     }
-    return totalReadCount;
 }
 
 //-----------------------------------------------------------------------------
-// Stream implementation
+// Stream: L2CAP transport
+//-----------------------------------------------------------------------------
+
+bool NordicUARTStream::useL2CAP(uint16_t psm, uint16_t mtu)
+{
+#ifdef NUS_L2CAP_AVAILABLE
+    if (!pL2CAPChannel)
+    {
+        NimBLEL2CAPServer *pServer = NimBLEDevice::createL2CAPServer();
+        if (pServer)
+            pL2CAPChannel = pServer->createService(psm, mtu, &l2capCallbacks);
+        if (pL2CAPChannel)
+            setL2CAPPSM(psm);
+    }
+    return (pL2CAPChannel != nullptr);
+#else
+    (void)psm;
+    (void)mtu;
+    return false;
+#endif
+}
+
+#ifdef NUS_L2CAP_AVAILABLE
+void NordicUARTStream::L2CAPCallbacks::onConnect(NimBLEL2CAPChannel *channel, uint16_t negotiatedMTU)
+{
+    pOwner->l2capConnected = true;
+    pOwner->signalPeerConnected();
+    pOwner->notifyWaitSet();
+}
+
+void NordicUARTStream::L2CAPCallbacks::onRead(NimBLEL2CAPChannel *channel, ::std::vector<uint8_t> &data)
+{
+    // Note: SDUs are already reassembled by the NimBLE stack.
+    // Credits are given back to the peer when this method returns,
+    // so the peer gets blocked while data is not consumed.
+    NimBLEAttValue value(data.data(), data.size());
+    pOwner->deliver(*pOwner, channel->getConnHandle(), value);
+}
+
+void NordicUARTStream::L2CAPCallbacks::onDisconnect(NimBLEL2CAPChannel *channel)
+{
+    pOwner->l2capConnected = false;
+    if (!pOwner->NordicUARTService::isConnected())
+        pOwner->hangUp();
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Stream: compression
 //-----------------------------------------------------------------------------
 
-int NordicUARTStream::available()
+bool NordicUARTStream::useCompression(bool yesOrNo)
 {
-    return unreadByteCount;
+    bool result = bUseCompression;
+    bUseCompression = yesOrNo;
+    if (yesOrNo)
+        setCompressionCodecs({NUS_COMPRESSION_LZ});
+    else
+        setCompressionCodecs({});
+    return result;
 }
 
-int NordicUARTStream::peek()
+int NordicUARTStream::getCompressionIndex(uint16_t connHandle)
 {
-    if (unreadByteCount > 0)
+    if (!bUseCompression || (connHandle == BLE_HS_CONN_HANDLE_NONE))
+        return -1;
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    for (int index = 0; index < NUS_MAX_PEERS; index++)
+        if (compression[index].connHandle == connHandle)
+            return index;
+    return -1;
+}
+
+bool NordicUARTStream::isCompressed(uint16_t connHandle)
+{
+    return (getCompressionIndex(connHandle) >= 0);
+}
+
+void NordicUARTStream::onCompressionRequest(uint16_t connHandle, uint8_t codec)
+{
+    if (!bUseCompression)
+        return;
+    if (codec != NUS_COMPRESSION_LZ)
     {
-        const uint8_t *readBuffer = incomingPacket.data();
-        size_t index = incomingPacket.size() - unreadByteCount;
-        return readBuffer[index];
+        // Disable compression (unknown codecs, too)
+        releaseCompression(connHandle);
+        return;
     }
-    return -1;
+
+    // Note: lock order is compressionMutex, then txMutex
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    int freeIndex = -1;
+    for (int index = 0; index < NUS_MAX_PEERS; index++)
+    {
+        if (compression[index].connHandle == connHandle)
+        {
+            freeIndex = index;
+            break;
+        }
+        if ((freeIndex < 0) && (compression[index].connHandle == BLE_HS_CONN_HANDLE_NONE))
+            freeIndex = index;
+    }
+    if (freeIndex < 0)
+        // More peers than NUS_MAX_PEERS
+        return;
+
+    // Start from scratch
+    auto &peer = compression[freeIndex];
+    ::std::lock_guard<::std::mutex> txLock(peer.txMutex);
+    peer.compressor.reset();
+    peer.decompressor.reset();
+    peer.txPendingSize = 0;
+    peer.rxBuffer.resize(NUS_COMPRESSION_WINDOW / 2);
+    peer.connHandle = connHandle;
 }
 
-int NordicUARTStream::read()
+void NordicUARTStream::releaseCompression(uint16_t connHandle)
 {
-    if (unreadByteCount > 0)
+    if (connHandle == BLE_HS_CONN_HANDLE_NONE)
+        return;
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    for (auto &peer : compression)
+        if (peer.connHandle == connHandle)
+        {
+            // Note: memory is kept for the next peer
+            ::std::lock_guard<::std::mutex> txLock(peer.txMutex);
+            peer.connHandle = BLE_HS_CONN_HANDLE_NONE;
+            peer.txPendingSize = 0;
+        }
+}
+
+size_t NordicUARTStream::writeToPeer(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    int index = getCompressionIndex(connHandle);
+    if (index < 0)
+        return NordicUARTService::writeToPeer(connHandle, data, size);
+
+    auto &peer = compression[index];
+    size_t sent = 0;
+    bool compressed = false;
     {
-        const uint8_t *readBuffer = incomingPacket.data();
-        size_t index = incomingPacket.size() - unreadByteCount;
-        int result = readBuffer[index];
-        unreadByteCount--;
-        if (unreadByteCount == 0)
-            dataConsumed.release();
-        return result;
+        // Note: compressed data must be sent in the same order as compressed
+        ::std::lock_guard<::std::mutex> txLock(peer.txMutex);
+        if (peer.connHandle != connHandle)
+            // Released in the meantime
+            return NordicUARTService::writeToPeer(connHandle, data, size);
+        while (true)
+        {
+            // Compressed bytes not sent last time go first,
+            // since the history of the compressor already includes them
+            if (peer.txPendingSize > 0)
+            {
+                size_t count = NordicUARTService::writeToPeer(
+                    connHandle,
+                    peer.txBuffer.data() + peer.txPendingOffset,
+                    peer.txPendingSize);
+                peer.txPendingOffset = peer.txPendingOffset + count;
+                peer.txPendingSize = peer.txPendingSize - count;
+                sent = sent + count;
+                if (peer.txPendingSize > 0)
+                    // Out of transmission buffers. The rest goes first next time.
+                    break;
+            }
+            if (compressed)
+                break;
+            size_t capacity = NuSCompressor::getMaxCompressedSize(size);
+            if (peer.txBuffer.size() < capacity)
+                peer.txBuffer.resize(capacity);
+            peer.txPendingSize = peer.compressor.compress(data, size, peer.txBuffer.data());
+            peer.txPendingOffset = 0;
+            compressed = true;
+        }
     }
-    return -1;
-}
\ No newline at end of file
+
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    if (compressed)
+        compressionStats.txBytes += size;
+    compressionStats.txCompressedBytes += sent;
+    // Note: once compressed, all bytes are accepted, even if not sent yet.
+    // Otherwise, they would be compressed again.
+    return compressed ? size : 0;
+}
+
+NuSCompressionStats_t NordicUARTStream::getCompressionStats()
+{
+    ::std::lock_guard<::std::mutex> lock(compressionMutex);
+    NuSCompressionStats_t result = compressionStats;
+    result.txRatio = (result.txCompressedBytes > 0) ? ((float)result.txBytes / result.txCompressedBytes) : 0.0f;
+    result.rxRatio = (result.rxCompressedBytes > 0) ? ((float)result.rxBytes / result.rxCompressedBytes) : 0.0f;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Stream: session resumption
+//-----------------------------------------------------------------------------
+
+static uint32_t getLittleEndian32(const uint8_t *data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void NordicUARTStream::useResumption(size_t retentionSize, uint32_t timeoutMillis)
+{
+    // Stop the retry thread, if any
+    bRetry = false;
+    if (retryThread.joinable())
+    {
+        retryWanted.release();
+        retryThread.join();
+    }
+
+    {
+        ::std::lock_guard<::std::mutex> lock(resumeMutex);
+        retention.setCapacity(retentionSize);
+        resumeTimeout = timeoutMillis;
+        resumeToken = 0;
+        retryScheduled = false;
+        setResumable(retentionSize > 0);
+    }
+    if (retentionSize > 0)
+    {
+        bRetry = true;
+        retryThread = ::std::thread(&NordicUARTStream::retryLoop, this);
+    }
+}
+
+NuSResumeStats_t NordicUARTStream::getResumeStats()
+{
+    ::std::lock_guard<::std::mutex> lock(resumeMutex);
+    return resumeStats;
+}
+
+void NordicUARTStream::expireSession(bool force)
+{
+    // Note: resumeMutex is locked by the caller
+    if ((resumeToken != 0) &&
+        (resumeConnHandle == BLE_HS_CONN_HANDLE_NONE) &&
+        (force || ((nus_clock::now() - detachTime) > ::std::chrono::milliseconds(resumeTimeout))))
+    {
+        resumeToken = 0;
+        retention.reset();
+        resumeStats.expiredSessions++;
+        setResumeState(0, 0);
+    }
+}
+
+void NordicUARTStream::flushRetention()
+{
+    // Note: resumeMutex is locked by the caller
+    if (resumeConnHandle == BLE_HS_CONN_HANDLE_NONE)
+        return;
+    const uint8_t *data;
+    size_t count;
+    while ((count = retention.peek(data)) > 0)
+    {
+        size_t sent = NordicUARTService::write(resumeConnHandle, data, count);
+        retention.markSent(sent);
+        if (sent < count)
+        {
+            // Out of transmission buffers. Try again a few milliseconds later.
+            if (!retryScheduled)
+            {
+                retryScheduled = true;
+                retryWanted.release();
+            }
+            break;
+        }
+    }
+}
+
+void NordicUARTStream::retryLoop()
+{
+    while (bRetry)
+    {
+        // Wait for unsent bytes, then give the peer some time
+        // to free transmission buffers.
+        // Note: the timeout takes place in real time, even with a virtual clock.
+        retryWanted.acquire();
+        if (bRetry)
+            retryWanted.try_acquire_until(::std::chrono::steady_clock::now() + ::std::chrono::milliseconds(10));
+        ::std::lock_guard<::std::mutex> lock(resumeMutex);
+        retryScheduled = false;
+        flushRetention();
+    }
+}
+
+void NordicUARTStream::onResumeRequest(uint16_t connHandle, const uint8_t *data, size_t size)
+{
+    if ((retention.getCapacity() == 0) || (size == 0))
+        return;
+    ::std::lock_guard<::std::mutex> lock(resumeMutex);
+    expireSession();
+    if ((data[0] == NUS_RESUME_HELLO) && (size == 9))
+    {
+        uint32_t token = getLittleEndian32(data + 1);
+        uint32_t offset = getLittleEndian32(data + 5);
+        uint32_t sentOffset = retention.getSentOffset();
+        if ((token != 0) && (token == resumeToken) && retention.rewind(offset))
+        {
+            resumeStats.resumedSessions++;
+            resumeStats.replayedBytes += (uint32_t)(sentOffset - offset);
+        }
+        else
+        {
+            // Start a new session.
+            // Note: tokens tell sessions apart. They are not meant for security.
+            uint32_t seed = (uint32_t)::std::chrono::steady_clock::now().time_since_epoch().count();
+            resumeToken = ((seed ^ (resumeToken * 2654435761u)) & 0x7FFFFFFF) | 1;
+            retention.reset();
+            resumeStats.newSessions++;
+        }
+        resumeConnHandle = connHandle;
+        setResumeState(resumeToken, retention.getSentOffset());
+        flushRetention();
+    }
+    else if ((data[0] == NUS_RESUME_ACK) && (size == 5) && (connHandle == resumeConnHandle))
+    {
+        retention.acknowledge(getLittleEndian32(data + 1));
+        flushRetention();
+    }
+    // else: ill-formed request, ignore
+}
+
+//-----------------------------------------------------------------------------
+// Stream: transport
+//-----------------------------------------------------------------------------
+
+bool NordicUARTStream::isConnected()
+{
+    return l2capConnected || NordicUARTService::isConnected();
+}
+
+size_t NordicUARTStream::write(const uint8_t *buffer, size_t size)
+{
+#ifdef NUS_L2CAP_AVAILABLE
+    if (l2capConnected && pL2CAPChannel)
+    {
+        // Note: SDU segmentation is done by the NimBLE stack
+        ::std::vector<uint8_t> sdu(buffer, buffer + size);
+        return pL2CAPChannel->write(sdu) ? size : 0;
+    }
+#endif
+    if (retention.getCapacity() > 0)
+    {
+        ::std::unique_lock<::std::mutex> lock(resumeMutex);
+        expireSession();
+        size_t count = 0;
+        if (resumeToken != 0)
+        {
+            // Bytes are sent to the resuming peer from the retention buffer,
+            // so they can be sent again
+            count = retention.append(buffer, size);
+            if (count < size)
+                // Out of room. If the peer is away, give up its session,
+                // so it does not stall other peers.
+                expireSession(true);
+        }
+        if (resumeToken != 0)
+        {
+            flushRetention();
+            uint16_t resumingPeer = resumeConnHandle;
+            lock.unlock();
+            // Other peers are served as usual, even while the resuming peer is away
+            if (count > 0)
+                for (uint16_t subscriber : getSubscribers())
+                    if (subscriber != resumingPeer)
+                        NordicUARTService::write(subscriber, buffer, count);
+            return count;
+        }
+    }
+    return NordicUARTService::write(buffer, size);
+}
+
+//-----------------------------------------------------------------------------
+// Stream: sessions
+//-----------------------------------------------------------------------------
+
+bool NordicUARTStream::useSessions(bool yesOrNo)
+{
+    bool result = bUseSessions;
+    bUseSessions = yesOrNo;
+    if (yesOrNo)
+        // Sessions never block the peer, so they need a queue
+        for (auto &session : sessions)
+            if (session.rxBuffer.empty())
+                session.setRxBufferSize(sessionRxBufferSize);
+    return result;
+}
+
+NordicUARTSession *NordicUARTStream::getSession(uint16_t connHandle)
+{
+    if (bUseSessions && (connHandle != BLE_HS_CONN_HANDLE_NONE))
+    {
+        ::std::lock_guard<::std::mutex> lock(sessionsMutex);
+        for (auto &session : sessions)
+            if (session.connHandle == connHandle)
+                return &session;
+    }
+    return nullptr;
+}
+
+size_t NordicUARTStream::setRxBufferSize(size_t size)
+{
+    for (auto &session : sessions)
+        session.setRxBufferSize(((size == 0) && bUseSessions) ? sessionRxBufferSize : size);
+    return NordicUARTSession::setRxBufferSize(size);
+}
+
+size_t NordicUARTStream::setSessionRxBufferSize(size_t size)
+{
+    size_t result = sessionRxBufferSize;
+    sessionRxBufferSize = (size == 0) ? NUS_SESSION_RX_BUFFER_SIZE : size;
+    if (bUseSessions)
+        for (auto &session : sessions)
+            session.setRxBufferSize(sessionRxBufferSize);
+    return result;
+}
+
+NordicUARTSession *NordicUARTStream::acceptSession(const unsigned int timeoutMillis)
+{
+    auto deadline = nus_clock::now() + ::std::chrono::milliseconds(timeoutMillis);
+    while (bUseSessions)
+    {
+        {
+            ::std::lock_guard<::std::mutex> lock(sessionsMutex);
+            for (auto &session : sessions)
+                if ((session.connHandle != BLE_HS_CONN_HANDLE_NONE) && !session.accepted)
+                {
+                    session.accepted = true;
+                    session.held.store(true, ::std::memory_order_release);
+                    return &session;
+                }
+        }
+        if (timeoutMillis == 0)
+            sessionStarted.acquire();
+        else if (!sessionStarted.try_acquire_until(deadline))
+            return nullptr;
+    }
+    return nullptr;
+}
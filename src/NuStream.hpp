@@ -13,32 +13,133 @@
 
 #include <climits> // For ULONG_MAX
 #include <Stream.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "NuS.hpp"
+#include "NuClock.hpp"
+#include "NuCompression.hpp"
+#include "NuResume.hpp"
+
+#if defined(CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM) && (CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM > 0)
+#include <NimBLEL2CAPServer.h>
+#include <NimBLEL2CAPChannel.h>
+/** Defined if L2CAP connection-oriented channels are supported by the NimBLE stack */
+#define NUS_L2CAP_AVAILABLE
+#endif
 
 /**
- * @brief Communication stream via BLE and Nordic UART service
+ * @brief Default PSM of the L2CAP transport
+ *
+ * @note In the dynamic range for LE (0x0080 to 0x00FF)
+ */
+#define NUS_L2CAP_DEFAULT_PSM 0x0080
+
+/**
+ * @brief Default size of the receive buffer of each session
  *
+ * @note Sessions never block the BLE host task, so incoming data
+ *       must be queued. See NordicUARTStream::setSessionRxBufferSize().
  */
-class NordicUARTStream : public NordicUARTService, public Stream
+#ifndef NUS_SESSION_RX_BUFFER_SIZE
+#define NUS_SESSION_RX_BUFFER_SIZE 512
+#endif
+
+class NordicUARTStream;
+class NuSWaitSet;
+
+/**
+ * @brief Communication stream with a single peer
+ *        (or all peers) via BLE and Nordic UART service
+ *
+ * @note Incoming data from other peers is never mixed
+ *       in a session.
+ */
+class NordicUARTSession : public Stream
 {
-public:
-    using NordicUARTService::print;
-    using NordicUARTService::printf;
+    friend class NordicUARTStream;
+    friend class NuSAwaitable;
+    friend class NuSReadAwaitable;
+    friend class NuSWriteAwaitable;
+    friend class NuSWaitSet;
 
-protected:
-    // Overriden Methods
-    virtual void onUnsubscribe(size_t subscriberCount) override;
-    void onWrite(
-        NimBLECharacteristic *pCharacteristic,
-        NimBLEConnInfo &connInfo) override;
+public:
+    NordicUARTSession() : Stream() {};
+    NordicUARTSession(const NordicUARTSession &) = delete;
+    NordicUARTSession(NordicUARTSession &&) = delete;
+    NordicUARTSession &operator=(const NordicUARTSession &) = delete;
+    NordicUARTSession &operator=(NordicUARTSession &&) = delete;
+    virtual ~NordicUARTSession() {};
 
 public:
-    NordicUARTStream() : NordicUARTService(), Stream() {};
-    NordicUARTStream(const NordicUARTStream &) = delete;
-    NordicUARTStream(NordicUARTStream &&) = delete;
-    NordicUARTStream &operator=(const NordicUARTStream &) = delete;
-    NordicUARTStream &operator=(NordicUARTStream &&) = delete;
-    virtual ~NordicUARTStream() {};
+    /**
+     * @brief Get the connection handle of the peer
+     *
+     * @return uint16_t Connection handle or `BLE_HS_CONN_HANDLE_NONE`
+     *                  if this session is not bound to a single peer.
+     */
+    uint16_t getConnHandle() const { return connHandle.load(::std::memory_order_acquire); };
+
+    /**
+     * @brief Check if the peer is still connected and subscribed
+     *
+     * @note In sessions, also true while there is unread data
+     *       from a disconnected peer, so no data is missed by
+     *       reading until this method returns false.
+     *
+     * @return true If connected
+     * @return false If not connected
+     */
+    bool isConnected();
+
+    /**
+     * @brief Terminate the peer connection
+     *
+     */
+    void disconnect();
+
+    /**
+     * @brief Get the negotiated ATT MTU of the peer connection
+     *
+     * @return uint16_t ATT MTU in bytes or zero if not connected
+     */
+    uint16_t getMTU();
+
+    /**
+     * @brief Set the size of the receive buffer
+     *
+     * @note By default, there is no receive buffer (size zero):
+     *       the peer gets blocked until each incoming packet is consumed.
+     *       A receive buffer absorbs bursts of incoming packets,
+     *       which is advisable when write without response is allowed.
+     *       See NordicUARTService::allowWriteWithoutResponse().
+     *
+     * @note Should be called while not connected. Unread data is discarded.
+     *
+     * @note In sessions, the receive buffer is a queue that never blocks
+     *       the peer. A peer overrunning it is disconnected.
+     *       See getDroppedByteCount().
+     *
+     * @param size Size of the receive buffer in bytes, or zero to disable.
+     * @return size_t Previous size of the receive buffer.
+     */
+    size_t setRxBufferSize(size_t size);
+
+    /**
+     * @brief Get the count of incoming bytes dropped for lack of room
+     *
+     * @note A session does not block the BLE host task
+     *       (and so, all peers) when its receive buffer is full.
+     *       Incoming bytes that do not fit are dropped instead,
+     *       and the peer is disconnected, so it is aware of the loss.
+     *       Read faster or enlarge the receive buffer if this happens.
+     *       Always zero out of sessions.
+     *
+     * @return size_t Count of dropped bytes since the peer subscribed
+     */
+    size_t getDroppedByteCount() const { return droppedByteCount.load(::std::memory_order_relaxed); };
 
 public:
     /**
@@ -71,7 +172,13 @@ public:
      * @note Terminates if the determined length has been read, it times out,
      *       or peer is disconnected. Unlike other read methods, no active waiting is used here.
      *
-     * @note Call `setTimeout(ULONG_MAX)` to disable time outs.
+     * @note The timeout applies to the whole operation, not to each incoming packet.
+     *       Call `setTimeout(ULONG_MAX)` to disable time outs.
+     *
+     * @note Returns at once on peer disconnection or when the service is stopped,
+     *       once previously received data has been read.
+     *       A disconnection is reported to one read only, so the next one
+     *       waits for the timeout as usual while no peer is connected.
      *
      * @param[out] buffer To store the bytes in
      * @param[in] size the Number of bytes to read
@@ -83,9 +190,53 @@ public:
     virtual size_t readBytes(uint8_t *buffer, size_t size) override;
     virtual size_t readBytes(char *buffer, size_t length) override
     {
-        return NordicUARTStream::readBytes((uint8_t *)buffer, length);
+        return NordicUARTSession::readBytes((uint8_t *)buffer, length);
     };
 
+    /**
+     * @brief Wait for incoming data and read as much as available
+     *
+     * @note Unlike readBytes(), returns as soon as some data is available,
+     *       without waiting for @p size bytes. Same timeout rules apply.
+     *
+     * @param[out] buffer To store the bytes in
+     * @param[in] size Maximum number of bytes to read
+     * @return size_t Number of bytes placed in the buffer, in the range from 1 to @p size,
+     *                or zero on timeout, peer disconnection or service stop.
+     */
+    size_t readSome(uint8_t *buffer, size_t size);
+
+    /**
+     * @brief Read characters from a stream into a buffer until a terminator is found
+     *
+     * @note Terminates if the terminator is found, the determined length has been read,
+     *       it times out, or peer is disconnected. The terminator is discarded.
+     *       Unlike the Arduino implementation, incoming data is not read
+     *       byte by byte and the timeout applies to the whole operation,
+     *       not to each byte.
+     *
+     * @param[in] terminator Character to search for
+     * @param[out] buffer To store the bytes in
+     * @param[in] size the Number of bytes to read
+     * @return size_t Number of bytes placed in the buffer,
+     *                not including the terminator.
+     */
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t size);
+    size_t readBytesUntil(char terminator, char *buffer, size_t length)
+    {
+        return NordicUARTSession::readBytesUntil(terminator, (uint8_t *)buffer, length);
+    };
+
+    /**
+     * @brief Read a string until a terminator is found
+     *
+     * @note Same as readBytesUntil(), but with no limit in length.
+     *
+     * @param[in] terminator Character to search for
+     * @return String Characters read, not including the terminator.
+     */
+    String readStringUntil(char terminator);
+
 public:
     /**
      * @brief Write a single byte to the stream
@@ -95,7 +246,7 @@ public:
      */
     virtual size_t write(uint8_t byte) override
     {
-        return NordicUARTService::write(&byte, 1);
+        return NordicUARTSession::write(&byte, 1);
     };
 
     /**
@@ -105,17 +256,444 @@ public:
      * @param[in] size Count of bytes to write
      * @return size_t Actual count of bytes that were written
      */
-    virtual size_t write(const uint8_t *buffer, size_t size) override
-    {
-        return NordicUARTService::write(buffer, size);
-    };
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+
+protected:
+    /**
+     * @brief Hold incoming data until consumed
+     *
+     * @note Blocks the calling task until previous data is consumed
+     *       or there is room enough in the receive buffer.
+     *       Sessions drop incoming data that does not fit
+     *       and disconnect the peer, instead.
+     *
+     * @param value Incoming data
+     */
+    void receive(const NimBLEAttValue &value);
+
+    /**
+     * @brief Discard unread data, if any
+     *
+     */
+    void discard();
+
+    /**
+     * @brief Awake the task waiting for incoming data, if any,
+     *        due to peer disconnection
+     *
+     */
+    void hangUp();
+
+    /**
+     * @brief Awake the task waiting for incoming data, if any,
+     *        due to the service being stopped
+     *
+     */
+    void halt();
+
+    /**
+     * @brief Drop incoming bytes that do not fit and disconnect the peer
+     *
+     * @param size Count of dropped bytes
+     */
+    void overrun(size_t size);
 
 private:
+    NordicUARTService *pOwner = nullptr;
+    ::std::atomic<uint16_t> connHandle{BLE_HS_CONN_HANDLE_NONE};
+    bool bAllPeers = false;
+    // Drop incoming data instead of blocking. Set in peer sessions.
+    bool bDropWhenFull = false;
+    bool accepted = false;
+    // True while the application may be using this session,
+    // that is, since acceptSession() until it becomes aware
+    // of the disconnection. Not reused for another peer meanwhile.
+    ::std::atomic<bool> held{false};
+    ::std::atomic<size_t> droppedByteCount{0};
     nus_semaphore dataConsumed{1};
     nus_semaphore dataAvailable{0};
     NimBLEAttValue incomingPacket;
-    bool disconnected = false;
-    size_t unreadByteCount = 0;
+    // Set by hangUp(). Cleared when reported to a reader or on a new connection.
+    ::std::atomic<bool> disconnected{false};
+    ::std::atomic<bool> stopped{false};
+    // Written by the BLE host task and the reading task.
+    // A store with release semantics publishes incoming data
+    // (incomingPacket or the receive buffer) to readers.
+    ::std::atomic<size_t> unreadByteCount{0};
+    // Receive buffer (ring). Not used if empty.
+    ::std::vector<uint8_t> rxBuffer;
+    size_t rxHead = 0;
+    ::std::mutex rxMutex;
+    ::std::atomic<NuSWaitSet *> pWaitSet{nullptr};
+    // Count of tasks inside notifyWaitSet()
+    ::std::atomic<uint32_t> waitSetNotifiers{0};
+    // Count of calls to notifyWaitSet(). Lets coroutines know that something happened.
+    ::std::atomic<uint32_t> notificationCount{0};
+
+    void notifyWaitSet();
+    bool isPeerConnected();
+    nus_clock::time_point getDeadline() const;
+    bool waitForData(nus_clock::time_point deadline);
+    size_t take(uint8_t *buffer, size_t size);
+    size_t takeUntil(
+        char terminator,
+        uint8_t *buffer,
+        size_t size,
+        nus_clock::time_point deadline,
+        bool &terminated);
+    size_t view(const uint8_t *&data);
+    void skip(size_t count);
+};
+
+/**
+ * @brief Communication stream via BLE and Nordic UART service
+ *
+ * @note By default, this stream receives data from all peers
+ *       and sends data to all peers. Call useSessions()
+ *       to serve each peer in a separate session.
+ */
+class NordicUARTStream : public NordicUARTService, public NordicUARTSession
+{
+public:
+    using NordicUARTService::disconnect;
+    using NordicUARTService::getMTU;
+    using NordicUARTService::isConnected;
+    using NordicUARTService::print;
+    using NordicUARTService::printf;
+
+    /**
+     * @brief Check if a peer is connected and subscribed to this service,
+     *        or connected to the L2CAP transport
+     *
+     * @return true If connected
+     * @return false If not connected
+     */
+    bool isConnected();
+
+protected:
+    // Overriden Methods
+    virtual void onSubscribe(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo,
+        uint16_t subValue) override;
+    virtual void onUnsubscribe(size_t subscriberCount) override;
+    virtual void onPeerSubscribe(uint16_t connHandle) override;
+    virtual void onPeerUnsubscribe(uint16_t connHandle) override;
+    virtual void onStop() override;
+    void onWrite(
+        NimBLECharacteristic *pCharacteristic,
+        NimBLEConnInfo &connInfo) override;
+    virtual void onCompressionRequest(uint16_t connHandle, uint8_t codec) override;
+    virtual size_t writeToPeer(uint16_t connHandle, const uint8_t *data, size_t size) override;
+    virtual void onResumeRequest(uint16_t connHandle, const uint8_t *data, size_t size) override;
+
+public:
+    NordicUARTStream();
+    NordicUARTStream(const NordicUARTStream &) = delete;
+    NordicUARTStream(NordicUARTStream &&) = delete;
+    NordicUARTStream &operator=(const NordicUARTStream &) = delete;
+    NordicUARTStream &operator=(NordicUARTStream &&) = delete;
+    virtual ~NordicUARTStream()
+    {
+        onData(nullptr);
+        useResumption(0);
+    };
+
+public:
+    /**
+     * @brief Serve each peer in a separate session, or not
+     *
+     * @note When enabled, incoming data from each peer goes to its
+     *       own session (see getSession() and acceptSession()),
+     *       and this stream does not receive any data.
+     *       When disabled (default), all incoming data goes to this stream.
+     *
+     * @note Each session gets a receive buffer of NUS_SESSION_RX_BUFFER_SIZE
+     *       bytes, unless already set. See setSessionRxBufferSize().
+     *
+     * @note Should be called before start() or while no peer is connected.
+     *
+     * @param yesOrNo True to enable sessions, false to disable.
+     * @return true Previously, enabled.
+     * @return false Previously, disabled.
+     */
+    bool useSessions(bool yesOrNo);
+
+    /**
+     * @brief Get the session of a subscribed peer
+     *
+     * @param connHandle Connection handle of the peer
+     * @return NordicUARTSession* The session of @p connHandle,
+     *         or `nullptr` if @p connHandle is not subscribed
+     *         or sessions are not enabled.
+     *         Do not keep the pointer after disconnection,
+     *         unless the session was returned by acceptSession().
+     */
+    NordicUARTSession *getSession(uint16_t connHandle);
+
+    /**
+     * @brief Wait for a new peer session (blocking)
+     *
+     * @note Each session is returned just once.
+     *       Sessions must be enabled in advance. See useSessions().
+     *
+     * @note The returned session is not reused for another peer
+     *       until the application is aware of the disconnection, that is,
+     *       until isConnected() returns false.
+     *       Do not use the session after that.
+     *
+     * @param[in] timeoutMillis Maximum time to wait (in milliseconds) or
+     *                          zero to disable timeouts and wait forever
+     * @return NordicUARTSession* The new session, or `nullptr` on timeout.
+     */
+    NordicUARTSession *acceptSession(const unsigned int timeoutMillis = 0);
+
+    /**
+     * @brief Set the size of the receive buffer of this stream and all sessions
+     *
+     * @note See NordicUARTSession::setRxBufferSize().
+     *       When sessions are enabled, zero means the size given
+     *       to setSessionRxBufferSize() for them.
+     *
+     * @param size Size of each receive buffer in bytes, or zero to disable.
+     * @return size_t Previous size of the receive buffer.
+     */
+    size_t setRxBufferSize(size_t size);
+
+    /**
+     * @brief Set the size of the receive buffer of all sessions
+     *
+     * @note Sessions never block the peer, so they always have
+     *       a receive buffer. A peer overrunning it is disconnected.
+     *       See NordicUARTSession::getDroppedByteCount().
+     *
+     * @note Should be called while not connected. Unread data is discarded.
+     *
+     * @param size Size of each receive buffer in bytes,
+     *             or zero for NUS_SESSION_RX_BUFFER_SIZE.
+     * @return size_t Previous size of the receive buffer of sessions.
+     */
+    size_t setSessionRxBufferSize(size_t size);
+
+    /**
+     * @brief Offer an L2CAP connection-oriented channel as an alternative transport
+     *
+     * @note When a peer connects to the L2CAP channel, incoming and outgoing
+     *       data goes through such a channel, which provides higher throughput
+     *       and credit-based flow control. The Stream interface does not change.
+     *       Peers know the PSM of the channel thanks to
+     *       the NORDIC_UART_L2CAP_PSM_UUID characteristic.
+     *
+     * @note NimBLEDevice::init() must be called in advance.
+     *       Must be called before start(). Not available in sessions.
+     *
+     * @note Requires `CONFIG_BT_NIMBLE_L2CAP_COC_MAX_NUM` greater than zero.
+     *
+     * @param psm Protocol/Service Multiplexer in the range 0x0080 to 0x00FF
+     * @param mtu Maximum size of a single service data unit (SDU)
+     * @return true On success
+     * @return false If L2CAP is not supported or the channel can not be created
+     */
+    bool useL2CAP(uint16_t psm = NUS_L2CAP_DEFAULT_PSM, uint16_t mtu = 512);
+
+    /**
+     * @brief Set a callback for incoming data
+     *
+     * @note Incoming data is delivered as soon as it arrives,
+     *       with no need to poll available() nor to block in readBytes().
+     *       By default, the callback is executed from the BLE host task,
+     *       which gives the lowest possible latency.
+     *       Do not perform time-consuming tasks there.
+     *       Otherwise, use a dispatcher thread.
+     *
+     * @note Bytes not consumed by the callback are held until read
+     *       by other means (read(), readBytes(), etc.). The peer
+     *       gets blocked meanwhile. When using a dispatcher thread,
+     *       bytes not consumed are delivered again as soon as more data
+     *       arrives or resumeData() is called.
+     *
+     * @note In sessions, the callback is always executed from the BLE host task
+     *       and bytes not consumed go to the receive buffer of the session,
+     *       which never blocks the peer.
+     *       Should be called while no peer is connected.
+     *
+     * @param callback Function to execute, or `nullptr` to disable.
+     * @param useDispatcher True to execute the callback from a dispatcher thread.
+     *                      In such a case, the connection handle of the sender is
+     *                      not known.
+     */
+    void onData(NuSDataCallback_t callback, bool useDispatcher = false);
+
+    /**
+     * @brief Deliver bytes not consumed to the callback again
+     *
+     * @note Call when ready to consume them.
+     *       Ignored unless using a dispatcher thread.
+     */
+    void resumeData();
+
+    /**
+     * @brief Offer compression to peers, or not
+     *
+     * @note When offered, each peer may enable compression for its own
+     *       connection through the NORDIC_UART_COMPRESSION_UUID
+     *       characteristic. Then, outgoing data is compressed
+     *       and incoming data is decompressed transparently.
+     *       Each call to write() is flushed, so the peer can
+     *       decompress it at once. Previous data is used as a
+     *       dictionary, so repetitive data (like JSON or log text)
+     *       is compressed across calls. Writing a few bytes at a time
+     *       does not pay off. Compressed data not sent for lack of
+     *       transmission buffers goes first in the next call.
+     *
+     * @note Takes about 4 KB of memory for each peer using compression.
+     *       Does not apply to the L2CAP transport.
+     *
+     * @note Must be called before start(). Not offered by default.
+     *
+     * @param yesOrNo True to offer compression, false otherwise.
+     * @return true Previously, offered.
+     * @return false Previously, not offered.
+     */
+    bool useCompression(bool yesOrNo);
+
+    /**
+     * @brief Check if a peer is using compression
+     *
+     * @param connHandle Connection handle of the peer
+     * @return true If @p connHandle enabled compression
+     * @return false Otherwise
+     */
+    bool isCompressed(uint16_t connHandle);
+
+    /**
+     * @brief Get the compression counters of all peers
+     *
+     * @return NuSCompressionStats_t Counters since start
+     */
+    NuSCompressionStats_t getCompressionStats();
+
+    /**
+     * @brief Let a peer resume its session after a link drop
+     *
+     * @note Outgoing bytes are numbered in sequence and retained
+     *       until the peer acknowledges them. When the peer reconnects
+     *       and resumes its session (see NORDIC_UART_RESUME_UUID),
+     *       bytes not received are sent again. While the peer is away,
+     *       write() keeps retaining bytes, so no data is lost
+     *       while the retention buffer has room. Bytes not sent for lack of transmission buffers are sent
+     *       again a few milliseconds later, with no need to write more.
+     *       Other peers are served as usual, even while the peer is away.
+     *
+     * @note write() accepts less bytes than requested when there is
+     *       no room in the retention buffer, so the peer should
+     *       acknowledge often (for example, every half buffer).
+     *       While the peer is away, its session expires
+     *       when the retention buffer gets full, instead.
+     *
+     * @note Just one peer can resume its session at a time:
+     *       the last one writing a resume request.
+     *       Does not apply to sessions nor to the L2CAP transport.
+     *       Must be called before start(). Disabled by default.
+     *
+     * @param retentionSize Size of the retention buffer in bytes,
+     *                      or zero to disable.
+     * @param timeoutMillis Time to keep a session after a link drop
+     *                      (in milliseconds).
+     */
+    void useResumption(size_t retentionSize = 4096, uint32_t timeoutMillis = 30000);
+
+    /**
+     * @brief Get the session resumption counters
+     *
+     * @return NuSResumeStats_t Counters since start
+     */
+    NuSResumeStats_t getResumeStats();
+
+public:
+    /**
+     * @brief Write a single byte to the stream
+     *
+     * @param[in] byte Byte to write
+     * @return size_t The number of bytes written
+     */
+    virtual size_t write(uint8_t byte) override
+    {
+        return NordicUARTStream::write(&byte, 1);
+    };
+
+    /**
+     * @brief Write bytes to the stream
+     *
+     * @param[in] buffer Pointer to first byte to write
+     * @param[in] size Count of bytes to write
+     * @return size_t Actual count of bytes that were written
+     */
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+
+    using NordicUARTService::write;
+
+private:
+    bool bUseSessions = false;
+    size_t sessionRxBufferSize = NUS_SESSION_RX_BUFFER_SIZE;
+    NordicUARTSession sessions[NUS_MAX_PEERS];
+    ::std::mutex sessionsMutex;
+    nus_semaphore sessionStarted{0};
+    NuSDataCallback_t dataCallback;
+    ::std::atomic<bool> bDispatch{false};
+    ::std::thread dispatcherThread;
+
+    // Compression state of each peer using compression
+    bool bUseCompression = false;
+    struct
+    {
+        uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+        ::std::mutex txMutex;
+        NuSCompressor compressor;
+        NuSDecompressor decompressor;
+        ::std::vector<uint8_t> txBuffer;
+        // Compressed bytes in txBuffer not sent yet (out of transmission buffers)
+        size_t txPendingOffset = 0;
+        size_t txPendingSize = 0;
+        ::std::vector<uint8_t> rxBuffer;
+    } compression[NUS_MAX_PEERS];
+    ::std::mutex compressionMutex;
+    NuSCompressionStats_t compressionStats{};
+
+    // Session resumption state
+    NuSRetentionBuffer retention;
+    uint32_t resumeToken = 0;
+    uint16_t resumeConnHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint32_t resumeTimeout = 0;
+    nus_clock::time_point detachTime;
+    NuSResumeStats_t resumeStats{};
+    ::std::mutex resumeMutex;
+    bool retryScheduled = false;
+    ::std::atomic<bool> bRetry{false};
+    ::std::thread retryThread;
+    nus_semaphore retryWanted{0};
+
+    void deliver(NordicUARTSession &session, uint16_t connHandle, const NimBLEAttValue &value);
+    void dispatchLoop();
+    int getCompressionIndex(uint16_t connHandle);
+    void releaseCompression(uint16_t connHandle);
+    void flushRetention();
+    void expireSession(bool force = false);
+    void retryLoop();
+
+#ifdef NUS_L2CAP_AVAILABLE
+    // Forwards L2CAP channel events to this stream
+    class L2CAPCallbacks : public NimBLEL2CAPChannelCallbacks
+    {
+    public:
+        NordicUARTStream *pOwner = nullptr;
+        void onConnect(NimBLEL2CAPChannel *channel, uint16_t negotiatedMTU) override;
+        void onRead(NimBLEL2CAPChannel *channel, ::std::vector<uint8_t> &data) override;
+        void onDisconnect(NimBLEL2CAPChannel *channel) override;
+    } l2capCallbacks;
+    NimBLEL2CAPChannel *pL2CAPChannel = nullptr;
+#endif
+    ::std::atomic<bool> l2capConnected{false};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file NuTrace.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Timestamped event trace of the Nordic UART Service
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuTrace.hpp"
+#include <atomic>
+#include <chrono>
+
+#if NUS_TRACE_SIZE > 0
+
+//-----------------------------------------------------------------------------
+// Ring of records
+//-----------------------------------------------------------------------------
+
+// Note: each record is guarded by a sequence number (a "seqlock"),
+// so a reader detects records overwritten while being read.
+// The sequence number is the record index plus one,
+// or zero while the record is being written.
+
+typedef struct
+{
+    ::std::atomic<uint32_t> sequence;
+    ::std::atomic<uint32_t> timestamp;
+    // Event (bits 0-7), phase (bits 8-15) and task number (bits 16-31)
+    ::std::atomic<uint32_t> header;
+    ::std::atomic<uint32_t> arg;
+} NuSTraceRecord_t;
+
+static NuSTraceRecord_t ring[NUS_TRACE_SIZE];
+// Index of the next record
+static ::std::atomic<uint32_t> head{0};
+// Index of the first record after clear()
+static ::std::atomic<uint32_t> first{0};
+// Source of task numbers
+static ::std::atomic<uint16_t> taskCount{0};
+
+static const char *eventNames[] = {
+    "RX",
+    "CONSUME_WAIT",
+    "READ",
+    "PACKET_READ",
+    "NOTIFY",
+    "NOTIFY_FAILED",
+    "SUBSCRIBE",
+    "UNSUBSCRIBE",
+    "AT_COMMAND",
+    "CLI_COMMAND"};
+
+static uint32_t getTimestamp() noexcept
+{
+    static const auto start = ::std::chrono::steady_clock::now();
+    return ::std::chrono::duration_cast<::std::chrono::microseconds>(
+               ::std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+static uint16_t getTaskNumber() noexcept
+{
+    // Note: numbered in order of first use
+    thread_local uint16_t taskNumber = ++taskCount;
+    return taskNumber;
+}
+
+//-----------------------------------------------------------------------------
+// Recording
+//-----------------------------------------------------------------------------
+
+void NuSTrace::record(NuSTraceEvent_t event, NuSTracePhase_t phase, uint32_t arg) noexcept
+{
+    uint32_t index = head.fetch_add(1, ::std::memory_order_relaxed);
+    NuSTraceRecord_t &record = ring[index & (NUS_TRACE_SIZE - 1)];
+    record.sequence.store(0, ::std::memory_order_relaxed);
+    ::std::atomic_thread_fence(::std::memory_order_release);
+    record.timestamp.store(getTimestamp(), ::std::memory_order_relaxed);
+    record.header.store(
+        (uint32_t)event | ((uint32_t)phase << 8) | ((uint32_t)getTaskNumber() << 16),
+        ::std::memory_order_relaxed);
+    record.arg.store(arg, ::std::memory_order_relaxed);
+    record.sequence.store(index + 1, ::std::memory_order_release);
+}
+
+void NuSTrace::clear() noexcept
+{
+    first.store(head.load(::std::memory_order_relaxed), ::std::memory_order_relaxed);
+}
+
+uint32_t NuSTrace::getLostCount() noexcept
+{
+    uint32_t count = head.load(::std::memory_order_relaxed) - first.load(::std::memory_order_relaxed);
+    return (count > NUS_TRACE_SIZE) ? (count - NUS_TRACE_SIZE) : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Dump
+//-----------------------------------------------------------------------------
+
+size_t NuSTrace::dump(Print &out)
+{
+    uint32_t end = head.load(::std::memory_order_acquire);
+    uint32_t start = first.load(::std::memory_order_relaxed);
+    if ((uint32_t)(end - start) > NUS_TRACE_SIZE)
+        start = end - NUS_TRACE_SIZE;
+
+    out.printf("# NuS trace: %u records lost\n", (unsigned int)getLostCount());
+    size_t result = 0;
+    for (uint32_t index = start; index != end; index++)
+    {
+        NuSTraceRecord_t &record = ring[index & (NUS_TRACE_SIZE - 1)];
+        uint32_t sequence = record.sequence.load(::std::memory_order_acquire);
+        uint32_t timestamp = record.timestamp.load(::std::memory_order_relaxed);
+        uint32_t header = record.header.load(::std::memory_order_relaxed);
+        uint32_t arg = record.arg.load(::std::memory_order_relaxed);
+        ::std::atomic_thread_fence(::std::memory_order_acquire);
+        if ((sequence != index + 1) ||
+            (record.sequence.load(::std::memory_order_relaxed) != sequence))
+            // Overwritten or not written yet
+            continue;
+        uint8_t event = header & 0xFF;
+        if (event >= (sizeof(eventNames) / sizeof(eventNames[0])))
+            continue;
+        out.printf(
+            "%u %u %c %s %08x\n",
+            (unsigned int)timestamp,
+            (unsigned int)(header >> 16),
+            (char)((header >> 8) & 0xFF),
+            eventNames[event],
+            (unsigned int)arg);
+        result++;
+    }
+    return result;
+}
+
+#else
+
+//-----------------------------------------------------------------------------
+// Tracing disabled
+//-----------------------------------------------------------------------------
+
+void NuSTrace::record(NuSTraceEvent_t event, NuSTracePhase_t phase, uint32_t arg) noexcept
+{
+}
+
+void NuSTrace::clear() noexcept
+{
+}
+
+uint32_t NuSTrace::getLostCount() noexcept
+{
+    return 0;
+}
+
+size_t NuSTrace::dump(Print &out)
+{
+    out.printf("# NuS trace: disabled (define NUS_TRACE_SIZE)\n");
+    return 0;
+}
+
+#endif
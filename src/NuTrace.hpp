@@ -0,0 +1,161 @@
+/**
+ * @file NuTrace.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Timestamped event trace of the Nordic UART Service
+ *
+ * @note Tracing is compiled out unless NUS_TRACE_SIZE is defined
+ *       (for example, as a build flag) to the count of records
+ *       to keep, which must be a power of two.
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUTRACE_HPP__
+#define __NUTRACE_HPP__
+
+#include <Print.h>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Count of trace records to keep, or zero to disable tracing
+ *
+ */
+#ifndef NUS_TRACE_SIZE
+#define NUS_TRACE_SIZE 0
+#endif
+
+#if (NUS_TRACE_SIZE & (NUS_TRACE_SIZE - 1)) != 0
+#error NUS_TRACE_SIZE must be a power of two
+#endif
+
+/**
+ * @brief Traced events
+ *
+ * @note The meaning of the argument of each record is given below.
+ */
+typedef enum
+{
+    /** Incoming data at the RX characteristic. Argument: connection handle (high half) and size (low half) */
+    NUS_TRACE_RX = 0,
+    /** BLE host task blocked until previous data is consumed. No argument. */
+    NUS_TRACE_CONSUME_WAIT,
+    /** readBytes() or readSome(). Argument: requested size at begin, read size at end. */
+    NUS_TRACE_READ,
+    /** NordicUARTPacket::read(). Argument: packet size at end. */
+    NUS_TRACE_PACKET_READ,
+    /** Notification sent. Argument: connection handle (high half) and size (low half) */
+    NUS_TRACE_NOTIFY,
+    /** Notification not sent (out of buffers). Argument: as NUS_TRACE_NOTIFY */
+    NUS_TRACE_NOTIFY_FAILED,
+    /** Peer subscription. Argument: connection handle. */
+    NUS_TRACE_SUBSCRIBE,
+    /** Peer unsubscription. Argument: connection handle. */
+    NUS_TRACE_UNSUBSCRIBE,
+    /** AT command callback. Argument: first four characters of the command name. */
+    NUS_TRACE_AT_COMMAND,
+    /** Shell command callback. Argument: first four characters of the command name. */
+    NUS_TRACE_CLI_COMMAND
+} NuSTraceEvent_t;
+
+/**
+ * @brief Phase of a traced event (as in the Chrome trace format)
+ *
+ */
+typedef enum
+{
+    /** Start of a duration */
+    NUS_TRACE_BEGIN = 'B',
+    /** End of a duration */
+    NUS_TRACE_END = 'E',
+    /** Instant event */
+    NUS_TRACE_INSTANT = 'i'
+} NuSTracePhase_t;
+
+/**
+ * @brief Lock-free ring of trace records
+ *
+ * @note Records are recorded from any task with no locks.
+ *       When the ring is full, the oldest records are overwritten.
+ *
+ * @note Use extras/tools/nus_trace_to_json.py to convert
+ *       the output of dump() into Chrome trace JSON,
+ *       which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class NuSTrace
+{
+public:
+    /**
+     * @brief Check if tracing was compiled in
+     *
+     * @return true If NUS_TRACE_SIZE is not zero
+     * @return false If tracing is disabled
+     */
+    static constexpr bool isEnabled() noexcept { return (NUS_TRACE_SIZE > 0); };
+
+    /**
+     * @brief Add a record
+     *
+     * @note Use the NUS_TRACE_* macros instead, so tracing
+     *       is compiled out when disabled.
+     *
+     * @param event Traced event
+     * @param phase Event phase
+     * @param arg Event argument. See NuSTraceEvent_t.
+     */
+    static void record(NuSTraceEvent_t event, NuSTracePhase_t phase, uint32_t arg = 0) noexcept;
+
+    /**
+     * @brief Pack up to four characters into a record argument
+     *
+     * @param text Characters to pack
+     * @param size Count of characters
+     * @return uint32_t Record argument
+     */
+    static uint32_t tag(const char *text, size_t size) noexcept
+    {
+        uint32_t result = 0;
+        for (size_t index = 0; (index < size) && (index < 4); index++)
+            result |= ((uint32_t)(uint8_t)text[index]) << (8 * index);
+        return result;
+    };
+
+    /**
+     * @brief Write all records as text, oldest first
+     *
+     * @note One record per line: timestamp in microseconds, task number,
+     *       phase, event name and argument (hexadecimal).
+     *       Records added while dumping are not written.
+     *
+     * @param out Where to write. For example, Serial or NuSerial.
+     * @return size_t Count of records written
+     */
+    static size_t dump(Print &out);
+
+    /**
+     * @brief Discard all records
+     *
+     */
+    static void clear() noexcept;
+
+    /**
+     * @brief Get the count of records overwritten since the last clear()
+     *
+     * @return uint32_t Count of lost records
+     */
+    static uint32_t getLostCount() noexcept;
+};
+
+#if NUS_TRACE_SIZE > 0
+#define NUS_TRACE_BEGIN_EVENT(event, arg) NuSTrace::record(event, NUS_TRACE_BEGIN, arg)
+#define NUS_TRACE_END_EVENT(event, arg) NuSTrace::record(event, NUS_TRACE_END, arg)
+#define NUS_TRACE_INSTANT_EVENT(event, arg) NuSTrace::record(event, NUS_TRACE_INSTANT, arg)
+#else
+#define NUS_TRACE_BEGIN_EVENT(event, arg) ((void)0)
+#define NUS_TRACE_END_EVENT(event, arg) ((void)0)
+#define NUS_TRACE_INSTANT_EVENT(event, arg) ((void)0)
+#endif
+
+#endif
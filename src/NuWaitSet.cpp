@@ -0,0 +1,164 @@
+/**
+ * @file NuWaitSet.cpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Wait for events on many streams at once
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#include "NuWaitSet.hpp"
+#include <chrono>
+#include <thread>
+
+//-----------------------------------------------------------------------------
+// Watched objects
+//-----------------------------------------------------------------------------
+
+int NuSWaitSet::add(NordicUARTSession &stream, uint8_t events)
+{
+    NuSWaitSet *expected = nullptr;
+    if (!stream.pWaitSet.compare_exchange_strong(expected, this) && (expected != this))
+        return -1;
+    entries.push_back({&stream, nullptr, nullptr, nullptr, events, 0});
+    return entries.size() - 1;
+}
+
+int NuSWaitSet::add(NordicUARTPacket &packet, uint8_t events)
+{
+    NuSWaitSet *expected = nullptr;
+    if (!packet.pWaitSet.compare_exchange_strong(expected, this) && (expected != this))
+        return -1;
+    entries.push_back({nullptr, &packet, nullptr, nullptr, events, 0});
+    return entries.size() - 1;
+}
+
+int NuSWaitSet::add(Stream &stream, uint8_t events)
+{
+    entries.push_back({nullptr, nullptr, &stream, nullptr, events, 0});
+    bPollStreams = true;
+    return entries.size() - 1;
+}
+
+int NuSWaitSet::add(HardwareSerial &serial, uint8_t events)
+{
+    entries.push_back({nullptr, nullptr, &serial, &serial, events, 0});
+    if (events & NUS_WAIT_READABLE)
+        serial.onReceive([this]()
+                         { notify(); });
+    if (events & NUS_WAIT_WRITABLE)
+        bPollStreams = true;
+    return entries.size() - 1;
+}
+
+void NuSWaitSet::clear()
+{
+    // Note: the BLE host task may be notifying this wait set right now.
+    // Wait for it to finish, so this object can be destroyed safely.
+    for (auto &entry : entries)
+        if (entry.pSession)
+        {
+            entry.pSession->pWaitSet = nullptr;
+            while (entry.pSession->waitSetNotifiers > 0)
+                ::std::this_thread::yield();
+        }
+        else if (entry.pPacket)
+        {
+            entry.pPacket->pWaitSet = nullptr;
+            while (entry.pPacket->waitSetNotifiers > 0)
+                ::std::this_thread::yield();
+        }
+        else if (entry.pSerial && (entry.events & NUS_WAIT_READABLE))
+            entry.pSerial->onReceive(nullptr);
+    entries.clear();
+    bPollStreams = false;
+}
+
+unsigned int NuSWaitSet::setPollingInterval(unsigned int millis) noexcept
+{
+    unsigned int result = pollingMillis;
+    pollingMillis = (millis > 0) ? millis : 1;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Waiting
+//-----------------------------------------------------------------------------
+
+uint8_t NuSWaitSet::check(const Entry_t &entry)
+{
+    uint8_t found = 0;
+    if (entry.pSession)
+    {
+        NordicUARTSession &session = *entry.pSession;
+        // Note: isConnected() is not called in sessions, since the application
+        // would be considered aware of the disconnection
+        bool connected = session.bAllPeers
+                             ? static_cast<NordicUARTStream *>(session.pOwner)->isConnected()
+                             : session.isPeerConnected();
+        if (session.available() > 0)
+            found = found | NUS_WAIT_READABLE;
+        found = found | (connected ? NUS_WAIT_WRITABLE : NUS_WAIT_DISCONNECTED);
+    }
+    else if (entry.pPacket)
+    {
+        NordicUARTPacket &packet = *entry.pPacket;
+        if (packet.bReadable.load(::std::memory_order_acquire))
+            found = found | NUS_WAIT_READABLE;
+        found = found | (packet.isConnected() ? NUS_WAIT_WRITABLE : NUS_WAIT_DISCONNECTED);
+    }
+    else
+    {
+        if (entry.pStream->available() > 0)
+            found = found | NUS_WAIT_READABLE;
+        if (entry.pStream->availableForWrite() > 0)
+            found = found | NUS_WAIT_WRITABLE;
+    }
+    return found & entry.events;
+}
+
+int NuSWaitSet::poll()
+{
+    int count = 0;
+    for (auto &entry : entries)
+    {
+        entry.found = check(entry);
+        if (entry.found)
+            count++;
+    }
+    return count;
+}
+
+int NuSWaitSet::wait(unsigned int timeoutMillis)
+{
+    auto deadline = nus_clock::now() + ::std::chrono::milliseconds(timeoutMillis);
+    while (true)
+    {
+        // Note: a notification after poll() is not lost,
+        // since the semaphore stays released
+        int count = poll();
+        if (count > 0)
+            return count;
+        if (bPollStreams)
+        {
+            auto next = nus_clock::now() + ::std::chrono::milliseconds(pollingMillis);
+            if ((timeoutMillis > 0) && (next > deadline))
+                next = deadline;
+            signal.try_acquire_until(next);
+        }
+        else if (timeoutMillis == 0)
+            signal.acquire();
+        else
+            signal.try_acquire_until(deadline);
+        if ((timeoutMillis > 0) && (nus_clock::now() >= deadline))
+            return poll();
+    }
+}
+
+uint8_t NuSWaitSet::getEvents(size_t index) const noexcept
+{
+    if (index < entries.size())
+        return entries[index].found;
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file NuWaitSet.hpp
+ * @author Ángel Fernández Pineda. Madrid. Spain.
+ * @date 2026-10-18
+ * @brief Wait for events on many streams at once
+ *
+ * @copyright Creative Commons Attribution 4.0 International (CC BY 4.0)
+ *
+ */
+
+#ifndef __NUWAITSET_HPP__
+#define __NUWAITSET_HPP__
+
+#include <Stream.h>
+#include <HardwareSerial.h>
+#include <vector>
+#include "NuStream.hpp"
+#include "NuPacket.hpp"
+
+/**
+ * @brief Events to wait for. May be combined with the `|` operator.
+ *
+ * @note Like in `poll()`, all events are level-triggered.
+ *       For example, NUS_WAIT_DISCONNECTED is reported
+ *       for as long as no peer is connected.
+ */
+typedef enum
+{
+    /** Data can be read without blocking */
+    NUS_WAIT_READABLE = 1,
+    /** Data can be written (a peer is connected) */
+    NUS_WAIT_WRITABLE = 2,
+    /** No peer is connected */
+    NUS_WAIT_DISCONNECTED = 4
+} NuSWaitEvent_t;
+
+/**
+ * @brief Wait for events on many NuS instances and Arduino streams at once
+ *
+ * @note Replaces busy loops calling `available()` on each stream.
+ *       The waiting task is awakened by the BLE host task
+ *       as soon as something happens at a NordicUARTStream, a session
+ *       or a NordicUARTPacket.
+ *       Hardware UARTs awake the waiting task when data arrives, too.
+ *       Other Arduino streams are polled from time to time
+ *       since they have no way to awake a task.
+ *       See setPollingInterval().
+ *
+ * @note Not thread-safe. Use the same task to add streams and to wait.
+ *       An object can be watched by just one wait set.
+ */
+class NuSWaitSet
+{
+public:
+    NuSWaitSet() {};
+    NuSWaitSet(const NuSWaitSet &) = delete;
+    NuSWaitSet(NuSWaitSet &&) = delete;
+    NuSWaitSet &operator=(const NuSWaitSet &) = delete;
+    NuSWaitSet &operator=(NuSWaitSet &&) = delete;
+    virtual ~NuSWaitSet() { clear(); };
+
+public:
+    /**
+     * @brief Watch a NordicUARTStream or a session
+     *
+     * @param stream Stream or session to watch
+     * @param events Events to wait for. See NuSWaitEvent_t.
+     * @return int Index of @p stream in this wait set,
+     *             or -1 if already watched by another wait set.
+     */
+    int add(NordicUARTSession &stream, uint8_t events = NUS_WAIT_READABLE);
+
+    /**
+     * @brief Watch a NordicUARTPacket
+     *
+     * @note A packet is readable when read() will not block.
+     *
+     * @param packet Packet stream to watch
+     * @param events Events to wait for. See NuSWaitEvent_t.
+     * @return int Index of @p packet in this wait set,
+     *             or -1 if already watched by another wait set.
+     */
+    int add(NordicUARTPacket &packet, uint8_t events = NUS_WAIT_READABLE);
+
+    /**
+     * @brief Watch any other Arduino stream
+     *
+     * @note NUS_WAIT_WRITABLE relies on `availableForWrite()`.
+     *       NUS_WAIT_DISCONNECTED is never reported.
+     *
+     * @param stream Stream to watch
+     * @param events Events to wait for. See NuSWaitEvent_t.
+     * @return int Index of @p stream in this wait set.
+     */
+    int add(Stream &stream, uint8_t events = NUS_WAIT_READABLE);
+
+    /**
+     * @brief Watch a hardware UART
+     *
+     * @note Incoming data awakes the waiting task through
+     *       `HardwareSerial::onReceive()`, which is taken by this wait set
+     *       until clear(). NUS_WAIT_WRITABLE is polled as in other streams.
+     *
+     * @param serial UART to watch
+     * @param events Events to wait for. See NuSWaitEvent_t.
+     * @return int Index of @p serial in this wait set.
+     */
+    int add(HardwareSerial &serial, uint8_t events = NUS_WAIT_READABLE);
+
+    /**
+     * @brief Stop watching all streams
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Get the count of watched streams
+     *
+     * @return size_t Count of streams
+     */
+    size_t size() const noexcept { return entries.size(); };
+
+    /**
+     * @brief Set the polling interval of other Arduino streams
+     *
+     * @param millis Time between polls in milliseconds. Default is 10.
+     * @return unsigned int Previous polling interval
+     */
+    unsigned int setPollingInterval(unsigned int millis) noexcept;
+
+public:
+    /**
+     * @brief Wait for any event on any watched stream (blocking)
+     *
+     * @param timeoutMillis Maximum time to wait (in milliseconds) or
+     *                      zero to disable timeouts and wait forever
+     * @return int Count of streams having some event,
+     *             or zero on timeout. See getEvents().
+     */
+    int wait(unsigned int timeoutMillis = 0);
+
+    /**
+     * @brief Check for events on all watched streams (non-blocking)
+     *
+     * @return int Count of streams having some event. See getEvents().
+     */
+    int poll();
+
+    /**
+     * @brief Get the events found at the last call to wait() or poll()
+     *
+     * @param index Index of a stream as returned by add()
+     * @return uint8_t Events found (see NuSWaitEvent_t) or zero
+     *                 if @p index is not valid.
+     */
+    uint8_t getEvents(size_t index) const noexcept;
+
+    /**
+     * @brief Awake the waiting task, if any
+     *
+     * @note Called from the BLE host task when something happens
+     *       at a watched object. May be called from any other task, too,
+     *       for example, from a receive hook of an Arduino stream.
+     */
+    void notify() { signal.release(); };
+
+private:
+    friend class NordicUARTSession;
+    friend class NordicUARTStream;
+    friend class NordicUARTPacket;
+    friend class NuSExecutor;
+
+    typedef struct
+    {
+        NordicUARTSession *pSession;
+        NordicUARTPacket *pPacket;
+        Stream *pStream;
+        HardwareSerial *pSerial;
+        uint8_t events;
+        uint8_t found;
+    } Entry_t;
+
+    ::std::vector<Entry_t> entries;
+    nus_semaphore signal{0};
+    unsigned int pollingMillis = 10;
+    bool bPollStreams = false;
+
+    static uint8_t check(const Entry_t &entry);
+};
+
+#endif